@@ -0,0 +1,304 @@
+#include "WyvBinaryLog.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif //_WIN32
+
+using namespace wyv;
+using namespace wyv::WyvBinaryLogFormat;
+
+const size_t WyvBinaryLog::INITIAL_SIZE;
+
+bool WyvMappedFile::open(const std::string &_path, size_t _size)
+{
+	close(0);
+#ifdef _WIN32
+	HANDLE file = CreateFileA(_path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	m_file = file;
+#else
+	m_file = ::open(_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (m_file < 0)
+		return false;
+#endif //_WIN32
+	if (!map(_size))
+	{
+		close(0);
+		return false;
+	}
+	return true;
+}
+
+bool WyvMappedFile::map(size_t _size)
+{
+#ifdef _WIN32
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)_size >> 32), (DWORD)_size, nullptr);
+	if (!m_mapping)
+		return false;
+	m_data = (char*)MapViewOfFile(m_mapping, FILE_MAP_WRITE, 0, 0, _size);
+	if (!m_data)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+		return false;
+	}
+#else
+	if (ftruncate(m_file, (off_t)_size))
+		return false;
+	void *data = mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, m_file, 0);
+	if (data == MAP_FAILED)
+		return false;
+	m_data = (char*)data;
+#endif //_WIN32
+	m_size = _size;
+	return true;
+}
+
+void WyvMappedFile::unmap()
+{
+	if (!m_data)
+		return;
+#ifdef _WIN32
+	UnmapViewOfFile(m_data);
+	CloseHandle(m_mapping);
+	m_mapping = nullptr;
+#else
+	munmap(m_data, m_size);
+#endif //_WIN32
+	m_data = nullptr;
+	m_size = 0;
+}
+
+bool WyvMappedFile::grow(size_t _size)
+{
+	if (_size <= m_size)
+		return true;
+	unmap();
+	return map(_size);
+}
+
+void WyvMappedFile::close(size_t _usedSize)
+{
+	unmap();
+#ifdef _WIN32
+	if (m_file)
+	{
+		LARGE_INTEGER size;
+		size.QuadPart = (LONGLONG)_usedSize;
+		SetFilePointerEx(m_file, size, nullptr, FILE_BEGIN);
+		SetEndOfFile(m_file);
+		CloseHandle(m_file);
+		m_file = nullptr;
+	}
+#else
+	if (m_file >= 0)
+	{
+		if (ftruncate(m_file, (off_t)_usedSize)) {}
+		::close(m_file);
+		m_file = -1;
+	}
+#endif //_WIN32
+}
+
+bool WyvBinaryLog::open(const std::string &_path)
+{
+	close();
+	if (!m_file.open(_path, INITIAL_SIZE))
+		return false;
+
+	char *header = m_file.getData();
+	memcpy(header, MAGIC, sizeof(MAGIC));
+	memcpy(header + 8, &VERSION, sizeof(VERSION));
+	m_offset = HEADER_SIZE;
+	return true;
+}
+
+void WyvBinaryLog::close()
+{
+	if (m_file.isOpen())
+		m_file.close(m_offset);
+	m_formats.clear();
+	m_offset = 0;
+}
+
+char *WyvBinaryLog::reserve(size_t _bytes)
+{
+	//Keep one zero byte past the data so readers always find a CHUNK_END
+	if (m_offset + _bytes + 1 > m_file.getSize() && !m_file.grow(std::max(m_file.getSize() * 2, m_offset + _bytes + 1)))
+		return nullptr;
+	char *result = m_file.getData() + m_offset;
+	m_offset += _bytes;
+	return result;
+}
+
+template<typename T>
+static char *Put(char *_out, T _value)
+{
+	memcpy(_out, &_value, sizeof(T));
+	return _out + sizeof(T);
+}
+
+void WyvBinaryLog::write(const WyvLogRecord &_record)
+{
+	if (!m_file.isOpen())
+		return;
+
+	uint32_t formatId = TEXT_ID;
+	if (_record.format)
+	{
+		auto found = m_formats.find(_record.format);
+		if (found == m_formats.end())
+		{
+			formatId = (uint32_t)m_formats.size();
+			uint16_t length = (uint16_t)std::min<size_t>(strlen(_record.format), 0xFFFF);
+			char *out = reserve(1 + 4 + 2 + length);
+			if (!out)
+				return;
+			out = Put<uint8_t>(out, CHUNK_FORMAT);
+			out = Put(out, formatId);
+			out = Put(out, length);
+			memcpy(out, _record.format, length);
+			m_formats[_record.format] = formatId;
+		}
+		else
+			formatId = found->second;
+	}
+
+	//Lengths are stored in 16 bits, longer text is cut at 64 KB
+	auto clamp = [](uint32_t _length) { return (uint16_t)std::min<uint32_t>(_length, 0xFFFF); };
+	size_t size = 1 + 4 + 1 + 1;
+	if (formatId == TEXT_ID)
+		size += 2 + clamp(_record.length);
+	else
+		for (uint8_t i = 0; i < _record.argCount; i++)
+			size += 1 + (_record.argTypes[i] == WYV_ARG_STRING ? 2 + clamp(_record.args[i].s.length) : 8);
+
+	char *out = reserve(size);
+	if (!out)
+		return;
+	out = Put<uint8_t>(out, CHUNK_ENTRY);
+	out = Put(out, formatId);
+	out = Put<uint8_t>(out, (uint8_t)_record.code);
+	if (formatId == TEXT_ID)
+	{
+		out = Put<uint8_t>(out, 0);
+		uint16_t length = clamp(_record.length);
+		out = Put(out, length);
+		memcpy(out, _record.data(), length);
+		return;
+	}
+
+	out = Put(out, _record.argCount);
+	for (uint8_t i = 0; i < _record.argCount; i++)
+	{
+		out = Put<uint8_t>(out, _record.argTypes[i]);
+		if (_record.argTypes[i] == WYV_ARG_STRING)
+		{
+			uint16_t length = clamp(_record.args[i].s.length);
+			out = Put(out, length);
+			memcpy(out, _record.data() + _record.args[i].s.offset, length);
+			out += length;
+		}
+		else
+			out = Put(out, _record.args[i].u);
+	}
+}
+
+bool WyvBinaryLogReader::open(const std::string &_path)
+{
+	std::ifstream file(_path, std::ios::binary);
+	if (!file)
+		return false;
+	m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	m_formats.clear();
+	m_offset = HEADER_SIZE;
+
+	uint32_t version = 0;
+	if (m_data.size() < HEADER_SIZE || memcmp(m_data.data(), MAGIC, sizeof(MAGIC)))
+		return false;
+	memcpy(&version, m_data.data() + 8, sizeof(version));
+	return version == VERSION;
+}
+
+bool WyvBinaryLogReader::next(WyvLogRecord &_record, uint32_t &_formatId)
+{
+	const char *data = m_data.data();
+	size_t size = m_data.size();
+	auto read = [&](void *_out, size_t _bytes)
+	{
+		if (m_offset + _bytes > size)
+			return false;
+		memcpy(_out, data + m_offset, _bytes);
+		m_offset += _bytes;
+		return true;
+	};
+
+	for (;;)
+	{
+		uint8_t chunk = CHUNK_END;
+		if (!read(&chunk, 1) || chunk == CHUNK_END)
+			return false;
+
+		if (chunk == CHUNK_FORMAT)
+		{
+			uint32_t id;
+			uint16_t length;
+			if (!read(&id, 4) || !read(&length, 2) || m_offset + length > size || id != m_formats.size())
+				return false;
+			m_formats.emplace_back(data + m_offset, length);
+			m_offset += length;
+			continue;
+		}
+		if (chunk != CHUNK_ENTRY)
+			return false;
+
+		uint8_t code, argCount;
+		if (!read(&_formatId, 4) || !read(&code, 1) || !read(&argCount, 1))
+			return false;
+
+		if (_formatId == TEXT_ID)
+		{
+			uint16_t length;
+			if (!read(&length, 2) || m_offset + length > size)
+				return false;
+			_record.setText((WyvCode)code, data + m_offset, length);
+			m_offset += length;
+			return true;
+		}
+
+		if (_formatId >= m_formats.size() || argCount > WyvLogRecord::MAX_ARGS)
+			return false;
+		_record.begin((WyvCode)code, m_formats[_formatId].c_str());
+		for (uint8_t i = 0; i < argCount; i++)
+		{
+			uint8_t type;
+			if (!read(&type, 1))
+				return false;
+			if (type == WYV_ARG_STRING)
+			{
+				uint16_t length;
+				if (!read(&length, 2) || m_offset + length > size)
+					return false;
+				_record.packString(data + m_offset, length);
+				m_offset += length;
+			}
+			else if (WyvLogRecord::Arg *arg = _record.next((WyvLogArgType)type))
+			{
+				if (!read(&arg->u, 8))
+					return false;
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,94 @@
+#ifndef _H_WYVBINARYLOG_
+#define _H_WYVBINARYLOG_
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "WyvLog.h"
+
+namespace wyv
+{
+	//Growable read-write memory mapping of a file
+	class WyvMappedFile
+	{
+#ifdef _WIN32
+		void *m_file = nullptr, *m_mapping = nullptr;
+#else
+		int m_file = -1;
+#endif //_WIN32
+		char *m_data = nullptr;
+		size_t m_size = 0;
+
+		bool map(size_t _size);
+		void unmap();
+
+	public:
+		WyvMappedFile() {}
+		~WyvMappedFile() { close(0); }
+
+		WyvMappedFile(const WyvMappedFile&) = delete;
+		WyvMappedFile &operator=(const WyvMappedFile&) = delete;
+
+		bool open(const std::string &_path, size_t _size);
+		bool grow(size_t _size);
+		//Unmaps and truncates the file to _usedSize bytes
+		void close(size_t _usedSize);
+
+		bool isOpen() const { return m_data != nullptr; }
+		char *getData() const { return m_data; }
+		size_t getSize() const { return m_size; }
+	};
+
+	//File layout: 16 byte header, then a stream of chunks. A FORMAT chunk assigns the next id to a
+	//format string the first time it is seen, an ENTRY chunk holds a format id plus raw arguments.
+	//Unwritten mapped space is zero, so a reader stops cleanly at the end of a crashed session.
+	namespace WyvBinaryLogFormat
+	{
+		static const char MAGIC[8] = { 'W', 'Y', 'V', 'L', 'O', 'G', 0, 0 };
+		static const uint32_t VERSION = 2; //2 added WYV_INFO, shifting the codes above it
+		static const uint32_t TEXT_ID = 0xFFFFFFFF;
+		static const size_t HEADER_SIZE = 16;
+		enum Chunk : uint8_t { CHUNK_END = 0, CHUNK_FORMAT = 1, CHUNK_ENTRY = 2 };
+	}
+
+	//Drain-thread side sink, records are written without being formatted
+	class WyvBinaryLog
+	{
+		WyvMappedFile m_file;
+		size_t m_offset = 0;
+		std::unordered_map<const char*, uint32_t> m_formats;
+
+		char *reserve(size_t _bytes);
+
+	public:
+		static const size_t INITIAL_SIZE = 16 * 1024 * 1024;
+
+		~WyvBinaryLog() { close(); }
+
+		bool open(const std::string &_path);
+		void close();
+		bool isOpen() const { return m_file.isOpen(); }
+
+		void write(const WyvLogRecord &_record);
+	};
+
+	//Offline side, rebuilds the records of a binary log so they can be formatted or aggregated
+	class WyvBinaryLogReader
+	{
+		std::vector<char> m_data;
+		size_t m_offset = 0;
+		std::deque<std::string> m_formats;
+
+	public:
+		bool open(const std::string &_path);
+
+		//Returns false at the end of the log or on a corrupt chunk
+		bool next(WyvLogRecord &_record, uint32_t &_formatId);
+		size_t getFormatCount() const { return m_formats.size(); }
+	};
+}
+
+#endif //_H_WYVBINARYLOG_
@@ -0,0 +1,192 @@
+#include "WyvCommandPools.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "Wyvern.h"
+
+using namespace wyv;
+
+const uint32_t WyvCommandPools::DEFAULT_FRAMES;
+
+//Never reused, so a thread's cached pools of a destroyed instance can't be mistaken for a new one's
+static std::atomic<uint64_t> g_nextId(1);
+//Bumped by every destroy. Threads compare it on lookup and only then sweep their cache against the live ids.
+static std::atomic<uint64_t> g_destroyGeneration(0);
+static std::mutex g_liveMutex;
+static std::unordered_set<uint64_t> g_liveIds;
+
+void WyvCommandPools::create(const std::string &_name, WyvQueueRole _role, uint32_t _frames)
+{
+	destroy();
+	m_name = _name;
+	m_device = Wyvern::GetDevice();
+	m_role = _role;
+	m_id = g_nextId.fetch_add(1, std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock(g_liveMutex);
+		g_liveIds.insert(m_id);
+	}
+	m_frameCount = std::max(_frames, 1u);
+	m_values.assign(m_frameCount, 0);
+	m_frame.store(1, std::memory_order_release);
+}
+
+void WyvCommandPools::destroy()
+{
+	if (!m_device)
+		return;
+	WyvQueue &queue = Wyvern::GetQueue(m_role);
+	for (uint64_t value : m_values)
+		queue.wait(value);
+	logStats();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto &thread : m_threads)
+		for (FramePool &frame : thread->frames)
+			vkDestroyCommandPool(m_device, frame.pool, Wyvern::GetAllocator());
+	m_threads.clear();
+	m_values.clear();
+	m_allocated = m_handedOut = m_resets = 0;
+	m_stalls = 0;
+	m_device = VK_NULL_HANDLE;
+
+	std::lock_guard<std::mutex> liveLock(g_liveMutex);
+	g_liveIds.erase(m_id);
+	g_destroyGeneration.fetch_add(1, std::memory_order_release);
+}
+
+//A thread keeps the pools it was given for each live instance, the lookup is the only thing on the hot path
+WyvCommandPools::ThreadPools *WyvCommandPools::getThreadPools()
+{
+	struct Cache
+	{
+		uint64_t generation = 0;
+		std::vector<std::pair<uint64_t, ThreadPools*>> entries;
+	};
+	static thread_local Cache cache;
+
+	//Entries of destroyed instances would otherwise pile up for as long as the thread lives
+	uint64_t generation = g_destroyGeneration.load(std::memory_order_acquire);
+	if (generation != cache.generation)
+	{
+		std::lock_guard<std::mutex> lock(g_liveMutex);
+		cache.entries.erase(std::remove_if(cache.entries.begin(), cache.entries.end(),
+			[](const std::pair<uint64_t, ThreadPools*> &_entry) { return !g_liveIds.count(_entry.first); }), cache.entries.end());
+		cache.generation = generation;
+	}
+
+	for (const auto &entry : cache.entries)
+		if (entry.first == m_id)
+			return entry.second;
+
+	ThreadPools *pools = createThreadPools();
+	if (pools)
+		cache.entries.push_back(std::make_pair(m_id, pools));
+	return pools;
+}
+
+WyvCommandPools::ThreadPools *WyvCommandPools::createThreadPools()
+{
+	std::unique_ptr<ThreadPools> pools(new ThreadPools());
+	pools->frames.resize(m_frameCount);
+	for (FramePool &frame : pools->frames)
+	{
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = Wyvern::GetQueue(m_role).getFamily();
+		if (vkCreateCommandPool(m_device, &poolInfo, Wyvern::GetAllocator(), &frame.pool) != VK_SUCCESS)
+		{
+			WYV_LOG_ERROR("'{}' command pool creation failed", m_name);
+			for (FramePool &created : pools->frames)
+				if (created.pool)
+					vkDestroyCommandPool(m_device, created.pool, Wyvern::GetAllocator());
+			return nullptr;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_threads.push_back(std::move(pools));
+	WYV_LOG_DEBUG("'{}' created command pools for recording thread {}", m_name, (uint32_t)m_threads.size());
+	return m_threads.back().get();
+}
+
+VkCommandBuffer WyvCommandPools::get(VkCommandBufferLevel _level)
+{
+	if (!m_device)
+		return VK_NULL_HANDLE;
+	ThreadPools *pools = getThreadPools();
+	if (!pools)
+		return VK_NULL_HANDLE;
+
+	//endFrame waited for the slot's previous frame before publishing this one, so its buffers are free to reset
+	uint64_t frameNumber = m_frame.load(std::memory_order_acquire);
+	FramePool &frame = pools->frames[frameNumber % m_frameCount];
+	if (frame.frame != frameNumber)
+	{
+		if (frame.used[0] || frame.used[1])
+		{
+			vkResetCommandPool(m_device, frame.pool, 0);
+			m_resets.fetch_add(1, std::memory_order_relaxed);
+		}
+		frame.used[0] = frame.used[1] = 0;
+		frame.frame = frameNumber;
+	}
+
+	std::vector<VkCommandBuffer> &buffers = frame.buffers[_level];
+	uint32_t &used = frame.used[_level];
+	if (used == buffers.size())
+	{
+		//Grows by half again so a thread settles on its working set within a few frames
+		uint32_t count = std::max<uint32_t>((uint32_t)buffers.size() / 2, 4);
+		VkCommandBufferAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = frame.pool;
+		allocateInfo.level = _level;
+		allocateInfo.commandBufferCount = count;
+		buffers.resize(used + count);
+		if (vkAllocateCommandBuffers(m_device, &allocateInfo, buffers.data() + used) != VK_SUCCESS)
+		{
+			buffers.resize(used);
+			WYV_LOG_ERROR("'{}' command buffer allocation failed", m_name);
+			return VK_NULL_HANDLE;
+		}
+		m_allocated.fetch_add(count, std::memory_order_relaxed);
+	}
+	m_handedOut.fetch_add(1, std::memory_order_relaxed);
+	return buffers[used++];
+}
+
+void WyvCommandPools::endFrame(uint64_t _value)
+{
+	if (!m_device)
+		return;
+	uint64_t frameNumber = m_frame.load(std::memory_order_relaxed);
+	m_values[frameNumber % m_frameCount] = _value;
+
+	uint64_t &pending = m_values[(frameNumber + 1) % m_frameCount];
+	WyvQueue &queue = Wyvern::GetQueue(m_role);
+	if (pending && !queue.isComplete(pending))
+	{
+		m_stalls++;
+		queue.wait(pending);
+	}
+	pending = 0;
+	m_frame.store(frameNumber + 1, std::memory_order_release);
+}
+
+uint32_t WyvCommandPools::getThreadCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return (uint32_t)m_threads.size();
+}
+
+void WyvCommandPools::logStats()
+{
+	uint64_t frames = m_frame.load(std::memory_order_relaxed) - 1;
+	if (!frames)
+		return;
+	WYV_LOG_MESSAGE("'{}': {} frames, {} threads, {} command buffers handed out from {} allocated, {} pool resets, {} stalls",
+		m_name, frames, getThreadCount(), m_handedOut.load(std::memory_order_relaxed), getAllocatedCount(), m_resets.load(std::memory_order_relaxed), m_stalls);
+}
@@ -0,0 +1,88 @@
+#ifndef _H_WYVCOMMANDPOOLS_
+#define _H_WYVCOMMANDPOOLS_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+#include "WyvQueue.h"
+
+namespace wyv
+{
+	//Command buffers for any number of recording threads. Every thread gets its own VkCommandPool per frame slot,
+	//so recording never locks: a thread only takes the mutex the first time it asks for a buffer. Buffers handed out
+	//in a frame stay valid until that frame's submission completes, then the thread's pool for the slot is reset
+	//as a whole the next time it asks for a buffer, and the buffers are handed out again.
+	class WyvCommandPools
+	{
+		struct FramePool
+		{
+			VkCommandPool pool = VK_NULL_HANDLE;
+			//Indexed by VkCommandBufferLevel
+			std::vector<VkCommandBuffer> buffers[2];
+			uint32_t used[2] = {};
+			//The frame the pool was last reset for
+			uint64_t frame = 0;
+		};
+
+		struct ThreadPools
+		{
+			std::vector<FramePool> frames;
+		};
+
+		std::string m_name;
+		VkDevice m_device = VK_NULL_HANDLE;
+		WyvQueueRole m_role = WYV_QUEUE_GRAPHICS;
+		uint64_t m_id = 0;
+		uint32_t m_frameCount = 0;
+
+		std::mutex m_mutex;
+		std::vector<std::unique_ptr<ThreadPools>> m_threads;
+		//Submit value of each slot's last frame
+		std::vector<uint64_t> m_values;
+		std::atomic<uint64_t> m_frame;
+
+		std::atomic<uint64_t> m_allocated, m_handedOut, m_resets;
+		uint32_t m_stalls = 0;
+
+		ThreadPools *getThreadPools();
+		ThreadPools *createThreadPools();
+		VkCommandBuffer get(VkCommandBufferLevel _level);
+
+	public:
+		static const uint32_t DEFAULT_FRAMES = 3;
+
+		WyvCommandPools() : m_frame(1), m_allocated(0), m_handedOut(0), m_resets(0) {}
+		~WyvCommandPools() { destroy(); }
+
+		WyvCommandPools(const WyvCommandPools&) = delete;
+		WyvCommandPools &operator=(const WyvCommandPools&) = delete;
+
+		//_frames is how many frames can be recorded or in flight at once, buffers are for _role's queue family
+		void create(const std::string &_name, WyvQueueRole _role = WYV_QUEUE_GRAPHICS, uint32_t _frames = DEFAULT_FRAMES);
+		//Waits for every frame still in flight
+		void destroy();
+
+		//Unbegun buffers from the calling thread's pool for the current frame, VK_NULL_HANDLE if allocation failed
+		VkCommandBuffer getPrimary() { return get(VK_COMMAND_BUFFER_LEVEL_PRIMARY); }
+		VkCommandBuffer getSecondary() { return get(VK_COMMAND_BUFFER_LEVEL_SECONDARY); }
+
+		//Call once everything recorded this frame is submitted, and only while no thread is getting buffers.
+		//_value is the submit value returned by the role's queue. Waits if the next slot's frame is still in flight.
+		void endFrame(uint64_t _value);
+
+		uint64_t getFrame() const { return m_frame.load(std::memory_order_relaxed); }
+		uint32_t getThreadCount();
+		uint64_t getAllocatedCount() const { return m_allocated.load(std::memory_order_relaxed); }
+		//Times endFrame had to wait for the GPU
+		uint32_t getStallCount() const { return m_stalls; }
+		void logStats();
+	};
+}
+
+#endif //_H_WYVCOMMANDPOOLS_
@@ -0,0 +1,329 @@
+#include "WyvDefragmenter.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+using namespace wyv;
+
+const VkDeviceSize WyvDefragmenter::DEFAULT_BUDGET;
+const uint32_t WyvDefragmenter::IDLE_INTERVAL;
+
+WyvDefragmenter::WyvDefragmenter(VkDeviceSize _bytesPerStep) : m_budget(_bytesPerStep)
+{
+	VkDevice device = Wyvern::GetDevice();
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolInfo.queueFamilyIndex = Wyvern::GetQueue(WYV_QUEUE_TRANSFER).getFamily();
+	if (vkCreateCommandPool(device, &poolInfo, Wyvern::GetAllocator(), &m_commandPool) != VK_SUCCESS)
+		Wyvern::Fail("Defragmenter command pool creation failed");
+
+	VkCommandBufferAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = m_commandPool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+	if (vkAllocateCommandBuffers(device, &allocInfo, &m_commandBuffer) != VK_SUCCESS)
+		Wyvern::Fail("Defragmenter command buffer allocation failed");
+}
+
+WyvDefragmenter::~WyvDefragmenter()
+{
+	finish();
+	vkDestroyCommandPool(Wyvern::GetDevice(), m_commandPool, Wyvern::GetAllocator());
+}
+
+void WyvDefragmenter::step()
+{
+	if (m_batchValue)
+	{
+		if (!Wyvern::GetQueue(WYV_QUEUE_TRANSFER).isComplete(m_batchValue))
+			return;
+		complete();
+	}
+	if (!m_active && m_idleSteps++ % IDLE_INTERVAL)
+		return;
+
+	WyvMemoryStats before;
+	if (!m_active)
+		before = Wyvern::GetMemory().getStats();
+	if (plan())
+	{
+		if (!m_active)
+		{
+			m_active = true;
+			m_before = before;
+			m_runMoves = m_runBytes = m_runBatches = 0;
+			WYV_LOG_DEBUG("Defragmentation started, {} blocks {}% fragmented", m_before.blockCount, m_before.fragmentation * 100.0f);
+		}
+		record();
+		submit();
+	}
+	else if (m_active)
+	{
+		m_active = false;
+		m_idleSteps = 1;
+		WyvMemoryStats after = Wyvern::GetMemory().getStats();
+		WYV_LOG_INFO("Defragmentation moved {} allocations, {} MB in {} steps: {} blocks of {} MB down to {} blocks of {} MB, fragmentation {}% down to {}%",
+			m_runMoves, m_runBytes / (1024 * 1024), m_runBatches, m_before.blockCount, m_before.blockBytes / (1024 * 1024), after.blockCount, after.blockBytes / (1024 * 1024),
+			m_before.fragmentation * 100.0f, after.fragmentation * 100.0f);
+	}
+}
+
+void WyvDefragmenter::finish()
+{
+	if (!m_batchValue)
+		return;
+	Wyvern::GetQueue(WYV_QUEUE_TRANSFER).wait(m_batchValue);
+	complete();
+}
+
+//Picks the least used block of each pool that holds nothing but movable allocations and finds them room elsewhere
+bool WyvDefragmenter::plan()
+{
+	WyvMemory &memory = Wyvern::GetMemory();
+	std::lock_guard<std::mutex> lock(memory.m_mutex);
+	std::unordered_map<WyvMemoryBlock*, std::vector<WyvAllocation*>> movables;
+	for (WyvAllocation *allocation : memory.m_movables)
+		if (allocation->block)
+			movables[allocation->block].push_back(allocation);
+
+	VkDeviceSize budget = m_budget;
+	for (WyvMemory::Pool &pool : memory.m_pools)
+	{
+		if (pool.blocks.size() < 2)
+			continue;
+		WyvMemoryBlock *source = nullptr;
+		for (auto &block : pool.blocks)
+		{
+			auto found = movables.find(block.get());
+			if (found == movables.end() || found->second.size() != block->tlsf.getAllocationCount())
+				continue;
+			if (!source || block->tlsf.getUsed() < source->tlsf.getUsed())
+				source = block.get();
+		}
+		if (!source)
+			continue;
+
+		//Fullest blocks first so free space gathers in the emptiest ones
+		std::vector<WyvMemoryBlock*> targets;
+		for (auto &block : pool.blocks)
+			if (block.get() != source)
+				targets.push_back(block.get());
+		std::sort(targets.begin(), targets.end(), [](WyvMemoryBlock *_a, WyvMemoryBlock *_b) { return _a->tlsf.getUsed() > _b->tlsf.getUsed(); });
+		std::vector<WyvAllocation*> &allocations = movables[source];
+		std::sort(allocations.begin(), allocations.end(), [](WyvAllocation *_a, WyvAllocation *_b) { return _a->size > _b->size; });
+
+		for (WyvAllocation *allocation : allocations)
+		{
+			//An allocation over the budget still moves on its own, or it never would
+			if (allocation->size > budget && !m_moves.empty())
+				break;
+			for (WyvMemoryBlock *target : targets)
+			{
+				VkDeviceSize offset;
+				uint32_t node = target->tlsf.allocate(allocation->size, allocation->movable->requirements.alignment, offset);
+				if (node == WyvTlsf::NONE)
+					continue;
+				if (moveTo(allocation, target, node, offset))
+					budget -= std::min(budget, allocation->size);
+				else
+					target->tlsf.free(node);
+				break;
+			}
+			if (!budget)
+				break;
+		}
+		if (!budget)
+			break;
+	}
+	return !m_moves.empty();
+}
+
+bool WyvDefragmenter::moveTo(WyvAllocation *_allocation, WyvMemoryBlock *_target, uint32_t _node, VkDeviceSize _offset)
+{
+	VkDevice device = Wyvern::GetDevice();
+	WyvMovable *movable = _allocation->movable;
+	Move move = {};
+	move.allocation = _allocation;
+	move.from = _allocation->block;
+	move.fromNode = _allocation->node;
+	move.to = _target;
+	move.toNode = _node;
+	move.toOffset = _offset;
+	move.oldBuffer = _allocation->buffer;
+	move.oldImage = _allocation->image;
+
+	if (_allocation->buffer)
+	{
+		if (vkCreateBuffer(device, &movable->bufferInfo, Wyvern::GetAllocator(), &move.newBuffer) != VK_SUCCESS)
+			return false;
+		vkBindBufferMemory(device, move.newBuffer, _target->memory, _offset);
+	}
+	else
+	{
+		//The contents of an image in an unknown layout can't be carried over
+		if (!_allocation->image || movable->layout == VK_IMAGE_LAYOUT_UNDEFINED)
+			return false;
+		if (vkCreateImage(device, &movable->imageInfo, Wyvern::GetAllocator(), &move.newImage) != VK_SUCCESS)
+			return false;
+		vkBindImageMemory(device, move.newImage, _target->memory, _offset);
+	}
+	m_moves.push_back(move);
+	return true;
+}
+
+void WyvDefragmenter::record()
+{
+	vkResetCommandPool(Wyvern::GetDevice(), m_commandPool, 0);
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(m_commandBuffer, &beginInfo);
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	std::vector<VkImageMemoryBarrier> before, after;
+	for (const Move &move : m_moves)
+	{
+		if (!move.newImage)
+			continue;
+		const WyvMovable *movable = move.allocation->movable;
+		barrier.subresourceRange = { Wyvern::AspectOf(movable->imageInfo.format), 0, movable->imageInfo.mipLevels, 0, movable->imageInfo.arrayLayers };
+
+		barrier.image = move.oldImage;
+		barrier.oldLayout = movable->layout;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		before.push_back(barrier);
+
+		barrier.image = move.newImage;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		before.push_back(barrier);
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = movable->layout;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		after.push_back(barrier);
+	}
+
+	//The semaphore waits cover the other queues, the source stage covers earlier work on a shared queue
+	if (!before.empty())
+		vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, (uint32_t)before.size(), before.data());
+	for (const Move &move : m_moves)
+	{
+		const WyvMovable *movable = move.allocation->movable;
+		if (move.newBuffer)
+		{
+			VkBufferCopy region = { 0, 0, movable->bufferInfo.size };
+			vkCmdCopyBuffer(m_commandBuffer, move.oldBuffer, move.newBuffer, 1, &region);
+			continue;
+		}
+		std::vector<VkImageCopy> regions(movable->imageInfo.mipLevels);
+		for (uint32_t mip = 0; mip < regions.size(); mip++)
+		{
+			VkImageCopy &region = regions[mip];
+			region.srcSubresource = { Wyvern::AspectOf(movable->imageInfo.format), mip, 0, movable->imageInfo.arrayLayers };
+			region.dstSubresource = region.srcSubresource;
+			region.srcOffset = region.dstOffset = { 0, 0, 0 };
+			region.extent = { std::max(movable->imageInfo.extent.width >> mip, 1u), std::max(movable->imageInfo.extent.height >> mip, 1u), std::max(movable->imageInfo.extent.depth >> mip, 1u) };
+		}
+		vkCmdCopyImage(m_commandBuffer, move.oldImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, move.newImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+	}
+	if (!after.empty())
+		vkCmdPipelineBarrier(m_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, (uint32_t)after.size(), after.data());
+	vkEndCommandBuffer(m_commandBuffer);
+}
+
+void WyvDefragmenter::submit()
+{
+	WyvQueue &transfer = Wyvern::GetQueue(WYV_QUEUE_TRANSFER);
+	std::vector<std::pair<WyvQueueRole, WyvQueue*>> others;
+	for (WyvQueueRole role : { WYV_QUEUE_GRAPHICS, WYV_QUEUE_COMPUTE })
+	{
+		WyvQueue *queue = &Wyvern::GetQueue(role);
+		if (queue != &transfer && std::none_of(others.begin(), others.end(), [queue](const std::pair<WyvQueueRole, WyvQueue*> &_other) { return _other.second == queue; }))
+			others.push_back(std::make_pair(role, queue));
+	}
+
+	WyvSubmitInfo info(m_commandBuffer);
+	for (const auto &other : others)
+		if (uint64_t submitted = other.second->getTimeline().getSubmittedValue())
+			info.wait(other.first, submitted, VK_PIPELINE_STAGE_TRANSFER_BIT);
+	m_batchValue = transfer.submit(info);
+	for (const auto &other : others)
+		other.second->waitBeforeNextSubmit(WYV_QUEUE_TRANSFER, m_batchValue, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+
+	//From here on new work uses the new handles, which the waits above order after the copies
+	WyvMemory &memory = Wyvern::GetMemory();
+	{
+		std::lock_guard<std::mutex> lock(memory.m_mutex);
+		for (const Move &move : m_moves)
+		{
+			WyvAllocation *allocation = move.allocation;
+			allocation->memory = move.to->memory;
+			allocation->offset = move.toOffset;
+			allocation->block = move.to;
+			allocation->node = move.toNode;
+			allocation->mapped = move.to->mapped ? move.to->mapped + move.toOffset : nullptr;
+			allocation->buffer = move.newBuffer;
+			allocation->image = move.newImage;
+			allocation->movable->pendingMove = m_batchValue;
+			m_runBytes += allocation->size;
+			m_movedBytes += allocation->size;
+		}
+	}
+	m_runMoves += m_moves.size();
+	m_moveCount += m_moves.size();
+	m_runBatches++;
+	WYV_LOG_DEBUG("Defragmentation step moving {} allocations", (uint32_t)m_moves.size());
+
+	for (const Move &move : m_moves)
+		if (move.allocation->movable->onMove)
+			move.allocation->movable->onMove(move.allocation);
+}
+
+//The old ranges and handles go once the frames submitted before the swap are done with them
+void WyvDefragmenter::complete()
+{
+	WyvMemory &memory = Wyvern::GetMemory();
+	std::vector<Move> moves;
+	moves.swap(m_moves);
+	{
+		std::lock_guard<std::mutex> lock(memory.m_mutex);
+		for (const Move &move : moves)
+			if (memory.m_movables.count(move.allocation) && move.allocation->movable->pendingMove == m_batchValue)
+				move.allocation->movable->pendingMove = 0;
+	}
+	m_batchValue = 0;
+
+	VkDevice device = Wyvern::GetDevice();
+	Wyvern::GetQueue(WYV_QUEUE_GRAPHICS).release([device, moves]()
+	{
+		WyvMemory &memory = Wyvern::GetMemory();
+		for (const Move &move : moves)
+		{
+			if (move.oldBuffer)
+				vkDestroyBuffer(device, move.oldBuffer, Wyvern::GetAllocator());
+			if (move.oldImage)
+				vkDestroyImage(device, move.oldImage, Wyvern::GetAllocator());
+		}
+
+		std::lock_guard<std::mutex> lock(memory.m_mutex);
+		std::vector<WyvMemoryBlock*> sources;
+		for (const Move &move : moves)
+		{
+			move.from->tlsf.free(move.fromNode);
+			if (std::find(sources.begin(), sources.end(), move.from) == sources.end())
+				sources.push_back(move.from);
+		}
+		for (WyvMemoryBlock *block : sources)
+			memory.releaseIfEmpty(memory.m_pools[block->pool], block);
+	});
+}
@@ -0,0 +1,69 @@
+#ifndef _H_WYVDEFRAGMENTER_
+#define _H_WYVDEFRAGMENTER_
+
+#include <vector>
+
+#include "Wyvern.h"
+
+namespace wyv
+{
+	//Compacts movable allocations of WyvMemory a few at a time. Each step empties the least used block of a pool into
+	//the fullest blocks that have room, copying on the transfer queue up to a byte budget. The copies wait for the
+	//work already submitted to the other queues, and their next submissions wait for the copies, so moves stay out
+	//of the way of frames in flight. Handles are swapped when the copies are submitted and the old ones destroyed,
+	//along with emptied blocks, once the graphics work submitted until the copies completed is done.
+	//Movable allocations must not be freed while step runs on another thread.
+	class WyvDefragmenter
+	{
+		struct Move
+		{
+			WyvAllocation *allocation;
+			WyvMemoryBlock *from, *to;
+			uint32_t fromNode, toNode;
+			VkDeviceSize toOffset;
+			VkBuffer oldBuffer, newBuffer;
+			VkImage oldImage, newImage;
+		};
+
+		VkDeviceSize m_budget;
+		VkCommandPool m_commandPool = VK_NULL_HANDLE;
+		VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
+		std::vector<Move> m_moves;
+		uint64_t m_batchValue = 0;
+
+		bool m_active = false;
+		uint32_t m_idleSteps = 0;
+		WyvMemoryStats m_before;
+		uint64_t m_runMoves = 0, m_runBytes = 0, m_runBatches = 0;
+		uint64_t m_moveCount = 0, m_movedBytes = 0;
+
+		bool plan();
+		bool moveTo(WyvAllocation *_allocation, WyvMemoryBlock *_target, uint32_t _node, VkDeviceSize _offset);
+		void record();
+		void submit();
+		void complete();
+
+	public:
+		static const VkDeviceSize DEFAULT_BUDGET = 16 * 1024 * 1024;
+		//Steps between looking for work again once memory is compact
+		static const uint32_t IDLE_INTERVAL = 120;
+
+		WyvDefragmenter(VkDeviceSize _bytesPerStep = DEFAULT_BUDGET);
+		~WyvDefragmenter();
+
+		WyvDefragmenter(const WyvDefragmenter&) = delete;
+		WyvDefragmenter &operator=(const WyvDefragmenter&) = delete;
+
+		//Call once per frame. Finishes the previous batch if it completed and starts the next one.
+		void step();
+		//Waits for the batch in flight
+		void finish();
+
+		void setBudget(VkDeviceSize _bytesPerStep) { m_budget = _bytesPerStep; }
+		bool isActive() const { return m_active; }
+		uint64_t getMoveCount() const { return m_moveCount; }
+		uint64_t getMovedBytes() const { return m_movedBytes; }
+	};
+}
+
+#endif //_H_WYVDEFRAGMENTER_
@@ -0,0 +1,265 @@
+#include "WyvDeviceSelector.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
+#include "Wyvern.h"
+
+using namespace wyv;
+
+const char *WyvDeviceSelector::OVERRIDE_ENVIRONMENT_VARIABLE = "WYVERN_DEVICE";
+
+static const char *DeviceTypeName(VkPhysicalDeviceType _type)
+{
+	switch (_type)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+	case VK_PHYSICAL_DEVICE_TYPE_CPU: return "cpu";
+	default: return "other";
+	}
+}
+
+std::string WyvDeviceCandidate::getUUIDString() const
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string result;
+	for (int i = 0; hasUUID && i < VK_UUID_SIZE; i++)
+	{
+		result += digits[uuid[i] >> 4];
+		result += digits[uuid[i] & 0xF];
+	}
+	return result;
+}
+
+std::string WyvDeviceCandidate::describe() const
+{
+	std::string result = std::string(properties.deviceName) + " (" + DeviceTypeName(properties.deviceType)
+		+ ", " + std::to_string(deviceLocalBytes >> 20) + " MiB device local"
+		+ ", Vulkan " + std::to_string(VK_VERSION_MAJOR(properties.apiVersion)) + "." + std::to_string(VK_VERSION_MINOR(properties.apiVersion)) + "." + std::to_string(VK_VERSION_PATCH(properties.apiVersion))
+		+ ", queues graphics " + std::to_string(graphicsFamily) + " compute " + std::to_string(computeFamily) + " transfer " + std::to_string(transferFamily)
+		+ (timelineSemaphore ? ", timeline semaphores" : "") + (memoryBudget ? ", memory budget" : "")
+		+ (drawIndirectCount ? ", draw indirect count" : "") + ")";
+	if (hasUUID)
+		result += " uuid " + getUUIDString();
+	if (suitable)
+		result += " score " + std::to_string(score);
+	else
+		result += " rejected: " + rejection;
+	return result;
+}
+
+void WyvDeviceSelector::Inspect(VkInstance _instance, WyvDeviceCandidate &_candidate, const std::vector<const char*> &_extensions, bool _requirePresent)
+{
+	VkPhysicalDevice device = _candidate.device;
+	vkGetPhysicalDeviceProperties(device, &_candidate.properties);
+	vkGetPhysicalDeviceFeatures(device, &_candidate.features);
+	vkGetPhysicalDeviceMemoryProperties(device, &_candidate.memory);
+
+	if (_candidate.properties.apiVersion >= VK_API_VERSION_1_1)
+	{
+		VkPhysicalDeviceIDProperties idProperties = {};
+		idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+		VkPhysicalDeviceProperties2 properties2 = {};
+		properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties2.pNext = &idProperties;
+		vkGetPhysicalDeviceProperties2(device, &properties2);
+		memcpy(_candidate.uuid, idProperties.deviceUUID, VK_UUID_SIZE);
+		_candidate.hasUUID = true;
+	}
+
+	for (uint32_t i = 0; i < _candidate.memory.memoryHeapCount; i++)
+		if (_candidate.memory.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+			_candidate.deviceLocalBytes = std::max(_candidate.deviceLocalBytes, _candidate.memory.memoryHeaps[i].size);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+	_candidate.queueFamilies.resize(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, _candidate.queueFamilies.data());
+
+	for (uint32_t i = 0; i < queueFamilyCount; i++)
+	{
+		const VkQueueFamilyProperties &family = _candidate.queueFamilies[i];
+		if (!family.queueCount)
+			continue;
+
+		//Presentation support is queried per platform without a window, WyvWindow confirms it against its real surface
+		bool canPresent = !_requirePresent || glfwGetPhysicalDevicePresentationSupport(_instance, device, i) == GLFW_TRUE;
+		if (_candidate.graphicsFamily < 0 && family.queueFlags & VK_QUEUE_GRAPHICS_BIT && canPresent)
+			_candidate.graphicsFamily = i;
+		else if (_candidate.computeFamily < 0 && family.queueFlags & VK_QUEUE_COMPUTE_BIT && !(family.queueFlags & VK_QUEUE_GRAPHICS_BIT))
+			_candidate.computeFamily = i;
+		else if (_candidate.transferFamily < 0 && family.queueFlags & VK_QUEUE_TRANSFER_BIT && !(family.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+			_candidate.transferFamily = i;
+	}
+
+	uint32_t availableExtensionsCount = 0;
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &availableExtensionsCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(availableExtensionsCount);
+	vkEnumerateDeviceExtensionProperties(device, nullptr, &availableExtensionsCount, availableExtensions.data());
+
+	for (const char *extension : _extensions)
+	{
+		auto found = std::find_if(availableExtensions.begin(), availableExtensions.end(), [extension](const VkExtensionProperties &_props) { return !strcmp(_props.extensionName, extension); });
+		if (found == availableExtensions.end())
+		{
+			_candidate.rejection = std::string("missing ") + extension;
+			return;
+		}
+	}
+
+	bool hasTimelineExtension = std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const VkExtensionProperties &_props) { return !strcmp(_props.extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME); });
+	if (hasTimelineExtension && _candidate.properties.apiVersion >= VK_API_VERSION_1_1)
+	{
+		VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+		timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+		VkPhysicalDeviceFeatures2 features2 = {};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &timelineFeatures;
+		vkGetPhysicalDeviceFeatures2(device, &features2);
+		_candidate.timelineSemaphore = timelineFeatures.timelineSemaphore == VK_TRUE;
+	}
+	//Queried through vkGetPhysicalDeviceMemoryProperties2, which is core from 1.1
+	_candidate.memoryBudget = _candidate.properties.apiVersion >= VK_API_VERSION_1_1 && std::any_of(availableExtensions.begin(), availableExtensions.end(),
+		[](const VkExtensionProperties &_props) { return !strcmp(_props.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME); });
+	_candidate.drawIndirectCount = std::any_of(availableExtensions.begin(), availableExtensions.end(),
+		[](const VkExtensionProperties &_props) { return !strcmp(_props.extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME); });
+
+	if (_candidate.graphicsFamily < 0)
+	{
+		_candidate.rejection = _requirePresent ? "no graphics queue family that can present" : "no graphics queue family";
+		return;
+	}
+
+	_candidate.suitable = true;
+	_candidate.score = Score(_candidate);
+}
+
+long long WyvDeviceSelector::Score(const WyvDeviceCandidate &_candidate)
+{
+	const VkPhysicalDeviceProperties &properties = _candidate.properties;
+	const VkPhysicalDeviceFeatures &features = _candidate.features;
+	long long score = 0;
+
+	//Type outweighs everything else, a software rasterizer only wins when it is alone
+	switch (properties.deviceType)
+	{
+	case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: score += 100000; break;
+	case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: score += 50000; break;
+	case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: score += 20000; break;
+	case VK_PHYSICAL_DEVICE_TYPE_CPU: score += 0; break;
+	default: score += 10000; break;
+	}
+
+	//100 points per GiB, capped so memory can't overturn the device type
+	score += std::min<long long>(_candidate.deviceLocalBytes >> 30, 64) * 100;
+
+	if (_candidate.computeFamily >= 0)
+		score += 2000;
+	if (_candidate.transferFamily >= 0)
+		score += 1500;
+
+	if (properties.apiVersion >= VK_API_VERSION_1_1)
+		score += 1000;
+	if (_candidate.timelineSemaphore)
+		score += 300;
+	if (features.samplerAnisotropy)
+		score += 200;
+	if (features.multiDrawIndirect)
+		score += 300;
+	if (features.drawIndirectFirstInstance)
+		score += 100;
+	if (features.shaderInt64)
+		score += 50;
+	if (features.textureCompressionBC)
+		score += 100;
+	if (features.fillModeNonSolid)
+		score += 50;
+
+	score += properties.limits.maxImageDimension2D / 1024 * 10;
+	score += std::min<uint32_t>(properties.limits.maxBoundDescriptorSets, 32) * 10;
+	score += std::min<uint32_t>(properties.limits.maxComputeSharedMemorySize / 1024, 64) * 5;
+	return score;
+}
+
+bool WyvDeviceSelector::MatchesOverride(const WyvDeviceCandidate &_candidate, size_t _index, const std::string &_override)
+{
+	if (std::all_of(_override.begin(), _override.end(), [](char _c) { return isdigit((unsigned char)_c); }))
+	{
+		//Too long for an index, stoul would throw here
+		errno = 0;
+		unsigned long long index = strtoull(_override.c_str(), nullptr, 10);
+		if (errno == ERANGE || index > SIZE_MAX)
+		{
+			WYV_LOG_WARN("GPU override '{}' is out of range for a device index", _override);
+			return false;
+		}
+		return index == _index;
+	}
+
+	std::string uuid;
+	for (char c : _override)
+		if (c != '-')
+			uuid += (char)tolower((unsigned char)c);
+	if (_candidate.hasUUID && uuid == _candidate.getUUIDString())
+		return true;
+
+	std::string name = _candidate.properties.deviceName, lowerOverride;
+	std::transform(name.begin(), name.end(), name.begin(), [](char _c) { return (char)tolower((unsigned char)_c); });
+	for (char c : _override)
+		lowerOverride += (char)tolower((unsigned char)c);
+	return name.find(lowerOverride) != std::string::npos;
+}
+
+std::vector<WyvDeviceCandidate> WyvDeviceSelector::Evaluate(VkInstance _instance, const std::vector<const char*> &_extensions, bool _requirePresent)
+{
+	uint32_t deviceCount = 0;
+	vkEnumeratePhysicalDevices(_instance, &deviceCount, nullptr);
+	std::vector<VkPhysicalDevice> devices(deviceCount);
+	vkEnumeratePhysicalDevices(_instance, &deviceCount, devices.data());
+
+	std::vector<WyvDeviceCandidate> candidates(deviceCount);
+	for (uint32_t i = 0; i < deviceCount; i++)
+	{
+		candidates[i].device = devices[i];
+		Inspect(_instance, candidates[i], _extensions, _requirePresent);
+		WYV_LOG_INFO("GPU {}: {}", i, candidates[i].describe());
+	}
+	return candidates;
+}
+
+int WyvDeviceSelector::Select(const std::vector<WyvDeviceCandidate> &_candidates, const std::string &_preferred)
+{
+	const char *environment = getenv(OVERRIDE_ENVIRONMENT_VARIABLE);
+	std::string preferred = environment && *environment ? environment : _preferred;
+
+	if (!preferred.empty())
+	{
+		for (size_t i = 0; i < _candidates.size(); i++)
+		{
+			if (_candidates[i].suitable && MatchesOverride(_candidates[i], i, preferred))
+			{
+				WYV_LOG_INFO("Selected GPU {} '{}': matches override '{}'", i, _candidates[i].properties.deviceName, preferred);
+				return (int)i;
+			}
+		}
+		WYV_LOG_WARN("No suitable GPU matches override '{}', falling back to scoring", preferred);
+	}
+
+	int best = -1;
+	for (size_t i = 0; i < _candidates.size(); i++)
+		if (_candidates[i].suitable && (best < 0 || _candidates[i].score > _candidates[best].score))
+			best = (int)i;
+
+	if (best >= 0)
+		WYV_LOG_INFO("Selected GPU {} '{}': highest score {} of {} devices", best, _candidates[best].properties.deviceName, _candidates[best].score, _candidates.size());
+	return best;
+}
@@ -0,0 +1,52 @@
+#ifndef _H_WYVDEVICESELECTOR_
+#define _H_WYVDEVICESELECTOR_
+
+#include <string>
+#include <vector>
+
+#include "WyvVulkanExt.h"
+
+namespace wyv
+{
+	struct WyvDeviceCandidate
+	{
+		VkPhysicalDevice device = VK_NULL_HANDLE;
+		VkPhysicalDeviceProperties properties = {};
+		VkPhysicalDeviceFeatures features = {};
+		VkPhysicalDeviceMemoryProperties memory = {};
+		uint8_t uuid[VK_UUID_SIZE] = {};
+		bool hasUUID = false;
+		std::vector<VkQueueFamilyProperties> queueFamilies;
+
+		//Family indices, -1 if the device has none. Compute and transfer are only set for dedicated families.
+		int graphicsFamily = -1, computeFamily = -1, transferFamily = -1;
+		VkDeviceSize deviceLocalBytes = 0;
+		bool timelineSemaphore = false, memoryBudget = false, drawIndirectCount = false;
+
+		bool suitable = false;
+		std::string rejection;
+		long long score = 0;
+
+		std::string getUUIDString() const;
+		std::string describe() const;
+	};
+
+	//Ranks every physical device instead of taking the first that works. Device type dominates,
+	//then device-local memory, queue family layout, features and limits. An override (device index,
+	//UUID or name substring) from Wyvern::SetPreferredDevice or the WYVERN_DEVICE environment variable wins.
+	class WyvDeviceSelector
+	{
+		static void Inspect(VkInstance _instance, WyvDeviceCandidate &_candidate, const std::vector<const char*> &_extensions, bool _requirePresent);
+		static long long Score(const WyvDeviceCandidate &_candidate);
+		static bool MatchesOverride(const WyvDeviceCandidate &_candidate, size_t _index, const std::string &_override);
+
+	public:
+		static const char *OVERRIDE_ENVIRONMENT_VARIABLE;
+
+		static std::vector<WyvDeviceCandidate> Evaluate(VkInstance _instance, const std::vector<const char*> &_extensions, bool _requirePresent);
+		//Returns the index of the chosen candidate, or -1 if none is suitable
+		static int Select(const std::vector<WyvDeviceCandidate> &_candidates, const std::string &_preferred);
+	};
+}
+
+#endif //_H_WYVDEVICESELECTOR_
@@ -0,0 +1,223 @@
+#include "WyvDrawBatcher.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace wyv;
+
+const uint32_t WyvDrawBatcher::PIPELINE_BITS, WyvDrawBatcher::SET_BITS, WyvDrawBatcher::MESH_BITS, WyvDrawBatcher::MATERIAL_BITS, WyvDrawBatcher::DEPTH_BITS;
+const uint32_t WyvDrawBatcher::MAX_PIPELINES, WyvDrawBatcher::MAX_SETS, WyvDrawBatcher::MAX_MATERIALS, WyvDrawBatcher::MAX_MESHES;
+
+void WyvBatchStats::add(const WyvBatchStats &_other)
+{
+	submitted += _other.submitted;
+	issued += _other.issued;
+	pipelineBinds += _other.pipelineBinds;
+	descriptorBinds += _other.descriptorBinds;
+	vertexBinds += _other.vertexBinds;
+	indexBinds += _other.indexBinds;
+	skippedBinds += _other.skippedBinds;
+}
+
+void WyvDrawBatcher::create(const std::string &_name, uint32_t _instanceStride, uint32_t _instanceBinding)
+{
+	destroy();
+	m_name = _name;
+	m_instanceStride = _instanceStride;
+	m_instanceBinding = _instanceBinding;
+	m_writer = Wyvern::GetStagingRing().createWriter();
+	m_sets.assign(1, VK_NULL_HANDLE);
+	m_materials.assign(1, VK_NULL_HANDLE);
+}
+
+void WyvDrawBatcher::destroy()
+{
+	if (m_name.empty())
+		return;
+	logStats();
+	m_pipelines.clear();
+	m_sets.clear();
+	m_materials.clear();
+	m_meshes.clear();
+	m_draws.clear();
+	m_instanceData.clear();
+	m_lastFlush = m_total = WyvBatchStats();
+	m_flushes = 0;
+	m_writer = WyvStagingWriter();
+	m_name.clear();
+}
+
+uint32_t WyvDrawBatcher::addPipeline(VkPipeline _pipeline, VkPipelineLayout _layout, bool _backToFront)
+{
+	if (m_pipelines.size() >= MAX_PIPELINES)
+		return UINT32_MAX;
+	m_pipelines.push_back({ _pipeline, _layout, _backToFront });
+	return (uint32_t)m_pipelines.size() - 1;
+}
+
+uint32_t WyvDrawBatcher::addDescriptorSet(VkDescriptorSet _set)
+{
+	if (m_sets.size() >= MAX_SETS)
+		return UINT32_MAX;
+	m_sets.push_back(_set);
+	return (uint32_t)m_sets.size() - 1;
+}
+
+uint32_t WyvDrawBatcher::addMaterial(VkDescriptorSet _material)
+{
+	if (m_materials.size() >= MAX_MATERIALS)
+		return UINT32_MAX;
+	m_materials.push_back(_material);
+	return (uint32_t)m_materials.size() - 1;
+}
+
+uint32_t WyvDrawBatcher::addMesh(const WyvBatchMesh &_mesh)
+{
+	if (m_meshes.size() >= MAX_MESHES)
+		return UINT32_MAX;
+	m_meshes.push_back(_mesh);
+	return (uint32_t)m_meshes.size() - 1;
+}
+
+void WyvDrawBatcher::submit(uint32_t _pipeline, uint32_t _set, uint32_t _material, uint32_t _mesh, float _depth, const void *_instanceData)
+{
+	if (_pipeline >= m_pipelines.size() || _set >= m_sets.size() || _material >= m_materials.size() || _mesh >= m_meshes.size())
+	{
+		WYV_LOG_WARN("'{}' draw with an unregistered pipeline, set, material or mesh ignored", m_name);
+		return;
+	}
+
+	float range = m_farDepth - m_nearDepth;
+	float depth = range > 0.0f ? std::min(std::max((_depth - m_nearDepth) / range, 0.0f), 1.0f) : 0.0f;
+	uint32_t quantized = (uint32_t)(depth * ((1u << DEPTH_BITS) - 1));
+
+	Draw draw;
+	draw.key = Field(_pipeline, SET_BITS + MESH_BITS + MATERIAL_BITS + DEPTH_BITS);
+	//Blending needs the depth order, so it comes before any state for back to front pipelines
+	if (m_pipelines[_pipeline].backToFront)
+		draw.key |= Field(((1u << DEPTH_BITS) - 1) - quantized, SET_BITS + MESH_BITS + MATERIAL_BITS) | Field(_set, MESH_BITS + MATERIAL_BITS) | Field(_mesh, MATERIAL_BITS) | _material;
+	else
+		draw.key |= Field(_set, MESH_BITS + MATERIAL_BITS + DEPTH_BITS) | Field(_mesh, MATERIAL_BITS + DEPTH_BITS) | Field(_material, DEPTH_BITS) | quantized;
+	draw.instance = (uint32_t)m_draws.size();
+	m_draws.push_back(draw);
+	size_t offset = m_instanceData.size();
+	m_instanceData.resize(offset + m_instanceStride);
+	if (m_instanceStride)
+		std::memcpy(m_instanceData.data() + offset, _instanceData, m_instanceStride);
+}
+
+uint32_t WyvDrawBatcher::flush(VkCommandBuffer _commandBuffer)
+{
+	WyvBatchStats stats;
+	stats.submitted = m_draws.size();
+	if (m_draws.empty())
+	{
+		m_lastFlush = stats;
+		return 0;
+	}
+
+	//Ties keep submission order so a frame records the same way every time
+	std::sort(m_draws.begin(), m_draws.end(), [](const Draw &_a, const Draw &_b) { return _a.key != _b.key ? _a.key < _b.key : _a.instance < _b.instance; });
+
+	if (m_instanceStride)
+	{
+		WyvStagingAllocation staging = m_writer.allocate(m_draws.size() * m_instanceStride);
+		if (!staging)
+		{
+			Wyvern::Error("'" + m_name + "' has no room for its instance data, " + std::to_string(m_draws.size()) + " draws dropped");
+			m_draws.clear();
+			m_instanceData.clear();
+			m_lastFlush = stats;
+			m_total.add(stats);
+			return 0;
+		}
+		uint8_t *mapped = (uint8_t*)staging.mapped;
+		for (const Draw &draw : m_draws)
+		{
+			std::memcpy(mapped, m_instanceData.data() + (size_t)draw.instance * m_instanceStride, m_instanceStride);
+			mapped += m_instanceStride;
+		}
+		vkCmdBindVertexBuffers(_commandBuffer, m_instanceBinding, 1, &staging.buffer, &staging.offset);
+	}
+
+	VkPipeline boundPipeline = VK_NULL_HANDLE;
+	VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+	uint32_t boundSet = UINT32_MAX, boundMaterial = UINT32_MAX, boundVertex = UINT32_MAX, boundIndex = UINT32_MAX;
+	uint64_t naiveBinds = 0;
+	const uint64_t mask = ~0ull;
+	for (size_t first = 0; first < m_draws.size(); )
+	{
+		uint64_t key = m_draws[first].key;
+		const Pipeline &pipeline = m_pipelines[key >> (SET_BITS + MESH_BITS + MATERIAL_BITS + DEPTH_BITS)];
+		//Back to front draws stay separate, the ones with the same state aren't neighbours in depth
+		size_t end = first + 1;
+		while (!pipeline.backToFront && end < m_draws.size() && (m_draws[end].key >> DEPTH_BITS) == (key >> DEPTH_BITS))
+			end++;
+
+		uint64_t state = pipeline.backToFront ? key : key >> DEPTH_BITS;
+		uint32_t set = (uint32_t)((state >> (MESH_BITS + MATERIAL_BITS)) & (mask >> (64 - SET_BITS)));
+		uint32_t meshIndex = (uint32_t)((state >> MATERIAL_BITS) & (mask >> (64 - MESH_BITS)));
+		uint32_t material = (uint32_t)(state & (mask >> (64 - MATERIAL_BITS)));
+		const WyvBatchMesh &mesh = m_meshes[meshIndex];
+
+		if (pipeline.pipeline != boundPipeline)
+		{
+			vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+			boundPipeline = pipeline.pipeline;
+			stats.pipelineBinds++;
+		}
+		if (pipeline.layout != boundLayout)
+		{
+			boundLayout = pipeline.layout;
+			boundSet = boundMaterial = UINT32_MAX;
+		}
+		if (set && set != boundSet)
+		{
+			vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 0, 1, &m_sets[set], 0, nullptr);
+			boundSet = set;
+			stats.descriptorBinds++;
+		}
+		if (material && material != boundMaterial)
+		{
+			vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.layout, 1, 1, &m_materials[material], 0, nullptr);
+			boundMaterial = material;
+			stats.descriptorBinds++;
+		}
+		//Meshes sharing buffers at the same offsets only differ in their ranges, which the draw takes
+		if (boundVertex == UINT32_MAX || mesh.vertexBuffer != m_meshes[boundVertex].vertexBuffer || mesh.vertexBufferOffset != m_meshes[boundVertex].vertexBufferOffset)
+		{
+			vkCmdBindVertexBuffers(_commandBuffer, 0, 1, &mesh.vertexBuffer, &mesh.vertexBufferOffset);
+			stats.vertexBinds++;
+		}
+		boundVertex = meshIndex;
+		if (boundIndex == UINT32_MAX || mesh.indexBuffer != m_meshes[boundIndex].indexBuffer || mesh.indexBufferOffset != m_meshes[boundIndex].indexBufferOffset
+			|| mesh.indexType != m_meshes[boundIndex].indexType)
+		{
+			vkCmdBindIndexBuffer(_commandBuffer, mesh.indexBuffer, mesh.indexBufferOffset, mesh.indexType);
+			stats.indexBinds++;
+		}
+		boundIndex = meshIndex;
+
+		vkCmdDrawIndexed(_commandBuffer, mesh.indexCount, (uint32_t)(end - first), mesh.firstIndex, mesh.baseVertex, (uint32_t)first);
+		stats.issued++;
+		//What recording every submitted draw on its own would have bound
+		naiveBinds += (end - first) * (3 + (set ? 1 : 0) + (material ? 1 : 0));
+		first = end;
+	}
+	stats.skippedBinds = naiveBinds - (stats.pipelineBinds + stats.descriptorBinds + stats.vertexBinds + stats.indexBinds);
+
+	m_draws.clear();
+	m_instanceData.clear();
+	m_lastFlush = stats;
+	m_total.add(stats);
+	m_flushes++;
+	return (uint32_t)stats.issued;
+}
+
+void WyvDrawBatcher::logStats() const
+{
+	if (!m_flushes)
+		return;
+	WYV_LOG_INFO("'{}': {} draws submitted, {} issued over {} flushes, {} pipeline, {} descriptor set, {} vertex and {} index buffer binds, {} redundant binds skipped",
+		m_name, m_total.submitted, m_total.issued, m_flushes, m_total.pipelineBinds, m_total.descriptorBinds, m_total.vertexBinds, m_total.indexBinds, m_total.skippedBinds);
+}
@@ -0,0 +1,110 @@
+#ifndef _H_WYVDRAWBATCHER_
+#define _H_WYVDRAWBATCHER_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Wyvern.h"
+
+namespace wyv
+{
+	//An indexed mesh in the caller's buffers, drawn from vertex binding 0
+	struct WyvBatchMesh
+	{
+		VkBuffer vertexBuffer = VK_NULL_HANDLE, indexBuffer = VK_NULL_HANDLE;
+		VkDeviceSize vertexBufferOffset = 0, indexBufferOffset = 0;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+		uint32_t indexCount = 0, firstIndex = 0;
+		int32_t baseVertex = 0;
+	};
+
+	//What the batcher did with the draws of one flush, or of all of them
+	struct WyvBatchStats
+	{
+		uint64_t submitted = 0, issued = 0;
+		uint64_t pipelineBinds = 0, descriptorBinds = 0, vertexBinds = 0, indexBinds = 0;
+		//Binds left out because the state was already set
+		uint64_t skippedBinds = 0;
+
+		void add(const WyvBatchStats &_other);
+	};
+
+	//Collects a frame's draws and records them sorted by a 64-bit key of pipeline, descriptor set, mesh, material and
+	//depth. Neighbours that only differ in depth become one instanced draw, their per-instance data packed in key order
+	//into the staging ring and bound at the instance binding, with firstInstance pointing at the draw's first instance.
+	//Back to front pipelines sort by depth right after the pipeline and their draws are never merged.
+	//State is tracked while recording so no pipeline, descriptor set or buffer is bound twice in a row.
+	//Pipelines, sets, materials and meshes are registered once and referred to by the index returned; index 0 of the
+	//descriptor sets and materials means none. Shared sets are bound as set 0 and materials as set 1.
+	//Submit and flush from one thread, or give each recording thread its own batcher; each has its own staging writer.
+	class WyvDrawBatcher
+	{
+		//Bits of each field of the sort key, from the most significant
+		static const uint32_t PIPELINE_BITS = 12, SET_BITS = 10, MESH_BITS = 16, MATERIAL_BITS = 14, DEPTH_BITS = 12;
+
+		struct Pipeline
+		{
+			VkPipeline pipeline;
+			VkPipelineLayout layout;
+			bool backToFront;
+		};
+
+		struct Draw
+		{
+			uint64_t key;
+			uint32_t instance;
+		};
+
+		std::string m_name;
+		uint32_t m_instanceStride = 0, m_instanceBinding = 1;
+		float m_nearDepth = 0.0f, m_farDepth = 1.0f;
+
+		std::vector<Pipeline> m_pipelines;
+		std::vector<VkDescriptorSet> m_sets, m_materials;
+		std::vector<WyvBatchMesh> m_meshes;
+
+		std::vector<Draw> m_draws;
+		std::vector<uint8_t> m_instanceData;
+		WyvStagingWriter m_writer;
+		WyvBatchStats m_lastFlush, m_total;
+		uint64_t m_flushes = 0;
+
+		static uint64_t Field(uint32_t _value, uint32_t _shift) { return (uint64_t)_value << _shift; }
+
+	public:
+		static const uint32_t MAX_PIPELINES = 1u << PIPELINE_BITS, MAX_SETS = 1u << SET_BITS, MAX_MATERIALS = 1u << MATERIAL_BITS, MAX_MESHES = 1u << MESH_BITS;
+
+		WyvDrawBatcher() {}
+		~WyvDrawBatcher() { destroy(); }
+
+		WyvDrawBatcher(const WyvDrawBatcher&) = delete;
+		WyvDrawBatcher &operator=(const WyvDrawBatcher&) = delete;
+
+		//_instanceStride bytes of instance data come with every draw and are read through vertex binding _instanceBinding.
+		//Call after Wyvern::Initialize, the instance data is written through the staging ring.
+		void create(const std::string &_name, uint32_t _instanceStride, uint32_t _instanceBinding = 1);
+		void destroy();
+
+		//Each returns the index to submit with, UINT32_MAX when the table is full. Transparent pipelines sort back to front.
+		uint32_t addPipeline(VkPipeline _pipeline, VkPipelineLayout _layout, bool _backToFront = false);
+		uint32_t addDescriptorSet(VkDescriptorSet _set);
+		uint32_t addMaterial(VkDescriptorSet _material);
+		uint32_t addMesh(const WyvBatchMesh &_mesh);
+
+		//View space depths outside the range are clamped before they are quantized into the key
+		void setDepthRange(float _near, float _far) { m_nearDepth = _near; m_farDepth = _far; }
+		//Queues a draw of one instance, copying _instanceData
+		void submit(uint32_t _pipeline, uint32_t _set, uint32_t _material, uint32_t _mesh, float _depth, const void *_instanceData);
+		//Sorts, merges and records everything submitted since the last flush, then forgets it. Returns the draws issued.
+		//The instance data lives in the staging ring, so it is valid for the frame the command buffer is submitted with.
+		uint32_t flush(VkCommandBuffer _commandBuffer);
+
+		uint32_t getPendingCount() const { return (uint32_t)m_draws.size(); }
+		const WyvBatchStats &getLastFlushStats() const { return m_lastFlush; }
+		const WyvBatchStats &getTotalStats() const { return m_total; }
+		void logStats() const;
+	};
+}
+
+#endif //_H_WYVDRAWBATCHER_
@@ -0,0 +1,57 @@
+#include "WyvFramePacer.h"
+
+#include <algorithm>
+#include <thread>
+
+using namespace wyv;
+
+const float WyvFramePacer::SPIN_MARGIN = 1.0f;
+const float WyvFramePacer::SAFETY_MARGIN = 1.0f;
+
+void WyvFramePacer::setInterval(float _milliseconds)
+{
+	m_interval = std::max(0.0f, _milliseconds);
+	m_started = false;
+}
+
+float WyvFramePacer::wait()
+{
+	Clock::time_point now = Clock::now();
+	if (m_interval <= 0.0f)
+	{
+		m_workStart = now;
+		return 0.0f;
+	}
+
+	auto toDuration = [](float _milliseconds) { return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float, std::milli>(_milliseconds)); };
+	if (!m_started)
+	{
+		m_deadline = now + toDuration(m_interval);
+		m_started = true;
+	}
+
+	Clock::time_point wake = m_deadline - toDuration(m_workEstimate + SAFETY_MARGIN);
+	if (wake > now)
+	{
+		if (wake - now > toDuration(SPIN_MARGIN))
+			std::this_thread::sleep_until(wake - toDuration(SPIN_MARGIN));
+		while (Clock::now() < wake)
+			std::this_thread::yield();
+	}
+
+	Clock::time_point start = Clock::now();
+	m_deadline += toDuration(m_interval);
+	//Fell more than a frame behind, resynchronise rather than rushing to catch up
+	if (m_deadline < start + toDuration(m_workEstimate))
+		m_deadline = start + toDuration(m_interval);
+
+	m_workStart = start;
+	return std::chrono::duration<float, std::milli>(start - now).count();
+}
+
+void WyvFramePacer::endWork()
+{
+	float work = std::chrono::duration<float, std::milli>(Clock::now() - m_workStart).count();
+	//Rise straight to a slow frame, decay slowly, so one spike does not miss several deadlines in a row
+	m_workEstimate = std::max(work, m_workEstimate * 0.95f + work * 0.05f);
+}
@@ -0,0 +1,37 @@
+#ifndef _H_WYVFRAMEPACER_
+#define _H_WYVFRAMEPACER_
+
+#include <chrono>
+
+namespace wyv
+{
+	//Sleeps the CPU so a frame's work starts as late as it can while still finishing by the next deadline,
+	//which keeps the input sampled at the start of the frame fresh instead of queueing frames up ahead of the display
+	class WyvFramePacer
+	{
+		typedef std::chrono::steady_clock Clock;
+
+		Clock::time_point m_deadline, m_workStart;
+		float m_interval = 0.0f, m_workEstimate = 0.0f;
+		bool m_started = false;
+
+	public:
+		//Sleeps within this margin of the wake time are spun instead, OS timers overshoot by about this much
+		static const float SPIN_MARGIN;
+		//Slack left between the predicted end of the work and the deadline
+		static const float SAFETY_MARGIN;
+
+		//0 disables pacing
+		void setInterval(float _milliseconds);
+		float getInterval() const { return m_interval; }
+
+		//Call right before sampling input. Returns the milliseconds slept.
+		float wait();
+		//Call once the frame is presented, updates the estimate of how long a frame's CPU work takes
+		void endWork();
+
+		float getWorkEstimate() const { return m_workEstimate; }
+	};
+}
+
+#endif //_H_WYVFRAMEPACER_
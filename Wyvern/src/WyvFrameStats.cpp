@@ -0,0 +1,53 @@
+#include "WyvFrameStats.h"
+
+#include <algorithm>
+
+using namespace wyv;
+
+void WyvFrameStats::tick()
+{
+	auto now = std::chrono::steady_clock::now();
+	if (m_started)
+		record(std::chrono::duration<float, std::milli>(now - m_last).count());
+	m_last = now;
+	m_started = true;
+}
+
+void WyvFrameStats::record(float _milliseconds)
+{
+	m_samples[m_next] = _milliseconds;
+	m_next = (m_next + 1) % m_samples.size();
+	m_count = std::min(m_count + 1, m_samples.size());
+	m_totalFrames++;
+	if (_milliseconds > m_hitchBudget)
+		m_hitches++;
+}
+
+void WyvFrameStats::reset()
+{
+	m_next = m_count = 0;
+	m_totalFrames = m_hitches = 0;
+	m_started = false;
+}
+
+WyvFrameStats::Summary WyvFrameStats::summarize() const
+{
+	Summary summary = {};
+	summary.samples = m_count;
+	if (!m_count)
+		return summary;
+
+	std::vector<float> sorted(m_samples.begin(), m_samples.begin() + m_count);
+	std::sort(sorted.begin(), sorted.end());
+	auto percentile = [&](float _p) { return sorted[std::min(sorted.size() - 1, (size_t)(_p * sorted.size()))]; };
+
+	float total = 0;
+	for (float sample : sorted)
+		total += sample;
+	summary.average = total / m_count;
+	summary.p50 = percentile(0.50f);
+	summary.p95 = percentile(0.95f);
+	summary.p99 = percentile(0.99f);
+	summary.max = sorted.back();
+	return summary;
+}
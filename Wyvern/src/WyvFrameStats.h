@@ -0,0 +1,44 @@
+#ifndef _H_WYVFRAMESTATS_
+#define _H_WYVFRAMESTATS_
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace wyv
+{
+	//Rolling window of frame times with percentile queries
+	class WyvFrameStats
+	{
+		std::vector<float> m_samples;
+		size_t m_next = 0, m_count = 0;
+		uint64_t m_totalFrames = 0, m_hitches = 0;
+		float m_hitchBudget = 50.0f;
+		std::chrono::steady_clock::time_point m_last;
+		bool m_started = false;
+
+	public:
+		struct Summary
+		{
+			size_t samples;
+			float average, p50, p95, p99, max;
+		};
+
+		WyvFrameStats(size_t _window = 1024) : m_samples(_window) {}
+
+		//Records the time since the previous call
+		void tick();
+		void record(float _milliseconds);
+		void reset();
+		//Frames slower than the budget count as hitches, e.g. a swapchain recreation that stalls
+		void setHitchBudget(float _milliseconds) { m_hitchBudget = _milliseconds; }
+
+		Summary summarize() const;
+		uint64_t getTotalFrames() const { return m_totalFrames; }
+		size_t getSampleCount() const { return m_count; }
+		uint64_t getHitchCount() const { return m_hitches; }
+		float getHitchBudget() const { return m_hitchBudget; }
+	};
+}
+
+#endif //_H_WYVFRAMESTATS_
@@ -0,0 +1,434 @@
+#include "WyvGpuScene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+#include "WyvRenderTarget.h"
+
+using namespace wyv;
+
+const char *WyvGpuScene::DEFAULT_SHADER_PATH = "resources/shaders/WyvCull.comp.spv";
+const uint32_t WyvGpuScene::WORKGROUP_SIZE;
+
+static bool ReadSpirv(const std::string &_path, std::vector<uint32_t> &_code)
+{
+	std::ifstream file(_path, std::ios::binary | std::ios::ate);
+	if (!file)
+		return false;
+	std::streamsize size = file.tellg();
+	if (size <= 0 || size % 4)
+		return false;
+	_code.resize((size_t)size / 4);
+	file.seekg(0);
+	return (bool)file.read((char*)_code.data(), size);
+}
+
+//Gribb-Hartmann planes of a column major matrix, with Vulkan's 0 to 1 depth range
+static void ExtractFrustum(const float _m[16], float _planes[6][4])
+{
+	for (int i = 0; i < 4; i++)
+	{
+		float x = _m[i * 4], y = _m[i * 4 + 1], z = _m[i * 4 + 2], w = _m[i * 4 + 3];
+		_planes[0][i] = w + x;
+		_planes[1][i] = w - x;
+		_planes[2][i] = w + y;
+		_planes[3][i] = w - y;
+		_planes[4][i] = z;
+		_planes[5][i] = w - z;
+	}
+	for (int p = 0; p < 6; p++)
+	{
+		float length = std::sqrt(_planes[p][0] * _planes[p][0] + _planes[p][1] * _planes[p][1] + _planes[p][2] * _planes[p][2]);
+		if (length > 0.0f)
+			for (int i = 0; i < 4; i++)
+				_planes[p][i] /= length;
+	}
+}
+
+VkBuffer WyvGpuScene::createBuffer(VkDeviceSize _size, VkBufferUsageFlags _usage, WyvAllocation *&_memory)
+{
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = _size;
+	bufferInfo.usage = _usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	VkBuffer buffer;
+	if (vkCreateBuffer(m_device, &bufferInfo, Wyvern::GetAllocator(), &buffer) != VK_SUCCESS)
+		return VK_NULL_HANDLE;
+	if (!(_memory = Wyvern::GetMemory().allocateBuffer(buffer, WYV_MEMORY_GPU_ONLY)))
+	{
+		vkDestroyBuffer(m_device, buffer, Wyvern::GetAllocator());
+		return VK_NULL_HANDLE;
+	}
+	return buffer;
+}
+
+bool WyvGpuScene::createPipeline(const std::string &_shaderPath)
+{
+	std::vector<uint32_t> code;
+	if (!ReadSpirv(_shaderPath, code))
+	{
+		Wyvern::Error("GPU scene '" + m_name + "' couldn't read the culling shader " + _shaderPath);
+		return false;
+	}
+	VkShaderModuleCreateInfo moduleInfo = {};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size() * 4;
+	moduleInfo.pCode = code.data();
+	VkShaderModule module;
+	if (vkCreateShaderModule(m_device, &moduleInfo, Wyvern::GetAllocator(), &module) != VK_SUCCESS)
+	{
+		Wyvern::Error("GPU scene '" + m_name + "' culling shader module creation failed");
+		return false;
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = module;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = m_pipelineLayout;
+	VkResult result = vkCreateComputePipelines(m_device, Wyvern::GetPipelineCache(), 1, &pipelineInfo, Wyvern::GetAllocator(), &m_pipeline);
+	vkDestroyShaderModule(m_device, module, Wyvern::GetAllocator());
+	if (result != VK_SUCCESS)
+	{
+		Wyvern::Error("GPU scene '" + m_name + "' culling pipeline creation failed");
+		m_pipeline = VK_NULL_HANDLE;
+		return false;
+	}
+	return true;
+}
+
+bool WyvGpuScene::create(const std::string &_name, uint32_t _maxObjects, uint32_t _maxMeshes, const std::string &_shaderPath)
+{
+	destroy();
+	m_name = _name;
+	m_device = Wyvern::GetDevice();
+	m_maxObjects = std::max(_maxObjects, 1u);
+	m_maxMeshes = std::max(_maxMeshes, 1u);
+	if (!Wyvern::GetEnabledFeatures().drawIndirectFirstInstance)
+	{
+		Wyvern::Error("GPU scene '" + m_name + "' needs drawIndirectFirstInstance, which the device lacks");
+		destroy();
+		return false;
+	}
+	if (!Wyvern::GetStagingRing().getBuffer())
+	{
+		Wyvern::Error("GPU scene '" + m_name + "' uploads through the staging ring, which is disabled");
+		destroy();
+		return false;
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(Wyvern::GetPhysicalDevice(), &properties);
+	m_maxDrawIndirectCount = std::max(properties.limits.maxDrawIndirectCount, 1u);
+	if (Wyvern::SupportsDrawIndirectCount())
+		m_drawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(m_device, "vkCmdDrawIndexedIndirectCountKHR");
+	//The compacted list has a single count, it can't be split across calls like the per-object slots can
+	if (m_drawIndexedIndirectCount && m_maxObjects > m_maxDrawIndirectCount)
+	{
+		WYV_LOG_WARN("GPU scene '{}' holds up to {} objects but one indirect draw is limited to {}, culling without compaction", m_name, m_maxObjects, m_maxDrawIndirectCount);
+		m_drawIndexedIndirectCount = nullptr;
+	}
+
+	m_objectBuffer = createBuffer(m_maxObjects * sizeof(WyvGpuObject), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_objectMemory);
+	m_meshBuffer = createBuffer(m_maxMeshes * sizeof(WyvGpuMesh), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_meshMemory);
+	m_drawBuffer = createBuffer(m_maxObjects * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, m_drawMemory);
+	m_countBuffer = createBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_countMemory);
+	if (!m_objectBuffer || !m_meshBuffer || !m_drawBuffer || !m_countBuffer)
+	{
+		Wyvern::Error("GPU scene '" + m_name + "' is out of memory");
+		destroy();
+		return false;
+	}
+
+	VkDescriptorSetLayoutBinding bindings[4] = {};
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	VkDescriptorSetLayoutCreateInfo setLayoutInfo = {};
+	setLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	setLayoutInfo.bindingCount = 4;
+	setLayoutInfo.pBindings = bindings;
+	VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 };
+	VkDescriptorPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	VkPushConstantRange pushConstants = { VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants) };
+	VkPipelineLayoutCreateInfo layoutInfo = {};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &m_setLayout;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstants;
+	if (vkCreateDescriptorSetLayout(m_device, &setLayoutInfo, Wyvern::GetAllocator(), &m_setLayout) != VK_SUCCESS
+		|| vkCreateDescriptorPool(m_device, &poolInfo, Wyvern::GetAllocator(), &m_descriptorPool) != VK_SUCCESS
+		|| vkCreatePipelineLayout(m_device, &layoutInfo, Wyvern::GetAllocator(), &m_pipelineLayout) != VK_SUCCESS)
+	{
+		Wyvern::Error("GPU scene '" + m_name + "' pipeline layout creation failed");
+		destroy();
+		return false;
+	}
+
+	VkDescriptorSetAllocateInfo setInfo = {};
+	setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setInfo.descriptorPool = m_descriptorPool;
+	setInfo.descriptorSetCount = 1;
+	setInfo.pSetLayouts = &m_setLayout;
+	if (vkAllocateDescriptorSets(m_device, &setInfo, &m_descriptorSet) != VK_SUCCESS)
+	{
+		Wyvern::Error("GPU scene '" + m_name + "' descriptor set allocation failed");
+		destroy();
+		return false;
+	}
+	VkDescriptorBufferInfo bufferInfos[4] = { { m_objectBuffer, 0, VK_WHOLE_SIZE }, { m_meshBuffer, 0, VK_WHOLE_SIZE },
+		{ m_drawBuffer, 0, VK_WHOLE_SIZE }, { m_countBuffer, 0, VK_WHOLE_SIZE } };
+	VkWriteDescriptorSet writes[4] = {};
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writes[i].dstSet = m_descriptorSet;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkUpdateDescriptorSets(m_device, 4, writes, 0, nullptr);
+
+	if (!createPipeline(_shaderPath))
+	{
+		destroy();
+		return false;
+	}
+	//Culls are submitted ahead of the frames drawing them, so this covers every frame the target can have in flight
+	m_commandPools.create(m_name, WYV_QUEUE_GRAPHICS, WyvRenderTarget::MAX_FRAMES_IN_FLIGHT + 1);
+
+	WYV_LOG_MESSAGE("GPU scene '{}' created for {} objects, {}", m_name, m_maxObjects,
+		m_drawIndexedIndirectCount ? "compacted with draw indirect count" : Wyvern::GetEnabledFeatures().multiDrawIndirect ? "multi draw indirect without a count" : "one indirect draw per object");
+	return true;
+}
+
+//Draws of frames still in flight may read the buffers, so they go once the graphics queue is past them
+void WyvGpuScene::destroy()
+{
+	if (!m_device)
+		return;
+	m_commandPools.destroy();
+	if (m_culls)
+		WYV_LOG_MESSAGE("GPU scene '{}': {} objects, {} culls, {} KB uploaded", m_name, (uint32_t)m_objects.size(), m_culls, m_uploadedBytes / 1024);
+
+	VkDevice device = m_device;
+	std::vector<VkBuffer> buffers = { m_objectBuffer, m_meshBuffer, m_drawBuffer, m_countBuffer };
+	std::vector<WyvAllocation*> allocations = { m_objectMemory, m_meshMemory, m_drawMemory, m_countMemory };
+	VkPipeline pipeline = m_pipeline;
+	VkPipelineLayout pipelineLayout = m_pipelineLayout;
+	VkDescriptorPool descriptorPool = m_descriptorPool;
+	VkDescriptorSetLayout setLayout = m_setLayout;
+	Wyvern::GetQueue(WYV_QUEUE_GRAPHICS).release([device, buffers, allocations, pipeline, pipelineLayout, descriptorPool, setLayout]()
+	{
+		for (VkBuffer buffer : buffers)
+			if (buffer)
+				vkDestroyBuffer(device, buffer, Wyvern::GetAllocator());
+		for (WyvAllocation *allocation : allocations)
+			if (allocation)
+				Wyvern::GetMemory().free(allocation);
+		if (pipeline)
+			vkDestroyPipeline(device, pipeline, Wyvern::GetAllocator());
+		if (pipelineLayout)
+			vkDestroyPipelineLayout(device, pipelineLayout, Wyvern::GetAllocator());
+		if (descriptorPool)
+			vkDestroyDescriptorPool(device, descriptorPool, Wyvern::GetAllocator());
+		if (setLayout)
+			vkDestroyDescriptorSetLayout(device, setLayout, Wyvern::GetAllocator());
+	});
+
+	m_objectBuffer = m_meshBuffer = m_drawBuffer = m_countBuffer = VK_NULL_HANDLE;
+	m_objectMemory = m_meshMemory = m_drawMemory = m_countMemory = nullptr;
+	m_pipeline = VK_NULL_HANDLE;
+	m_pipelineLayout = VK_NULL_HANDLE;
+	m_descriptorPool = VK_NULL_HANDLE;
+	m_descriptorSet = VK_NULL_HANDLE;
+	m_setLayout = VK_NULL_HANDLE;
+	m_drawIndexedIndirectCount = nullptr;
+	m_objects.clear();
+	m_meshes.clear();
+	m_dirtyBegin = m_dirtyEnd = m_dirtyMeshBegin = m_dirtyMeshEnd = 0;
+	m_culls = m_uploadedBytes = 0;
+	m_device = VK_NULL_HANDLE;
+}
+
+void WyvGpuScene::markDirty(uint32_t _index)
+{
+	if (m_dirtyBegin == m_dirtyEnd)
+	{
+		m_dirtyBegin = _index;
+		m_dirtyEnd = _index + 1;
+	}
+	else
+	{
+		m_dirtyBegin = std::min(m_dirtyBegin, _index);
+		m_dirtyEnd = std::max(m_dirtyEnd, _index + 1);
+	}
+}
+
+uint32_t WyvGpuScene::addMesh(const WyvGpuMesh &_mesh)
+{
+	if (m_meshes.size() >= m_maxMeshes)
+		return UINT32_MAX;
+	uint32_t index = (uint32_t)m_meshes.size();
+	m_meshes.push_back(_mesh);
+	m_dirtyMeshBegin = m_dirtyMeshBegin == m_dirtyMeshEnd ? index : std::min(m_dirtyMeshBegin, index);
+	m_dirtyMeshEnd = index + 1;
+	return index;
+}
+
+uint32_t WyvGpuScene::addObject(const WyvGpuObject &_object)
+{
+	if (m_objects.size() >= m_maxObjects)
+		return UINT32_MAX;
+	m_objects.push_back(_object);
+	markDirty((uint32_t)m_objects.size() - 1);
+	return (uint32_t)m_objects.size() - 1;
+}
+
+void WyvGpuScene::updateObject(uint32_t _index, const WyvGpuObject &_object)
+{
+	m_objects[_index] = _object;
+	markDirty(_index);
+}
+
+void WyvGpuScene::setTransform(uint32_t _index, const float _transform[16])
+{
+	std::memcpy(m_objects[_index].transform, _transform, sizeof(m_objects[_index].transform));
+	markDirty(_index);
+}
+
+uint32_t WyvGpuScene::removeObject(uint32_t _index)
+{
+	if (_index >= m_objects.size())
+		return UINT32_MAX;
+	uint32_t last = (uint32_t)m_objects.size() - 1;
+	if (_index != last)
+	{
+		m_objects[_index] = m_objects[last];
+		markDirty(_index);
+	}
+	m_objects.pop_back();
+	m_dirtyEnd = std::min(m_dirtyEnd, last);
+	if (m_dirtyBegin >= m_dirtyEnd)
+		m_dirtyBegin = m_dirtyEnd = 0;
+	return last;
+}
+
+void WyvGpuScene::clearObjects()
+{
+	m_objects.clear();
+	m_dirtyBegin = m_dirtyEnd = 0;
+}
+
+bool WyvGpuScene::upload(VkCommandBuffer _commandBuffer, VkBuffer _target, const void *_data, VkDeviceSize _offset, VkDeviceSize _size)
+{
+	WyvStagingAllocation staging = Wyvern::GetStagingRing().allocate(_size);
+	if (!staging)
+		return false;
+	std::memcpy(staging.mapped, _data, (size_t)_size);
+	VkBufferCopy region = { staging.offset, _offset, _size };
+	vkCmdCopyBuffer(_commandBuffer, staging.buffer, _target, 1, &region);
+	m_uploadedBytes += _size;
+	return true;
+}
+
+void WyvGpuScene::recordCull(VkCommandBuffer _commandBuffer, const float _viewProjection[16])
+{
+	if (!m_pipeline)
+		return;
+
+	//Earlier draws and culls are done with what this one overwrites
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	//Pieces of a quarter of the ring at most, what doesn't fit this frame goes with the next
+	VkDeviceSize piece = std::max<VkDeviceSize>(Wyvern::GetStagingRing().getSize() / 4, sizeof(WyvGpuObject));
+	uint32_t perPiece = (uint32_t)(piece / sizeof(WyvGpuObject));
+	while (m_dirtyBegin < m_dirtyEnd)
+	{
+		uint32_t count = std::min(perPiece, m_dirtyEnd - m_dirtyBegin);
+		if (!upload(_commandBuffer, m_objectBuffer, &m_objects[m_dirtyBegin], m_dirtyBegin * sizeof(WyvGpuObject), count * sizeof(WyvGpuObject)))
+			break;
+		m_dirtyBegin += count;
+	}
+	if (m_dirtyBegin >= m_dirtyEnd)
+		m_dirtyBegin = m_dirtyEnd = 0;
+	if (m_dirtyMeshBegin < m_dirtyMeshEnd && upload(_commandBuffer, m_meshBuffer, &m_meshes[m_dirtyMeshBegin], m_dirtyMeshBegin * sizeof(WyvGpuMesh),
+		(m_dirtyMeshEnd - m_dirtyMeshBegin) * sizeof(WyvGpuMesh)))
+		m_dirtyMeshBegin = m_dirtyMeshEnd = 0;
+	vkCmdFillBuffer(_commandBuffer, m_countBuffer, 0, sizeof(uint32_t), 0);
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	CullConstants constants = {};
+	ExtractFrustum(_viewProjection, constants.planes);
+	constants.objectCount = (uint32_t)m_objects.size();
+	constants.compact = m_drawIndexedIndirectCount ? 1 : 0;
+	if (constants.objectCount)
+	{
+		vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+		vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
+		vkCmdPushConstants(_commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+		vkCmdDispatch(_commandBuffer, (constants.objectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+	}
+
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+	m_culls++;
+}
+
+uint64_t WyvGpuScene::cull(const float _viewProjection[16])
+{
+	VkCommandBuffer commandBuffer = m_commandPools.getPrimary();
+	if (!commandBuffer)
+		return 0;
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	recordCull(commandBuffer, _viewProjection);
+	vkEndCommandBuffer(commandBuffer);
+
+	uint64_t value = Wyvern::Submit(WYV_QUEUE_GRAPHICS, WyvSubmitInfo(commandBuffer));
+	m_commandPools.endFrame(value);
+	return value;
+}
+
+void WyvGpuScene::draw(VkCommandBuffer _commandBuffer) const
+{
+	uint32_t count = (uint32_t)m_objects.size();
+	if (!count || !m_pipeline)
+		return;
+	const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+	if (m_drawIndexedIndirectCount)
+	{
+		m_drawIndexedIndirectCount(_commandBuffer, m_drawBuffer, 0, m_countBuffer, 0, count, stride);
+		return;
+	}
+	uint32_t perCall = Wyvern::GetEnabledFeatures().multiDrawIndirect ? m_maxDrawIndirectCount : 1;
+	for (uint32_t first = 0; first < count; first += perCall)
+		vkCmdDrawIndexedIndirect(_commandBuffer, m_drawBuffer, first * stride, std::min(perCall, count - first), stride);
+}
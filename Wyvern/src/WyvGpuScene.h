@@ -0,0 +1,113 @@
+#ifndef _H_WYVGPUSCENE_
+#define _H_WYVGPUSCENE_
+
+#include <string>
+#include <vector>
+
+#include "Wyvern.h"
+#include "WyvCommandPools.h"
+
+namespace wyv
+{
+	//An object as the culling shader reads it, in std430 layout
+	struct WyvGpuObject
+	{
+		float transform[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f }; //Column major, object to world
+		float center[3] = {}; //Object space bounding sphere
+		float radius = 0.0f;
+		uint32_t mesh = 0;
+		uint32_t padding[3] = {};
+	};
+	static_assert(sizeof(WyvGpuObject) == 96, "WyvGpuObject must match the culling shader's layout");
+
+	//A range of the index buffer, which is the caller's
+	struct WyvGpuMesh
+	{
+		uint32_t indexCount = 0, firstIndex = 0;
+		int32_t vertexOffset = 0;
+		uint32_t padding = 0;
+	};
+
+	//Objects whose bounds, transforms and meshes live in GPU storage buffers. Every frame a compute pass frustum culls
+	//them and writes the indexed indirect draws of the visible ones, so the CPU cost of a frame no longer grows with
+	//the object count; only objects changed since the last cull are uploaded, through the staging ring.
+	//Each draw's firstInstance is its object's index, which the vertex shader uses to read the transform from
+	//getObjectBuffer(). Draws are compacted and counted on the GPU with VK_KHR_draw_indirect_count; without it every
+	//object keeps a draw and culled ones have no instances.
+	class WyvGpuScene
+	{
+		struct CullConstants
+		{
+			float planes[6][4];
+			uint32_t objectCount, compact;
+		};
+
+		std::string m_name;
+		VkDevice m_device = VK_NULL_HANDLE;
+		uint32_t m_maxObjects = 0, m_maxMeshes = 0, m_maxDrawIndirectCount = 1;
+		PFN_vkCmdDrawIndexedIndirectCountKHR m_drawIndexedIndirectCount = nullptr;
+
+		VkBuffer m_objectBuffer = VK_NULL_HANDLE, m_meshBuffer = VK_NULL_HANDLE, m_drawBuffer = VK_NULL_HANDLE, m_countBuffer = VK_NULL_HANDLE;
+		WyvAllocation *m_objectMemory = nullptr, *m_meshMemory = nullptr, *m_drawMemory = nullptr, *m_countMemory = nullptr;
+		VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+		VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+		VkDescriptorSet m_descriptorSet = VK_NULL_HANDLE;
+		VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline m_pipeline = VK_NULL_HANDLE;
+		WyvCommandPools m_commandPools;
+
+		std::vector<WyvGpuObject> m_objects;
+		std::vector<WyvGpuMesh> m_meshes;
+		//Ranges changed since the last upload, begin == end when there is nothing to upload
+		uint32_t m_dirtyBegin = 0, m_dirtyEnd = 0, m_dirtyMeshBegin = 0, m_dirtyMeshEnd = 0;
+		uint64_t m_culls = 0, m_uploadedBytes = 0;
+
+		VkBuffer createBuffer(VkDeviceSize _size, VkBufferUsageFlags _usage, WyvAllocation *&_memory);
+		bool createPipeline(const std::string &_shaderPath);
+		bool upload(VkCommandBuffer _commandBuffer, VkBuffer _target, const void *_data, VkDeviceSize _offset, VkDeviceSize _size);
+		void markDirty(uint32_t _index);
+
+	public:
+		static const char *DEFAULT_SHADER_PATH;
+		static const uint32_t WORKGROUP_SIZE = 64;
+
+		WyvGpuScene() {}
+		~WyvGpuScene() { destroy(); }
+
+		WyvGpuScene(const WyvGpuScene&) = delete;
+		WyvGpuScene &operator=(const WyvGpuScene&) = delete;
+
+		//Needs the staging ring and drawIndirectFirstInstance. Returns false if the scene can't be drawn on this device.
+		bool create(const std::string &_name, uint32_t _maxObjects, uint32_t _maxMeshes = 4096, const std::string &_shaderPath = DEFAULT_SHADER_PATH);
+		//Waits for every cull in flight
+		void destroy();
+
+		//Returns the mesh's index, or UINT32_MAX when the scene is full
+		uint32_t addMesh(const WyvGpuMesh &_mesh);
+		//Returns the object's index, or UINT32_MAX when the scene is full
+		uint32_t addObject(const WyvGpuObject &_object);
+		void updateObject(uint32_t _index, const WyvGpuObject &_object);
+		void setTransform(uint32_t _index, const float _transform[16]);
+		//Moves the last object into the hole, returns the index it had so callers can follow it, UINT32_MAX if _index is out of range
+		uint32_t removeObject(uint32_t _index);
+		void clearObjects();
+
+		//Uploads what changed and culls against _viewProjection (column major, Vulkan clip space). Records into
+		//_commandBuffer outside of any render pass; the results are ready for draws in later commands of the same queue.
+		void recordCull(VkCommandBuffer _commandBuffer, const float _viewProjection[16]);
+		//recordCull in a command buffer of its own, submitted to the graphics queue right away. Call before the frame that
+		//draws the scene is submitted, the staging ring's endFrame for that frame also covers the uploads.
+		uint64_t cull(const float _viewProjection[16]);
+		//Draws the culled objects, with the caller's pipeline, vertex and index buffers bound
+		void draw(VkCommandBuffer _commandBuffer) const;
+
+		uint32_t getObjectCount() const { return (uint32_t)m_objects.size(); }
+		const WyvGpuObject &getObject(uint32_t _index) const { return m_objects[_index]; }
+		VkBuffer getObjectBuffer() const { return m_objectBuffer; }
+		VkBuffer getDrawBuffer() const { return m_drawBuffer; }
+		VkBuffer getCountBuffer() const { return m_countBuffer; }
+		bool isCompacted() const { return m_drawIndexedIndirectCount != nullptr; }
+	};
+}
+
+#endif //_H_WYVGPUSCENE_
@@ -0,0 +1,288 @@
+#include "WyvHostAllocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "Wyvern.h"
+
+using namespace wyv;
+
+const uint32_t WyvHostAllocator::SCOPE_COUNT;
+const size_t WyvHostAllocator::POOL_LIMIT, WyvHostAllocator::ARENA_CHUNK_SIZE;
+
+enum HostSource : uint8_t { SOURCE_HEAP, SOURCE_POOL, SOURCE_ARENA };
+
+//Sits right in front of every pointer handed to the driver
+struct HostHeader
+{
+	void *owner; //The malloc'd block for heap and pool allocations, the arena chunk otherwise
+	uint32_t size;
+	uint8_t source, scope, sizeClass, padding;
+};
+static_assert(sizeof(HostHeader) == 16, "Host allocation header must keep 16 byte alignment");
+
+static const uint32_t POOL_CLASSES = 7; //64 byte to 4 KB blocks
+static const uint32_t POOL_CACHE_DEPTH = 64;
+
+//Referenced by every allocation in it plus the thread bump allocating from it
+struct ArenaChunk
+{
+	std::atomic<uint32_t> refs;
+};
+
+static void ReleaseChunk(ArenaChunk *_chunk)
+{
+	if (_chunk && _chunk->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		_chunk->~ArenaChunk();
+		std::free(_chunk);
+	}
+}
+
+//Per thread so neither the pools nor the arenas ever lock. Blocks freed on another thread join that thread's cache.
+struct HostThreadCache
+{
+	void *pool[POOL_CLASSES] = {};
+	uint32_t poolCount[POOL_CLASSES] = {};
+	ArenaChunk *chunk = nullptr;
+	uint8_t *cursor = nullptr, *end = nullptr;
+
+	~HostThreadCache()
+	{
+		for (uint32_t i = 0; i < POOL_CLASSES; i++)
+			while (pool[i])
+			{
+				void *next = *(void**)pool[i];
+				std::free(pool[i]);
+				pool[i] = next;
+			}
+		ReleaseChunk(chunk);
+	}
+};
+
+static thread_local HostThreadCache g_threadCache;
+
+static uint8_t *AlignPointer(uint8_t *_pointer, size_t _alignment)
+{
+	return (uint8_t*)(((uintptr_t)_pointer + _alignment - 1) / _alignment * _alignment);
+}
+
+//Places the header in front of the aligned pointer, _base must have room for the header and the alignment padding
+static void *Place(uint8_t *_base, void *_owner, size_t _size, size_t _alignment, HostSource _source, VkSystemAllocationScope _scope, uint8_t _sizeClass)
+{
+	uint8_t *pointer = AlignPointer(_base + sizeof(HostHeader), _alignment);
+	HostHeader *header = (HostHeader*)pointer - 1;
+	header->owner = _owner;
+	header->size = (uint32_t)_size;
+	header->source = _source;
+	header->scope = (uint8_t)_scope;
+	header->sizeClass = _sizeClass;
+	header->padding = 0;
+	return pointer;
+}
+
+WyvHostAllocator::WyvHostAllocator()
+{
+	for (Counters &counters : m_counters)
+	{
+		counters.live = counters.peak = counters.allocations = 0;
+		counters.internalLive = counters.internalPeak = 0;
+	}
+	m_callbacks.pUserData = this;
+	m_callbacks.pfnAllocation = &Allocation;
+	m_callbacks.pfnReallocation = &Reallocation;
+	m_callbacks.pfnFree = &Free;
+	m_callbacks.pfnInternalAllocation = &InternalAllocation;
+	m_callbacks.pfnInternalFree = &InternalFree;
+}
+
+void WyvHostAllocator::track(std::atomic<uint64_t> &_live, std::atomic<uint64_t> &_peak, int64_t _bytes)
+{
+	uint64_t live = _live.fetch_add((uint64_t)_bytes, std::memory_order_relaxed) + (uint64_t)_bytes;
+	if (_bytes <= 0)
+		return;
+	uint64_t peak = _peak.load(std::memory_order_relaxed);
+	while (live > peak && !_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed));
+}
+
+void *WyvHostAllocator::allocate(size_t _size, size_t _alignment, VkSystemAllocationScope _scope)
+{
+	if (_size == 0 || _size > UINT32_MAX || (uint32_t)_scope >= SCOPE_COUNT)
+		return nullptr;
+	_alignment = std::max<size_t>(_alignment, sizeof(HostHeader));
+	//Enough for the header and any misalignment of the base, whatever alignment malloc gives
+	size_t needed = _size + sizeof(HostHeader) + _alignment - 1;
+	HostThreadCache &cache = g_threadCache;
+	void *pointer = nullptr;
+
+	if (_scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND && needed <= POOL_LIMIT)
+	{
+		uint8_t sizeClass = 0;
+		while (((size_t)64 << sizeClass) < needed)
+			sizeClass++;
+		void *block = cache.pool[sizeClass];
+		if (block)
+		{
+			cache.pool[sizeClass] = *(void**)block;
+			cache.poolCount[sizeClass]--;
+		}
+		else if (!(block = std::malloc((size_t)64 << sizeClass)))
+			return nullptr;
+		pointer = Place((uint8_t*)block, block, _size, _alignment, SOURCE_POOL, _scope, sizeClass);
+	}
+	else if (_scope == VK_SYSTEM_ALLOCATION_SCOPE_OBJECT && needed <= ARENA_CHUNK_SIZE / 4)
+	{
+		//No arithmetic on the cursor until there is a chunk behind it
+		if (!cache.chunk || AlignPointer(cache.cursor + sizeof(HostHeader), _alignment) + _size > cache.end)
+		{
+			uint8_t *memory = (uint8_t*)std::malloc(ARENA_CHUNK_SIZE);
+			if (!memory)
+				return nullptr;
+			ArenaChunk *chunk = new (memory) ArenaChunk();
+			chunk->refs.store(1, std::memory_order_relaxed);
+			ReleaseChunk(cache.chunk);
+			cache.chunk = chunk;
+			cache.cursor = memory + sizeof(ArenaChunk);
+			cache.end = memory + ARENA_CHUNK_SIZE;
+		}
+		cache.chunk->refs.fetch_add(1, std::memory_order_relaxed);
+		pointer = Place(cache.cursor, cache.chunk, _size, _alignment, SOURCE_ARENA, _scope, 0);
+		cache.cursor = (uint8_t*)pointer + _size;
+	}
+	else
+	{
+		void *block = std::malloc(needed);
+		if (!block)
+			return nullptr;
+		pointer = Place((uint8_t*)block, block, _size, _alignment, SOURCE_HEAP, _scope, 0);
+	}
+
+	Counters &counters = m_counters[_scope];
+	counters.allocations.fetch_add(1, std::memory_order_relaxed);
+	track(counters.live, counters.peak, (int64_t)_size);
+	return pointer;
+}
+
+void *WyvHostAllocator::reallocate(void *_original, size_t _size, size_t _alignment, VkSystemAllocationScope _scope)
+{
+	if (!_original)
+		return allocate(_size, _alignment, _scope);
+	if (_size == 0)
+	{
+		free(_original);
+		return nullptr;
+	}
+	//The original has to survive a failed reallocation
+	void *pointer = allocate(_size, _alignment, _scope);
+	if (pointer)
+	{
+		memcpy(pointer, _original, std::min<size_t>(((HostHeader*)_original - 1)->size, _size));
+		free(_original);
+	}
+	return pointer;
+}
+
+void WyvHostAllocator::free(void *_memory)
+{
+	if (!_memory)
+		return;
+	HostHeader *header = (HostHeader*)_memory - 1;
+	Counters &counters = m_counters[header->scope];
+	track(counters.live, counters.peak, -(int64_t)header->size);
+
+	switch (header->source)
+	{
+	case SOURCE_POOL:
+	{
+		HostThreadCache &cache = g_threadCache;
+		if (cache.poolCount[header->sizeClass] < POOL_CACHE_DEPTH)
+		{
+			void *block = header->owner;
+			*(void**)block = cache.pool[header->sizeClass];
+			cache.pool[header->sizeClass] = block;
+			cache.poolCount[header->sizeClass]++;
+		}
+		else
+			std::free(header->owner);
+		break;
+	}
+	case SOURCE_ARENA:
+		ReleaseChunk((ArenaChunk*)header->owner);
+		break;
+	default:
+		std::free(header->owner);
+		break;
+	}
+}
+
+VKAPI_ATTR void *VKAPI_CALL WyvHostAllocator::Allocation(void *_userData, size_t _size, size_t _alignment, VkSystemAllocationScope _scope)
+{
+	return ((WyvHostAllocator*)_userData)->allocate(_size, _alignment, _scope);
+}
+
+VKAPI_ATTR void *VKAPI_CALL WyvHostAllocator::Reallocation(void *_userData, void *_original, size_t _size, size_t _alignment, VkSystemAllocationScope _scope)
+{
+	return ((WyvHostAllocator*)_userData)->reallocate(_original, _size, _alignment, _scope);
+}
+
+VKAPI_ATTR void VKAPI_CALL WyvHostAllocator::Free(void *_userData, void *_memory)
+{
+	((WyvHostAllocator*)_userData)->free(_memory);
+}
+
+VKAPI_ATTR void VKAPI_CALL WyvHostAllocator::InternalAllocation(void *_userData, size_t _size, VkInternalAllocationType /*_type*/, VkSystemAllocationScope _scope)
+{
+	WyvHostAllocator *allocator = (WyvHostAllocator*)_userData;
+	if ((uint32_t)_scope < SCOPE_COUNT)
+		allocator->track(allocator->m_counters[_scope].internalLive, allocator->m_counters[_scope].internalPeak, (int64_t)_size);
+}
+
+VKAPI_ATTR void VKAPI_CALL WyvHostAllocator::InternalFree(void *_userData, size_t _size, VkInternalAllocationType /*_type*/, VkSystemAllocationScope _scope)
+{
+	WyvHostAllocator *allocator = (WyvHostAllocator*)_userData;
+	if ((uint32_t)_scope < SCOPE_COUNT)
+		allocator->track(allocator->m_counters[_scope].internalLive, allocator->m_counters[_scope].internalPeak, -(int64_t)_size);
+}
+
+WyvHostAllocationStats WyvHostAllocator::getStats(VkSystemAllocationScope _scope) const
+{
+	WyvHostAllocationStats stats;
+	if ((uint32_t)_scope >= SCOPE_COUNT)
+		return stats;
+	const Counters &counters = m_counters[_scope];
+	stats.live = counters.live.load(std::memory_order_relaxed);
+	stats.peak = counters.peak.load(std::memory_order_relaxed);
+	stats.allocations = counters.allocations.load(std::memory_order_relaxed);
+	stats.internalLive = counters.internalLive.load(std::memory_order_relaxed);
+	stats.internalPeak = counters.internalPeak.load(std::memory_order_relaxed);
+	return stats;
+}
+
+void WyvHostAllocator::logStats() const
+{
+	for (uint32_t scope = 0; scope < SCOPE_COUNT; scope++)
+	{
+		WyvHostAllocationStats stats = getStats((VkSystemAllocationScope)scope);
+		if (!stats.allocations && !stats.internalPeak)
+			continue;
+		WYV_LOG_INFO("Driver host memory, {} scope: {} allocations, peak {} KB, {} KB live, internal peak {} KB", ScopeName((VkSystemAllocationScope)scope),
+			stats.allocations, (double)stats.peak / 1024.0, (double)stats.live / 1024.0, (double)stats.internalPeak / 1024.0);
+		if (stats.live)
+			WYV_LOG_WARN("Driver still holds {} bytes of {} scope host memory", stats.live, ScopeName((VkSystemAllocationScope)scope));
+	}
+}
+
+const char *WyvHostAllocator::ScopeName(VkSystemAllocationScope _scope)
+{
+	switch (_scope)
+	{
+	case VK_SYSTEM_ALLOCATION_SCOPE_COMMAND: return "command";
+	case VK_SYSTEM_ALLOCATION_SCOPE_OBJECT: return "object";
+	case VK_SYSTEM_ALLOCATION_SCOPE_CACHE: return "cache";
+	case VK_SYSTEM_ALLOCATION_SCOPE_DEVICE: return "device";
+	case VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE: return "instance";
+	default: return "unknown";
+	}
+}
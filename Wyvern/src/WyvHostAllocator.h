@@ -0,0 +1,60 @@
+#ifndef _H_WYVHOSTALLOCATOR_
+#define _H_WYVHOSTALLOCATOR_
+
+#include <atomic>
+#include <cstdint>
+
+#include "vulkan/vulkan.h"
+
+namespace wyv
+{
+	//Bytes the driver holds in one VkSystemAllocationScope. Internal ones are allocated by the driver itself and only reported.
+	struct WyvHostAllocationStats
+	{
+		uint64_t live = 0, peak = 0, allocations = 0;
+		uint64_t internalLive = 0, internalPeak = 0;
+	};
+
+	//VkAllocationCallbacks for the driver's host memory. Command scope allocations only live for the duration of a call
+	//and come from per-thread size class pools. Object scope ones share the lifetime of an object and are bump allocated
+	//from per-thread arena chunks, which are returned once everything in them is freed. Longer lived scopes go to the heap.
+	//Live and peak bytes are tracked per scope either way.
+	class WyvHostAllocator
+	{
+		static const uint32_t SCOPE_COUNT = VK_SYSTEM_ALLOCATION_SCOPE_INSTANCE + 1;
+
+		struct Counters
+		{
+			std::atomic<uint64_t> live, peak, allocations, internalLive, internalPeak;
+		};
+
+		VkAllocationCallbacks m_callbacks = {};
+		Counters m_counters[SCOPE_COUNT];
+
+		void *allocate(size_t _size, size_t _alignment, VkSystemAllocationScope _scope);
+		void *reallocate(void *_original, size_t _size, size_t _alignment, VkSystemAllocationScope _scope);
+		void free(void *_memory);
+		void track(std::atomic<uint64_t> &_live, std::atomic<uint64_t> &_peak, int64_t _bytes);
+
+		static VKAPI_ATTR void *VKAPI_CALL Allocation(void *_userData, size_t _size, size_t _alignment, VkSystemAllocationScope _scope);
+		static VKAPI_ATTR void *VKAPI_CALL Reallocation(void *_userData, void *_original, size_t _size, size_t _alignment, VkSystemAllocationScope _scope);
+		static VKAPI_ATTR void VKAPI_CALL Free(void *_userData, void *_memory);
+		static VKAPI_ATTR void VKAPI_CALL InternalAllocation(void *_userData, size_t _size, VkInternalAllocationType _type, VkSystemAllocationScope _scope);
+		static VKAPI_ATTR void VKAPI_CALL InternalFree(void *_userData, size_t _size, VkInternalAllocationType _type, VkSystemAllocationScope _scope);
+
+	public:
+		static const size_t POOL_LIMIT = 4096, ARENA_CHUNK_SIZE = 64 * 1024;
+
+		WyvHostAllocator();
+		WyvHostAllocator(const WyvHostAllocator&) = delete;
+		WyvHostAllocator &operator=(const WyvHostAllocator&) = delete;
+
+		const VkAllocationCallbacks *get() const { return &m_callbacks; }
+		WyvHostAllocationStats getStats(VkSystemAllocationScope _scope) const;
+		void logStats() const;
+
+		static const char *ScopeName(VkSystemAllocationScope _scope);
+	};
+}
+
+#endif //_H_WYVHOSTALLOCATOR_
@@ -0,0 +1,389 @@
+#include "WyvLog.h"
+#include "WyvBinaryLog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+using namespace wyv;
+
+const size_t WyvLogRecord::MAX_ARGS;
+const size_t WyvLogRecord::PAYLOAD_SIZE;
+const size_t WyvLogger::DEFAULT_BUDGET;
+
+bool WyvLogRecord::reserve(size_t _length)
+{
+	size_t needed = length + _length, capacity = spill ? spillCapacity : PAYLOAD_SIZE;
+	if (needed <= capacity)
+		return true;
+	if (needed > UINT32_MAX)
+		return false;
+	capacity = std::min<size_t>(std::max(needed, capacity * 2), UINT32_MAX);
+	char *grown = new (std::nothrow) char[capacity];
+	if (!grown)
+		return false;
+	memcpy(grown, data(), length);
+	delete[] spill;
+	spill = grown;
+	spillCapacity = (uint32_t)capacity;
+	return true;
+}
+
+void WyvLogRecord::setText(WyvCode _code, const char *_text, size_t _length)
+{
+	begin(_code, nullptr);
+	//Truncated only if the heap is out of memory too
+	length = (uint32_t)(reserve(_length) ? _length : PAYLOAD_SIZE);
+	memcpy((char*)data(), _text, length);
+}
+
+void WyvLogRecord::packString(const char *_text, size_t _length)
+{
+	Arg *arg = next(WYV_ARG_STRING);
+	if (!arg)
+		return;
+	size_t copied = reserve(_length) ? _length : std::min(_length, (spill ? spillCapacity : PAYLOAD_SIZE) - length);
+	memcpy((char*)data() + length, _text, copied);
+	arg->s.offset = length;
+	arg->s.length = (uint32_t)copied;
+	length += (uint32_t)copied;
+}
+
+bool WyvLogRecord::getTag(int32_t &_tag) const
+{
+	for (uint8_t i = 0; i < argCount; i++)
+	{
+		if (argTypes[i] == WYV_ARG_TAG)
+		{
+			_tag = (int32_t)args[i].i;
+			return true;
+		}
+	}
+	return false;
+}
+
+std::string WyvLogRecord::toString() const
+{
+	if (!format)
+		return std::string(data(), length);
+
+	std::string result;
+	result.reserve(strlen(format) + length + argCount * 8);
+	char buffer[32];
+	uint8_t arg = 0;
+	for (const char *c = format; *c; c++)
+	{
+		if ((c[0] == '{' && c[1] == '{') || (c[0] == '}' && c[1] == '}'))
+		{
+			result += *c++;
+			continue;
+		}
+		while (arg < argCount && argTypes[arg] == WYV_ARG_TAG)
+			arg++;
+		if (c[0] != '{' || c[1] != '}' || arg == argCount)
+		{
+			result += *c;
+			continue;
+		}
+
+		const Arg &value = args[arg];
+		switch (argTypes[arg++])
+		{
+		case WYV_ARG_INT: result += std::to_string(value.i); break;
+		case WYV_ARG_UINT: result += std::to_string(value.u); break;
+		case WYV_ARG_DOUBLE: snprintf(buffer, sizeof(buffer), "%g", value.d); result += buffer; break;
+		case WYV_ARG_STRING: result.append(data() + value.s.offset, value.s.length); break;
+		case WYV_ARG_POINTER: snprintf(buffer, sizeof(buffer), "%p", (const void*)(uintptr_t)value.u); result += buffer; break;
+		case WYV_ARG_HEX: snprintf(buffer, sizeof(buffer), "0x%llx", (unsigned long long)value.u); result += buffer; break;
+		case WYV_ARG_TAG: break;
+		}
+		c++;
+	}
+	return result;
+}
+
+WyvLogger::WyvLogger(size_t _budgetBytes, WyvLogOverflow _overflow)
+	: m_overflow(_overflow), m_enqueuePos(0), m_dequeuePos(0), m_producers(0), m_dropped(0), m_state(IDLE), m_drainId(std::thread::id()), m_stop(false)
+{
+	allocate(_budgetBytes);
+}
+
+WyvLogger::~WyvLogger()
+{
+	stop();
+}
+
+void WyvLogger::allocate(size_t _budgetBytes)
+{
+	//Round the slot count down to a power of two so positions can be masked
+	size_t capacity = 16;
+	while (capacity * 2 * sizeof(Slot) <= _budgetBytes)
+		capacity *= 2;
+
+	m_slots.reset(new Slot[capacity]);
+	m_mask = capacity - 1;
+	for (size_t i = 0; i < capacity; i++)
+		m_slots[i].sequence.store(i, std::memory_order_relaxed);
+	m_enqueuePos.store(0, std::memory_order_relaxed);
+	m_dequeuePos.store(0, std::memory_order_relaxed);
+}
+
+void WyvLogger::start()
+{
+	std::lock_guard<std::mutex> lock(m_stateMutex);
+	if (m_state.load(std::memory_order_relaxed) != IDLE)
+		return;
+
+	m_stop.store(false, std::memory_order_relaxed);
+	m_thread = std::thread(&WyvLogger::run, this);
+	m_state.store(RUNNING, std::memory_order_release);
+}
+
+void WyvLogger::stop()
+{
+	std::lock_guard<std::mutex> lock(m_stateMutex);
+	bool running = m_state.load(std::memory_order_relaxed) == RUNNING;
+	//Records from here on are delivered in place
+	m_state.store(STOPPED);
+	if (!running)
+		return;
+
+	m_stop.store(true, std::memory_order_release);
+	m_wake.notify_one();
+	m_thread.join();
+	m_drainId.store(std::thread::id(), std::memory_order_release);
+	//Records claimed before the state changed may be published after the thread's last drain
+	while (m_producers.load() || m_dequeuePos.load(std::memory_order_acquire) != m_enqueuePos.load(std::memory_order_acquire))
+	{
+		if (!drain())
+			std::this_thread::yield();
+	}
+}
+
+void WyvLogger::configure(size_t _budgetBytes, WyvLogOverflow _overflow)
+{
+	//Not safe against concurrent producers, call before spawning threads that log
+	stop();
+	std::lock_guard<std::mutex> lock(m_stateMutex);
+	m_overflow = _overflow;
+	allocate(_budgetBytes);
+	m_state.store(IDLE, std::memory_order_release);
+}
+
+WyvLogger::Slot *WyvLogger::claim(WyvCode _code, size_t &_pos, bool &_inPlace)
+{
+	_inPlace = false;
+	for (;;)
+	{
+		if (m_state.load(std::memory_order_acquire) == IDLE)
+			start();
+		//Counted before the state is read so stop() either sees this producer or this producer sees STOPPED
+		m_producers.fetch_add(1);
+		int state = m_state.load();
+		if (state == RUNNING)
+			break;
+		m_producers.fetch_sub(1);
+		if (state == STOPPED)
+		{
+			//Logging after shutdown (static destruction, Wyvern::Terminate warnings) is rare, deliver in place
+			_inPlace = true;
+			return nullptr;
+		}
+	}
+
+	size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		Slot *slot = &m_slots[pos & m_mask];
+		size_t sequence = slot->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+		if (diff == 0)
+		{
+			if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+			{
+				_pos = pos;
+				return slot;
+			}
+		}
+		else if (diff < 0)
+		{
+			//The drain thread can't wait for itself, its errors skip the queue instead
+			if (_code >= WYV_ERROR && onDrainThread())
+			{
+				m_producers.fetch_sub(1);
+				_inPlace = true;
+				return nullptr;
+			}
+			if (_code < WYV_ERROR && (m_overflow == WYV_LOG_DROP || onDrainThread()))
+			{
+				m_dropped.fetch_add(1, std::memory_order_relaxed);
+				m_producers.fetch_sub(1);
+				return nullptr;
+			}
+			m_wake.notify_one();
+			std::this_thread::yield();
+			pos = m_enqueuePos.load(std::memory_order_relaxed);
+		}
+		else
+			pos = m_enqueuePos.load(std::memory_order_relaxed);
+	}
+}
+
+void WyvLogger::publish(Slot *_slot, size_t _pos)
+{
+	WyvCode code = _slot->record.code;
+	_slot->sequence.store(_pos + 1, std::memory_order_release);
+	m_producers.fetch_sub(1);
+	if (code >= WYV_ERROR)
+		m_wake.notify_one();
+}
+
+bool WyvLogger::push(WyvCode _code, const char *_text, size_t _length)
+{
+	size_t pos;
+	bool inPlace;
+	Slot *slot = claim(_code, pos, inPlace);
+	if (slot)
+	{
+		slot->record.setText(_code, _text, _length);
+		publish(slot, pos);
+		return true;
+	}
+	if (inPlace)
+	{
+		WyvLogRecord record;
+		record.setText(_code, _text, _length);
+		deliver(record);
+		return true;
+	}
+	return false;
+}
+
+size_t WyvLogger::drain()
+{
+	size_t count = 0;
+	size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		Slot &slot = m_slots[pos & m_mask];
+		if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+			break;
+
+		dispatchNow(slot.record);
+		slot.record.release();
+
+		slot.sequence.store(pos + m_mask + 1, std::memory_order_release);
+		m_dequeuePos.store(++pos, std::memory_order_release);
+		count++;
+	}
+	return count;
+}
+
+void WyvLogger::run()
+{
+	m_drainId.store(std::this_thread::get_id(), std::memory_order_release);
+	size_t reportedDrops = 0;
+	for (;;)
+	{
+		bool stopping = m_stop.load(std::memory_order_acquire);
+		size_t count = drain();
+
+		size_t dropped = m_dropped.load(std::memory_order_relaxed);
+		if (dropped != reportedDrops)
+		{
+			WyvLogRecord record;
+			record.begin(WYV_WARNING, "Log queue overflow, {} messages dropped");
+			record.pack(dropped - reportedDrops);
+			dispatchNow(record);
+			reportedDrops = dropped;
+		}
+
+		if (stopping)
+			break;
+		if (!count)
+		{
+			std::unique_lock<std::mutex> lock(m_wakeMutex);
+			m_wake.wait_for(lock, std::chrono::milliseconds(2));
+		}
+	}
+}
+
+void WyvLogger::dispatch(const WyvLogRecord &_record)
+{
+	if (m_binary)
+	{
+		m_binary->write(_record);
+		if (_record.code < WYV_ERROR)
+			return;
+	}
+	if (m_callback)
+		m_callback(_record.code, _record.toString());
+	else
+		m_log.push(std::pair<WyvCode, std::string>(_record.code, _record.toString()));
+}
+
+void WyvLogger::dispatchNow(const WyvLogRecord &_record)
+{
+	std::lock_guard<std::mutex> lock(m_sinkMutex);
+	dispatch(_record);
+}
+
+void WyvLogger::deliver(const WyvLogRecord &_record)
+{
+	//The drain thread only logs from inside a sink, with m_sinkMutex already held
+	if (onDrainThread())
+		dispatch(_record);
+	else
+		dispatchNow(_record);
+}
+
+void WyvLogger::flush()
+{
+	if (m_state.load(std::memory_order_acquire) != RUNNING || onDrainThread())
+		return;
+
+	size_t target = m_enqueuePos.load(std::memory_order_acquire);
+	while (m_dequeuePos.load(std::memory_order_acquire) < target)
+	{
+		m_wake.notify_one();
+		std::this_thread::yield();
+	}
+}
+
+void WyvLogger::setCallback(Callback _callback)
+{
+	flush();
+	std::lock_guard<std::mutex> lock(m_sinkMutex);
+	m_callback = _callback;
+}
+
+bool WyvLogger::setBinarySink(const std::string &_path)
+{
+	flush();
+	std::lock_guard<std::mutex> lock(m_sinkMutex);
+	m_binary.reset();
+	if (_path.empty())
+		return true;
+
+	std::unique_ptr<WyvBinaryLog> binary(new WyvBinaryLog());
+	if (!binary->open(_path))
+		return false;
+	m_binary = std::move(binary);
+	return true;
+}
+
+bool WyvLogger::pop(WyvCode *_code, std::string *_message)
+{
+	flush();
+	std::lock_guard<std::mutex> lock(m_sinkMutex);
+	if (m_log.empty())
+		return false;
+
+	if (_code)
+		*_code = m_log.top().first;
+	if (_message)
+		*_message = m_log.top().second;
+	m_log.pop();
+	return true;
+}
@@ -0,0 +1,255 @@
+#ifndef _H_WYVLOG_
+#define _H_WYVLOG_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stack>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+namespace wyv
+{
+	class WyvBinaryLog;
+
+	//WYV_INFO is for reports worth keeping in release builds: what was chosen, measured or cleaned up
+	enum WyvCode { WYV_MESSAGE, WYV_DEBUG, WYV_INFO, WYV_WARNING, WYV_ERROR, WYV_FAILURE };
+
+	//What a producer does when the log queue is full. Records of WYV_ERROR and up always wait for room.
+	enum WyvLogOverflow { WYV_LOG_DROP, WYV_LOG_BLOCK };
+
+	enum WyvLogArgType : uint8_t { WYV_ARG_INT, WYV_ARG_UINT, WYV_ARG_DOUBLE, WYV_ARG_STRING, WYV_ARG_POINTER, WYV_ARG_HEX, WYV_ARG_TAG };
+
+	//Wrap a value to have it printed in hexadecimal, e.g. non-dispatchable Vulkan handles
+	struct WyvHex
+	{
+		uint64_t value;
+		explicit WyvHex(uint64_t _value) : value(_value) {}
+	};
+
+	//Identifies repeats of the same message (e.g. a validation message ID). Not printed and
+	//does not consume a placeholder, but kept in binary logs so they can be deduplicated.
+	struct WyvLogTag
+	{
+		int32_t value;
+		explicit WyvLogTag(int32_t _value) : value(_value) {}
+	};
+
+	//A log message as it travels through the queue. Either preformatted text, or a static
+	//format string plus raw arguments that are only turned into text by the drain thread.
+	struct WyvLogRecord
+	{
+		static const size_t MAX_ARGS = 8;
+		static const size_t PAYLOAD_SIZE = 392; //Text and string arguments inline, longer input spills to the heap
+
+		union Arg
+		{
+			int64_t i;
+			uint64_t u;
+			double d;
+			struct { uint32_t offset, length; } s;
+		};
+
+		WyvCode code;
+		const char *format; //nullptr when the payload already holds the final text
+		uint8_t argCount;
+		WyvLogArgType argTypes[MAX_ARGS];
+		Arg args[MAX_ARGS];
+		uint32_t length;
+		char payload[PAYLOAD_SIZE];
+		//Replaces the payload once it outgrows it, only messages that long allocate
+		char *spill = nullptr;
+		uint32_t spillCapacity = 0;
+
+		WyvLogRecord() {}
+		~WyvLogRecord() { release(); }
+
+		WyvLogRecord(const WyvLogRecord&) = delete;
+		WyvLogRecord &operator=(const WyvLogRecord&) = delete;
+
+		void begin(WyvCode _code, const char *_format) { release(); code = _code; format = _format; argCount = 0; length = 0; }
+		void setText(WyvCode _code, const char *_text, size_t _length);
+		const char *data() const { return spill ? spill : payload; }
+		//Frees the spilled payload, the drain thread does so as soon as a record is delivered
+		void release() { delete[] spill; spill = nullptr; spillCapacity = 0; }
+		//Makes room for _length more bytes of payload, false if the heap couldn't provide it
+		bool reserve(size_t _length);
+
+		Arg *next(WyvLogArgType _type) { if (argCount == MAX_ARGS) return nullptr; argTypes[argCount] = _type; return &args[argCount++]; }
+		void packString(const char *_text, size_t _length);
+
+		template<typename T>
+		typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type pack(T _value) { if (Arg *a = next(WYV_ARG_INT)) a->i = _value; }
+		template<typename T>
+		typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type pack(T _value) { if (Arg *a = next(WYV_ARG_UINT)) a->u = _value; }
+		template<typename T>
+		typename std::enable_if<std::is_enum<T>::value>::type pack(T _value) { pack((int64_t)_value); }
+		template<typename T>
+		typename std::enable_if<std::is_floating_point<T>::value>::type pack(T _value) { if (Arg *a = next(WYV_ARG_DOUBLE)) a->d = _value; }
+		template<typename T>
+		void pack(const T *_value) { if (Arg *a = next(WYV_ARG_POINTER)) a->u = (uint64_t)(uintptr_t)_value; } //Widened so 32-bit builds write no garbage
+		void pack(const char *_value) { packString(_value ? _value : "(null)", _value ? strlen(_value) : 6); }
+		void pack(char *_value) { pack((const char*)_value); }
+		void pack(const std::string &_value) { packString(_value.data(), _value.size()); }
+		void pack(WyvHex _value) { if (Arg *a = next(WYV_ARG_HEX)) a->u = _value.value; }
+		void pack(WyvLogTag _value) { if (Arg *a = next(WYV_ARG_TAG)) a->i = _value.value; }
+
+		void packAll() {}
+		template<typename T, typename... Args>
+		void packAll(const T &_first, const Args&... _rest) { pack(_first); packAll(_rest...); }
+
+		bool getTag(int32_t &_tag) const;
+
+		//Substitutes each "{}" in the format with the next argument, "{{" and "}}" escape braces
+		std::string toString() const;
+	};
+
+	//Bounded multi-producer queue of log records with a dedicated drain thread.
+	//Producers claim a slot with a single CAS and copy their text or arguments into it; formatting,
+	//the callback, console I/O and the fallback message stack are only ever touched by the drain thread.
+	class WyvLogger
+	{
+	public:
+		typedef std::function<void(WyvCode, std::string)> Callback;
+
+		static const size_t DEFAULT_BUDGET = 512 * 1024;
+
+	private:
+		enum State { IDLE, RUNNING, STOPPED };
+
+		struct Slot
+		{
+			std::atomic<size_t> sequence;
+			WyvLogRecord record;
+		};
+
+		std::unique_ptr<Slot[]> m_slots;
+		size_t m_mask = 0;
+		WyvLogOverflow m_overflow = WYV_LOG_DROP;
+
+		alignas(64) std::atomic<size_t> m_enqueuePos;
+		alignas(64) std::atomic<size_t> m_dequeuePos;
+		//Producers between reading the state and publishing, stop() waits for them before its last drain.
+		//Every log call changes it, so it gets a line of its own too.
+		alignas(64) std::atomic<size_t> m_producers;
+		alignas(64) std::atomic<size_t> m_dropped;
+		std::atomic<int> m_state;
+
+		std::thread m_thread;
+		//Set by the drain thread itself, m_thread may still be being assigned when it first logs
+		std::atomic<std::thread::id> m_drainId;
+		std::atomic<bool> m_stop;
+		std::mutex m_stateMutex, m_wakeMutex;
+		std::condition_variable m_wake;
+
+		std::mutex m_sinkMutex;
+		Callback m_callback;
+		std::stack<std::pair<WyvCode, std::string>> m_log;
+		std::unique_ptr<WyvBinaryLog> m_binary;
+
+		void allocate(size_t _budgetBytes);
+		void start();
+		void run();
+		size_t drain();
+		void dispatch(const WyvLogRecord &_record);
+		void dispatchNow(const WyvLogRecord &_record);
+		//For records that bypass the queue
+		void deliver(const WyvLogRecord &_record);
+		bool onDrainThread() const { return std::this_thread::get_id() == m_drainId.load(std::memory_order_acquire); }
+
+		//Returns the slot for position _pos, or nullptr if the record was dropped or must be delivered in place
+		Slot *claim(WyvCode _code, size_t &_pos, bool &_inPlace);
+		void publish(Slot *_slot, size_t _pos);
+
+	public:
+		WyvLogger(size_t _budgetBytes = DEFAULT_BUDGET, WyvLogOverflow _overflow = WYV_LOG_DROP);
+		~WyvLogger();
+
+		WyvLogger(const WyvLogger&) = delete;
+		WyvLogger &operator=(const WyvLogger&) = delete;
+
+		bool push(WyvCode _code, const char *_text, size_t _length);
+		bool push(WyvCode _code, const std::string &_text) { return push(_code, _text.data(), _text.size()); }
+
+		//_format must have static storage duration, only its address is queued
+		template<typename... Args>
+		bool pushFormat(WyvCode _code, const char *_format, const Args&... _args)
+		{
+			size_t pos;
+			bool inPlace;
+			Slot *slot = claim(_code, pos, inPlace);
+			if (slot)
+			{
+				slot->record.begin(_code, _format);
+				slot->record.packAll(_args...);
+				publish(slot, pos);
+				return true;
+			}
+			if (inPlace)
+			{
+				WyvLogRecord record;
+				record.begin(_code, _format);
+				record.packAll(_args...);
+				deliver(record);
+				return true;
+			}
+			return false;
+		}
+
+		void flush();
+		void stop();
+		void configure(size_t _budgetBytes, WyvLogOverflow _overflow);
+		void setCallback(Callback _callback);
+		//Records below WYV_ERROR go only to the binary file while it is open, an empty path closes it
+		bool setBinarySink(const std::string &_path);
+		bool pop(WyvCode *_code, std::string *_message);
+
+		size_t getCapacity() const { return m_mask + 1; }
+		size_t getDroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+	};
+}
+
+//Compile-time verbosity threshold for the WYV_LOG_* macros, numbered like WyvCode. Release builds keep WYV_INFO and up.
+//Levels below it compile to nothing, levels above it are still filtered by Wyvern::SetLogVerbosity.
+#ifndef WYV_LOG_LEVEL
+#ifdef NDEBUG
+#define WYV_LOG_LEVEL 2
+#else
+#define WYV_LOG_LEVEL 0
+#endif //NDEBUG
+#endif //WYV_LOG_LEVEL
+
+#define WYV_LOG_AT(_code, ...) do { if (::wyv::Wyvern::IsLogged(_code)) ::wyv::Wyvern::LogFormat(_code, __VA_ARGS__); } while (0)
+
+#if WYV_LOG_LEVEL <= 0
+#define WYV_LOG_MESSAGE(...) WYV_LOG_AT(::wyv::WYV_MESSAGE, __VA_ARGS__)
+#else
+#define WYV_LOG_MESSAGE(...) ((void)0)
+#endif
+#if WYV_LOG_LEVEL <= 1
+#define WYV_LOG_DEBUG(...) WYV_LOG_AT(::wyv::WYV_DEBUG, __VA_ARGS__)
+#else
+#define WYV_LOG_DEBUG(...) ((void)0)
+#endif
+#if WYV_LOG_LEVEL <= 2
+#define WYV_LOG_INFO(...) WYV_LOG_AT(::wyv::WYV_INFO, __VA_ARGS__)
+#else
+#define WYV_LOG_INFO(...) ((void)0)
+#endif
+#if WYV_LOG_LEVEL <= 3
+#define WYV_LOG_WARN(...) WYV_LOG_AT(::wyv::WYV_WARNING, __VA_ARGS__)
+#else
+#define WYV_LOG_WARN(...) ((void)0)
+#endif
+#if WYV_LOG_LEVEL <= 4
+#define WYV_LOG_ERROR(...) WYV_LOG_AT(::wyv::WYV_ERROR, __VA_ARGS__) //Logs only, use Wyvern::Error to honour SetThrowOnError
+#else
+#define WYV_LOG_ERROR(...) ((void)0)
+#endif
+
+#endif //_H_WYVLOG_
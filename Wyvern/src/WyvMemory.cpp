@@ -0,0 +1,980 @@
+#include "WyvMemory.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif //_MSC_VER
+
+#include "Wyvern.h"
+
+using namespace wyv;
+
+const uint32_t WyvTlsf::NONE, WyvTlsf::SL_BITS, WyvTlsf::SL_COUNT, WyvTlsf::MIN_LOG2, WyvTlsf::FL_COUNT;
+const VkDeviceSize WyvTlsf::GRANULE;
+const uint32_t WyvMemory::SIZE_CLASS_COUNT;
+const VkDeviceSize WyvMemory::SMALL_LIMIT, WyvMemory::SLAB_SIZE, WyvMemory::MAX_BLOCK_SIZE;
+
+static uint32_t HighestBit(uint64_t _value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, _value);
+	return index;
+#else
+	return 63 - __builtin_clzll(_value);
+#endif //_MSC_VER
+}
+
+static uint32_t LowestBit(uint64_t _value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, _value);
+	return index;
+#else
+	return __builtin_ctzll(_value);
+#endif //_MSC_VER
+}
+
+static VkDeviceSize AlignUp(VkDeviceSize _value, VkDeviceSize _alignment)
+{
+	return (_value + _alignment - 1) / _alignment * _alignment;
+}
+
+void WyvTlsf::Mapping(VkDeviceSize _size, uint32_t &_fl, uint32_t &_sl)
+{
+	if (_size < (1ull << MIN_LOG2))
+	{
+		_fl = 0;
+		_sl = (uint32_t)(_size >> (MIN_LOG2 - SL_BITS));
+		return;
+	}
+	uint32_t log = HighestBit(_size);
+	_fl = log - MIN_LOG2 + 1;
+	_sl = (uint32_t)((_size >> (log - SL_BITS)) ^ (1ull << SL_BITS));
+}
+
+void WyvTlsf::init(VkDeviceSize _size)
+{
+	m_nodes.clear();
+	m_unusedNodes.clear();
+	m_flBitmap = 0;
+	memset(m_slBitmap, 0, sizeof(m_slBitmap));
+	for (uint32_t fl = 0; fl < FL_COUNT; fl++)
+		for (uint32_t sl = 0; sl < SL_COUNT; sl++)
+			m_heads[fl][sl] = NONE;
+	m_size = _size / GRANULE * GRANULE;
+	m_used = 0;
+	m_allocationCount = m_freeCount = 0;
+
+	uint32_t node = newNode();
+	m_nodes[node].size = m_size;
+	insertFree(node);
+}
+
+uint32_t WyvTlsf::newNode()
+{
+	if (!m_unusedNodes.empty())
+	{
+		uint32_t node = m_unusedNodes.back();
+		m_unusedNodes.pop_back();
+		m_nodes[node] = Node();
+		return node;
+	}
+	m_nodes.emplace_back();
+	return (uint32_t)m_nodes.size() - 1;
+}
+
+void WyvTlsf::releaseNode(uint32_t _node)
+{
+	m_unusedNodes.push_back(_node);
+}
+
+void WyvTlsf::insertFree(uint32_t _node)
+{
+	uint32_t fl, sl;
+	Mapping(m_nodes[_node].size, fl, sl);
+	Node &node = m_nodes[_node];
+	node.free = true;
+	node.prevFree = NONE;
+	node.nextFree = m_heads[fl][sl];
+	if (node.nextFree != NONE)
+		m_nodes[node.nextFree].prevFree = _node;
+	m_heads[fl][sl] = _node;
+	m_flBitmap |= 1ull << fl;
+	m_slBitmap[fl] |= 1u << sl;
+	m_freeCount++;
+}
+
+void WyvTlsf::removeFree(uint32_t _node)
+{
+	uint32_t fl, sl;
+	Mapping(m_nodes[_node].size, fl, sl);
+	Node &node = m_nodes[_node];
+	if (node.prevFree != NONE)
+		m_nodes[node.prevFree].nextFree = node.nextFree;
+	else
+		m_heads[fl][sl] = node.nextFree;
+	if (node.nextFree != NONE)
+		m_nodes[node.nextFree].prevFree = node.prevFree;
+	if (m_heads[fl][sl] == NONE)
+	{
+		m_slBitmap[fl] &= ~(1u << sl);
+		if (!m_slBitmap[fl])
+			m_flBitmap &= ~(1ull << fl);
+	}
+	node.free = false;
+	m_freeCount--;
+}
+
+uint32_t WyvTlsf::findFree(VkDeviceSize _size) const
+{
+	//Round up to the start of the next list so every node found is big enough
+	if (_size < (1ull << MIN_LOG2))
+		_size = AlignUp(_size, 1ull << (MIN_LOG2 - SL_BITS));
+	else
+		_size += (1ull << (HighestBit(_size) - SL_BITS)) - 1;
+
+	uint32_t fl, sl;
+	Mapping(_size, fl, sl);
+	if (fl >= FL_COUNT)
+		return NONE;
+
+	uint32_t slMap = m_slBitmap[fl] & (~0u << sl);
+	if (!slMap)
+	{
+		uint64_t flMap = fl + 1 < 64 ? m_flBitmap & (~0ull << (fl + 1)) : 0;
+		if (!flMap)
+			return NONE;
+		fl = LowestBit(flMap);
+		slMap = m_slBitmap[fl];
+	}
+	return m_heads[fl][LowestBit(slMap)];
+}
+
+VkDeviceSize WyvTlsf::RequiredSize(VkDeviceSize _size, VkDeviceSize _alignment)
+{
+	//What allocate() asks findFree for, rounded up the same way
+	VkDeviceSize size = AlignUp(std::max<VkDeviceSize>(_size, 1), GRANULE) + std::max(_alignment, GRANULE) - GRANULE;
+	if (size < (1ull << MIN_LOG2))
+		return AlignUp(size, 1ull << (MIN_LOG2 - SL_BITS));
+	return size + (1ull << (HighestBit(size) - SL_BITS)) - 1;
+}
+
+uint32_t WyvTlsf::allocate(VkDeviceSize _size, VkDeviceSize _alignment, VkDeviceSize &_offset)
+{
+	_size = AlignUp(std::max<VkDeviceSize>(_size, 1), GRANULE);
+	_alignment = std::max(_alignment, GRANULE);
+	uint32_t found = findFree(_size + (_alignment > GRANULE ? _alignment - GRANULE : 0));
+	if (found == NONE)
+		return NONE;
+	removeFree(found);
+
+	//Any padding in front goes back as its own free range. Neighbours of a free node are never free, so nothing merges.
+	VkDeviceSize aligned = AlignUp(m_nodes[found].offset, _alignment);
+	VkDeviceSize padding = aligned - m_nodes[found].offset;
+	if (padding)
+	{
+		uint32_t front = newNode();
+		Node &node = m_nodes[found];
+		m_nodes[front].offset = node.offset;
+		m_nodes[front].size = padding;
+		m_nodes[front].prevPhysical = node.prevPhysical;
+		m_nodes[front].nextPhysical = found;
+		if (node.prevPhysical != NONE)
+			m_nodes[node.prevPhysical].nextPhysical = front;
+		node.prevPhysical = front;
+		node.offset = aligned;
+		node.size -= padding;
+		insertFree(front);
+	}
+
+	VkDeviceSize remainder = m_nodes[found].size - _size;
+	if (remainder >= GRANULE)
+	{
+		uint32_t back = newNode();
+		Node &node = m_nodes[found];
+		m_nodes[back].offset = node.offset + _size;
+		m_nodes[back].size = remainder;
+		m_nodes[back].prevPhysical = found;
+		m_nodes[back].nextPhysical = node.nextPhysical;
+		if (node.nextPhysical != NONE)
+			m_nodes[node.nextPhysical].prevPhysical = back;
+		node.nextPhysical = back;
+		node.size = _size;
+		insertFree(back);
+	}
+
+	m_used += m_nodes[found].size;
+	m_allocationCount++;
+	_offset = m_nodes[found].offset;
+	return found;
+}
+
+void WyvTlsf::free(uint32_t _node)
+{
+	m_used -= m_nodes[_node].size;
+	m_allocationCount--;
+
+	uint32_t next = m_nodes[_node].nextPhysical;
+	if (next != NONE && m_nodes[next].free)
+	{
+		removeFree(next);
+		m_nodes[_node].size += m_nodes[next].size;
+		m_nodes[_node].nextPhysical = m_nodes[next].nextPhysical;
+		if (m_nodes[next].nextPhysical != NONE)
+			m_nodes[m_nodes[next].nextPhysical].prevPhysical = _node;
+		releaseNode(next);
+	}
+
+	uint32_t prev = m_nodes[_node].prevPhysical;
+	if (prev != NONE && m_nodes[prev].free)
+	{
+		removeFree(prev);
+		m_nodes[prev].size += m_nodes[_node].size;
+		m_nodes[prev].nextPhysical = m_nodes[_node].nextPhysical;
+		if (m_nodes[_node].nextPhysical != NONE)
+			m_nodes[m_nodes[_node].nextPhysical].prevPhysical = prev;
+		releaseNode(_node);
+		_node = prev;
+	}
+	insertFree(_node);
+}
+
+VkDeviceSize WyvTlsf::getLargestFree() const
+{
+	if (!m_flBitmap)
+		return 0;
+	uint32_t fl = HighestBit(m_flBitmap);
+	VkDeviceSize largest = 0;
+	for (uint32_t node = m_heads[fl][HighestBit(m_slBitmap[fl])]; node != NONE; node = m_nodes[node].nextFree)
+		largest = std::max(largest, m_nodes[node].size);
+	return largest;
+}
+
+void WyvMemory::create(VkDevice _device, VkPhysicalDevice _physicalDevice, bool _budgetExtension)
+{
+	m_device = _device;
+	m_physicalDevice = _physicalDevice;
+	m_budgetExtension = _budgetExtension;
+	vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &m_properties);
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+	m_granularity = std::max<VkDeviceSize>(properties.limits.bufferImageGranularity, 1);
+	m_nonCoherentAtom = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+	m_maxAllocations = properties.limits.maxMemoryAllocationCount;
+	m_deviceAllocations = 0;
+
+	m_pools.clear();
+	m_pools.resize(m_properties.memoryTypeCount * 2);
+	for (uint32_t i = 0; i < m_pools.size(); i++)
+	{
+		//Small heaps get smaller blocks so one block doesn't claim the whole heap
+		uint32_t type = i / 2;
+		VkDeviceSize heapSize = m_properties.memoryHeaps[m_properties.memoryTypes[type].heapIndex].size;
+		m_pools[i].memoryType = type;
+		m_pools[i].blockSize = std::max(SLAB_SIZE, std::min(MAX_BLOCK_SIZE, AlignUp(heapSize / 8, SLAB_SIZE)));
+	}
+	m_dedicated.assign(m_properties.memoryTypeCount, WyvMemoryStats());
+	m_usedBytes.assign(m_properties.memoryTypeCount, 0);
+
+	m_budgets.assign(m_properties.memoryHeapCount, WyvHeapBudget());
+	for (uint32_t i = 0; i < m_properties.memoryHeapCount; i++)
+	{
+		m_budgets[i].size = m_properties.memoryHeaps[i].size;
+		m_budgets[i].deviceLocal = (m_properties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+	}
+	m_fallbacks = m_budgetRefusals = 0;
+	queryBudget();
+
+	WYV_LOG_MESSAGE("Memory allocator created: {} memory types, buffer image granularity {}, at most {} device allocations, {}",
+		m_properties.memoryTypeCount, (uint64_t)m_granularity, m_maxAllocations, m_budgetExtension ? "budget from VK_EXT_memory_budget" : "budget estimated from heap sizes");
+}
+
+void WyvMemory::destroy()
+{
+	if (!m_device)
+		return;
+	logStats();
+	for (Pool &pool : m_pools)
+	{
+		for (auto &block : pool.blocks)
+		{
+			if (block->tlsf.getAllocationCount())
+				WYV_LOG_WARN("Memory block of type {} destroyed with {} allocations still live", pool.memoryType, block->tlsf.getAllocationCount());
+			freeDeviceMemory(pool.memoryType, block->memory, block->tlsf.getSize());
+		}
+		pool.blocks.clear();
+		pool.slabs.clear();
+		for (auto &available : pool.available)
+			available.clear();
+	}
+	m_movables.clear();
+	m_device = VK_NULL_HANDLE;
+}
+
+int WyvMemory::chooseMemoryType(uint32_t _typeBits, WyvMemoryUsage _usage) const
+{
+	VkMemoryPropertyFlags required = 0, preferred = 0;
+	switch (_usage)
+	{
+	case WYV_MEMORY_GPU_ONLY: preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT; break;
+	case WYV_MEMORY_CPU_TO_GPU: required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT; preferred = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT; break;
+	case WYV_MEMORY_GPU_TO_CPU: required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT; preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT; break;
+	case WYV_MEMORY_CPU_ONLY: required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT; break;
+	case WYV_MEMORY_GPU_LAZY: required = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT; break;
+	}
+
+	int best = -1, bestScore = -1;
+	for (uint32_t i = 0; i < m_properties.memoryTypeCount; i++)
+	{
+		VkMemoryPropertyFlags flags = m_properties.memoryTypes[i].propertyFlags;
+		if (!(_typeBits & (1u << i)) || (flags & required) != required)
+			continue;
+		if (_usage != WYV_MEMORY_GPU_LAZY && flags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+			continue;
+		//Count preferred bits, and keep memory the CPU reads or writes off the device heap unless that's all there is
+		int score = 0;
+		for (VkMemoryPropertyFlags bits = flags & preferred; bits; bits &= bits - 1)
+			score += 2;
+		if (_usage == WYV_MEMORY_CPU_ONLY && !(flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+			score++;
+		if (score > bestScore)
+		{
+			best = (int)i;
+			bestScore = score;
+		}
+	}
+	return best;
+}
+
+static WyvMemoryPressure Pressure(const WyvHeapBudget &_budget, float _throttle, float _evict)
+{
+	if (!_budget.budget)
+		return WYV_MEMORY_PRESSURE_NONE;
+	double ratio = (double)_budget.usage / _budget.budget;
+	return ratio >= _evict ? WYV_MEMORY_PRESSURE_EVICT : ratio >= _throttle ? WYV_MEMORY_PRESSURE_THROTTLE : WYV_MEMORY_PRESSURE_NONE;
+}
+
+static const char *PressureName(WyvMemoryPressure _pressure)
+{
+	switch (_pressure)
+	{
+	case WYV_MEMORY_PRESSURE_THROTTLE: return "throttle";
+	case WYV_MEMORY_PRESSURE_EVICT: return "evict";
+	default: return "no";
+	}
+}
+
+bool WyvMemory::fitsBudget(uint32_t _memoryType, VkDeviceSize _size) const
+{
+	const WyvHeapBudget &budget = m_budgets[m_properties.memoryTypes[_memoryType].heapIndex];
+	return budget.usage + _size <= budget.budget;
+}
+
+void WyvMemory::queryBudget()
+{
+	if (m_budgetExtension)
+	{
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+		budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+		VkPhysicalDeviceMemoryProperties2 properties = {};
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+		properties.pNext = &budgetProperties;
+		vkGetPhysicalDeviceMemoryProperties2(m_physicalDevice, &properties);
+		for (uint32_t i = 0; i < m_budgets.size(); i++)
+		{
+			//Some drivers leave heaps they don't track at zero
+			m_budgets[i].budget = budgetProperties.heapBudget[i] ? std::min(budgetProperties.heapBudget[i], m_budgets[i].size) : m_budgets[i].size * 8 / 10;
+			m_budgets[i].usage = std::max(budgetProperties.heapUsage[i], m_budgets[i].allocatorBytes);
+		}
+	}
+	else
+	{
+		//Without the extension only our own memory is known, keep a fifth of each heap for everyone else
+		for (WyvHeapBudget &budget : m_budgets)
+		{
+			budget.budget = budget.size * 8 / 10;
+			budget.usage = budget.allocatorBytes;
+		}
+	}
+	for (WyvHeapBudget &budget : m_budgets)
+		budget.pressure = Pressure(budget, m_throttleRatio, m_evictRatio);
+}
+
+VkDeviceMemory WyvMemory::allocateDeviceMemory(uint32_t _memoryType, VkDeviceSize _size, const void *_pNext, bool _withinBudget)
+{
+	if (m_deviceAllocations >= m_maxAllocations)
+	{
+		WYV_LOG_ERROR("Out of device memory allocations, {} in use", m_deviceAllocations);
+		return VK_NULL_HANDLE;
+	}
+	if (_withinBudget && !fitsBudget(_memoryType, _size))
+	{
+		m_budgetRefusals++;
+		WYV_LOG_DEBUG("Allocation of {} bytes from memory type {} refused, it would exceed the heap's budget", (uint64_t)_size, _memoryType);
+		return VK_NULL_HANDLE;
+	}
+
+	VkMemoryAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.pNext = _pNext;
+	allocateInfo.allocationSize = _size;
+	allocateInfo.memoryTypeIndex = _memoryType;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkResult result = vkAllocateMemory(m_device, &allocateInfo, Wyvern::GetAllocator(), &memory);
+	if (result != VK_SUCCESS)
+	{
+		WYV_LOG_WARN("vkAllocateMemory of {} bytes from memory type {} failed with {}", (uint64_t)_size, _memoryType, (int)result);
+		return VK_NULL_HANDLE;
+	}
+	m_deviceAllocations++;
+	WyvHeapBudget &budget = m_budgets[m_properties.memoryTypes[_memoryType].heapIndex];
+	budget.allocatorBytes += _size;
+	budget.usage += _size;
+	return memory;
+}
+
+void WyvMemory::freeDeviceMemory(uint32_t _memoryType, VkDeviceMemory _memory, VkDeviceSize _size)
+{
+	vkFreeMemory(m_device, _memory, Wyvern::GetAllocator());
+	m_deviceAllocations--;
+	WyvHeapBudget &budget = m_budgets[m_properties.memoryTypes[_memoryType].heapIndex];
+	budget.allocatorBytes -= _size;
+	budget.usage -= std::min(budget.usage, _size);
+}
+
+WyvMemoryBlock *WyvMemory::createBlock(Pool &_pool, VkDeviceSize _size, bool _withinBudget)
+{
+	VkDeviceMemory memory = allocateDeviceMemory(_pool.memoryType, _size, nullptr, _withinBudget);
+	if (!memory)
+		return nullptr;
+
+	std::unique_ptr<WyvMemoryBlock> block(new WyvMemoryBlock());
+	block->pool = (uint32_t)(&_pool - m_pools.data());
+	block->memory = memory;
+	block->tlsf.init(_size);
+	//Host visible blocks stay mapped for their whole life
+	if (m_properties.memoryTypes[_pool.memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		void *mapped = nullptr;
+		if (vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) == VK_SUCCESS)
+			block->mapped = (uint8_t*)mapped;
+	}
+	_pool.blocks.push_back(std::move(block));
+	WYV_LOG_DEBUG("Memory block {} of type {} created, {} bytes", (uint32_t)_pool.blocks.size() - 1, _pool.memoryType, (uint64_t)_size);
+	return _pool.blocks.back().get();
+}
+
+void WyvMemory::releaseIfEmpty(Pool &_pool, WyvMemoryBlock *_block)
+{
+	//One empty block is kept per pool so a steady alloc/free pattern doesn't hit vkAllocateMemory every time,
+	//unless its heap is under pressure
+	bool pressure = m_budgets[m_properties.memoryTypes[_pool.memoryType].heapIndex].pressure != WYV_MEMORY_PRESSURE_NONE;
+	if (_block->tlsf.getAllocationCount() || (_pool.blocks.size() < 2 && !pressure))
+		return;
+	for (auto it = _pool.blocks.begin(); it != _pool.blocks.end(); ++it)
+	{
+		if (it->get() == _block)
+		{
+			freeDeviceMemory(_pool.memoryType, _block->memory, _block->tlsf.getSize());
+			_pool.blocks.erase(it);
+			return;
+		}
+	}
+}
+
+bool WyvMemory::allocateLarge(Pool &_pool, VkDeviceSize _size, VkDeviceSize _alignment, WyvAllocation &_allocation, bool _withinBudget)
+{
+	for (auto &block : _pool.blocks)
+	{
+		VkDeviceSize offset;
+		uint32_t node = block->tlsf.allocate(_size, _alignment, offset);
+		if (node == WyvTlsf::NONE)
+			continue;
+		_allocation.block = block.get();
+		_allocation.node = node;
+		_allocation.offset = offset;
+		return true;
+	}
+
+	//Near the budget a block just big enough keeps free space from pushing the heap over it
+	VkDeviceSize blockSize = _pool.blockSize;
+	if (!fitsBudget(_pool.memoryType, blockSize))
+		blockSize = std::max(SLAB_SIZE, AlignUp(WyvTlsf::RequiredSize(_size, _alignment), SLAB_SIZE));
+	WyvMemoryBlock *block = createBlock(_pool, blockSize, _withinBudget);
+	if (!block)
+		return false;
+	VkDeviceSize offset;
+	_allocation.node = block->tlsf.allocate(_size, _alignment, offset);
+	if (_allocation.node == WyvTlsf::NONE)
+	{
+		releaseIfEmpty(_pool, block);
+		return false;
+	}
+	_allocation.block = block;
+	_allocation.offset = offset;
+	return true;
+}
+
+bool WyvMemory::allocateSmall(Pool &_pool, VkDeviceSize _size, VkDeviceSize _alignment, WyvAllocation &_allocation, bool _withinBudget)
+{
+	//Size classes are powers of two from 256 bytes, slots are aligned to their own size
+	VkDeviceSize needed = std::max(_size, _alignment);
+	uint32_t sizeClass = 0;
+	while ((256ull << sizeClass) < needed)
+		sizeClass++;
+
+	std::vector<WyvMemorySlab*> &available = _pool.available[sizeClass];
+	if (available.empty())
+	{
+		WyvAllocation slabRange;
+		if (!allocateLarge(_pool, SLAB_SIZE, SMALL_LIMIT, slabRange, _withinBudget))
+			return false;
+
+		std::unique_ptr<WyvMemorySlab> slab(new WyvMemorySlab());
+		slab->block = slabRange.block;
+		slab->node = slabRange.node;
+		slab->offset = slabRange.offset;
+		slab->sizeClass = sizeClass;
+		slab->slotSize = 256ull << sizeClass;
+		uint32_t slotCount = (uint32_t)(SLAB_SIZE / slab->slotSize);
+		for (uint32_t i = slotCount; i > 0; i--)
+			slab->freeSlots.push_back(i - 1);
+		slab->availableIndex = available.size();
+		available.push_back(slab.get());
+		_pool.slabs.push_back(std::move(slab));
+	}
+
+	WyvMemorySlab *slab = available.back();
+	uint32_t slot = slab->freeSlots.back();
+	slab->freeSlots.pop_back();
+	if (slab->freeSlots.empty())
+	{
+		available.pop_back();
+		slab->availableIndex = SIZE_MAX;
+	}
+
+	_allocation.block = slab->block;
+	_allocation.slab = slab;
+	_allocation.node = slot;
+	_allocation.offset = slab->offset + slot * slab->slotSize;
+	return true;
+}
+
+void WyvMemory::freeSmall(Pool &_pool, WyvAllocation &_allocation)
+{
+	WyvMemorySlab *slab = _allocation.slab;
+	std::vector<WyvMemorySlab*> &available = _pool.available[slab->sizeClass];
+	slab->freeSlots.push_back(_allocation.node);
+	if (slab->availableIndex == SIZE_MAX)
+	{
+		slab->availableIndex = available.size();
+		available.push_back(slab);
+	}
+
+	//Give an empty slab back to its block, unless it's the only one left for its class
+	if (slab->freeSlots.size() * slab->slotSize == SLAB_SIZE && available.size() > 1)
+	{
+		available[slab->availableIndex] = available.back();
+		available[slab->availableIndex]->availableIndex = slab->availableIndex;
+		available.pop_back();
+		WyvMemoryBlock *block = slab->block;
+		block->tlsf.free(slab->node);
+		for (auto it = _pool.slabs.begin(); it != _pool.slabs.end(); ++it)
+		{
+			if (it->get() == slab)
+			{
+				*it = std::move(_pool.slabs.back());
+				_pool.slabs.pop_back();
+				break;
+			}
+		}
+		releaseIfEmpty(_pool, block);
+	}
+}
+
+WyvAllocation *WyvMemory::allocateDedicated(uint32_t _memoryType, const VkMemoryRequirements &_requirements, VkBuffer _buffer, VkImage _image, bool _withinBudget)
+{
+	VkMemoryDedicatedAllocateInfo dedicatedInfo = {};
+	dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+	dedicatedInfo.buffer = _buffer;
+	dedicatedInfo.image = _image;
+	VkDeviceMemory memory = allocateDeviceMemory(_memoryType, _requirements.size, _buffer || _image ? &dedicatedInfo : nullptr, _withinBudget);
+	if (!memory)
+		return nullptr;
+
+	WyvAllocation *allocation = new WyvAllocation();
+	allocation->memory = memory;
+	allocation->size = _requirements.size;
+	allocation->memoryType = _memoryType;
+	if (m_properties.memoryTypes[_memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		void *mapped = nullptr;
+		if (vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) == VK_SUCCESS)
+			allocation->mapped = (uint8_t*)mapped;
+	}
+	m_dedicated[_memoryType].dedicatedCount++;
+	m_dedicated[_memoryType].dedicatedBytes += _requirements.size;
+	m_usedBytes[_memoryType] += _requirements.size;
+	return allocation;
+}
+
+WyvAllocation *WyvMemory::allocateFromType(uint32_t _memoryType, const VkMemoryRequirements &_requirements, bool _linear, uint32_t _flags, VkBuffer _buffer, VkImage _image)
+{
+	bool withinBudget = (_flags & WYV_MEMORY_WITHIN_BUDGET) != 0;
+	Pool &pool = m_pools[_memoryType * 2 + (m_granularity > 1 && !_linear ? 1 : 0)];
+	if (_flags & WYV_MEMORY_DEDICATED || _requirements.size > pool.blockSize / 2)
+		return allocateDedicated(_memoryType, _requirements, _buffer, _image, withinBudget);
+
+	WyvAllocation allocation;
+	allocation.size = _requirements.size;
+	allocation.memoryType = _memoryType;
+	bool small = !(_flags & WYV_MEMORY_MOVABLE) && _requirements.size <= SMALL_LIMIT && _requirements.alignment <= SMALL_LIMIT;
+	if (!(small ? allocateSmall(pool, _requirements.size, _requirements.alignment, allocation, withinBudget) : allocateLarge(pool, _requirements.size, _requirements.alignment, allocation, withinBudget)))
+		return nullptr;
+	allocation.memory = allocation.block->memory;
+	allocation.mapped = allocation.block->mapped ? allocation.block->mapped + allocation.offset : nullptr;
+	m_usedBytes[_memoryType] += allocation.size;
+	return new WyvAllocation(allocation);
+}
+
+WyvAllocation *WyvMemory::allocate(const VkMemoryRequirements &_requirements, WyvMemoryUsage _usage, bool _linear, uint32_t _flags, VkBuffer _buffer, VkImage _image)
+{
+	uint32_t typeBits = _requirements.memoryTypeBits;
+	int memoryType = chooseMemoryType(typeBits, _usage);
+	if (memoryType < 0)
+	{
+		WYV_LOG_ERROR("No memory type fits usage {} and type bits {}", (int)_usage, WyvHex(_requirements.memoryTypeBits));
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	//A full heap falls back to the next best type rather than fail, e.g. device local resources spilling into system memory.
+	//WITHIN_BUDGET allocations would rather wait for room where they belong.
+	while (memoryType >= 0)
+	{
+		WyvAllocation *allocation = allocateFromType((uint32_t)memoryType, _requirements, _linear, _flags, _buffer, _image);
+		if (allocation || _flags & WYV_MEMORY_WITHIN_BUDGET)
+			return allocation;
+		typeBits &= ~(1u << memoryType);
+		int fallback = chooseMemoryType(typeBits, _usage);
+		if (fallback >= 0)
+		{
+			m_fallbacks++;
+			WYV_LOG_WARN("Allocation of {} bytes doesn't fit memory type {}, falling back to memory type {}", (uint64_t)_requirements.size, memoryType, fallback);
+		}
+		memoryType = fallback;
+	}
+	WYV_LOG_ERROR("Allocation of {} bytes for usage {} failed in every memory type", (uint64_t)_requirements.size, (int)_usage);
+	return nullptr;
+}
+
+WyvAllocation *WyvMemory::allocateBuffer(VkBuffer _buffer, WyvMemoryUsage _usage, uint32_t _flags)
+{
+	VkMemoryDedicatedRequirements dedicated = {};
+	dedicated.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+	VkMemoryRequirements2 requirements = {};
+	requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	requirements.pNext = &dedicated;
+	VkBufferMemoryRequirementsInfo2 info = {};
+	info.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+	info.buffer = _buffer;
+	vkGetBufferMemoryRequirements2(m_device, &info, &requirements);
+	if (dedicated.prefersDedicatedAllocation || dedicated.requiresDedicatedAllocation)
+		_flags |= WYV_MEMORY_DEDICATED;
+
+	WyvAllocation *allocation = allocate(requirements.memoryRequirements, _usage, true, _flags, _flags & WYV_MEMORY_DEDICATED ? _buffer : VK_NULL_HANDLE, VK_NULL_HANDLE);
+	if (allocation)
+		vkBindBufferMemory(m_device, _buffer, allocation->memory, allocation->offset);
+	return allocation;
+}
+
+WyvAllocation *WyvMemory::allocateImage(VkImage _image, WyvMemoryUsage _usage, uint32_t _flags)
+{
+	VkMemoryDedicatedRequirements dedicated = {};
+	dedicated.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+	VkMemoryRequirements2 requirements = {};
+	requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	requirements.pNext = &dedicated;
+	VkImageMemoryRequirementsInfo2 info = {};
+	info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+	info.image = _image;
+	vkGetImageMemoryRequirements2(m_device, &info, &requirements);
+	if (dedicated.prefersDedicatedAllocation || dedicated.requiresDedicatedAllocation)
+		_flags |= WYV_MEMORY_DEDICATED;
+
+	WyvAllocation *allocation = allocate(requirements.memoryRequirements, _usage, false, _flags, VK_NULL_HANDLE, _flags & WYV_MEMORY_DEDICATED ? _image : VK_NULL_HANDLE);
+	if (allocation)
+		vkBindImageMemory(m_device, _image, allocation->memory, allocation->offset);
+	return allocation;
+}
+
+//Concurrent between the families of every queue role, so moves on the transfer queue need no ownership transfers
+static void ShareWithQueues(std::vector<uint32_t> &_families, VkSharingMode &_mode, uint32_t &_count, const uint32_t *&_indices)
+{
+	for (int role = 0; role < WYV_QUEUE_ROLE_COUNT; role++)
+	{
+		uint32_t family = Wyvern::GetQueue((WyvQueueRole)role).getFamily();
+		if (std::find(_families.begin(), _families.end(), family) == _families.end())
+			_families.push_back(family);
+	}
+	bool concurrent = _families.size() > 1;
+	_mode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE;
+	_count = concurrent ? (uint32_t)_families.size() : 0;
+	_indices = concurrent ? _families.data() : nullptr;
+}
+
+WyvAllocation *WyvMemory::createMovableBuffer(const VkBufferCreateInfo &_info, WyvMemoryUsage _usage, MoveCallback _onMove)
+{
+	WyvMovable *movable = new WyvMovable();
+	movable->bufferInfo = _info;
+	movable->bufferInfo.usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	ShareWithQueues(movable->families, movable->bufferInfo.sharingMode, movable->bufferInfo.queueFamilyIndexCount, movable->bufferInfo.pQueueFamilyIndices);
+	movable->onMove = _onMove;
+
+	VkBuffer buffer;
+	if (vkCreateBuffer(m_device, &movable->bufferInfo, Wyvern::GetAllocator(), &buffer) != VK_SUCCESS)
+	{
+		WYV_LOG_ERROR("Movable buffer of {} bytes couldn't be created", (uint64_t)_info.size);
+		delete movable;
+		return nullptr;
+	}
+	vkGetBufferMemoryRequirements(m_device, buffer, &movable->requirements);
+	return bindMovable(movable, buffer, VK_NULL_HANDLE, _usage);
+}
+
+WyvAllocation *WyvMemory::createMovableImage(const VkImageCreateInfo &_info, VkImageLayout _layout, WyvMemoryUsage _usage, MoveCallback _onMove)
+{
+	WyvMovable *movable = new WyvMovable();
+	movable->imageInfo = _info;
+	movable->imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	movable->imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	ShareWithQueues(movable->families, movable->imageInfo.sharingMode, movable->imageInfo.queueFamilyIndexCount, movable->imageInfo.pQueueFamilyIndices);
+	movable->layout = _layout;
+	movable->onMove = _onMove;
+
+	VkImage image;
+	if (vkCreateImage(m_device, &movable->imageInfo, Wyvern::GetAllocator(), &image) != VK_SUCCESS)
+	{
+		WYV_LOG_ERROR("Movable image of {}x{} couldn't be created", _info.extent.width, _info.extent.height);
+		delete movable;
+		return nullptr;
+	}
+	vkGetImageMemoryRequirements(m_device, image, &movable->requirements);
+	return bindMovable(movable, VK_NULL_HANDLE, image, _usage);
+}
+
+WyvAllocation *WyvMemory::bindMovable(WyvMovable *_movable, VkBuffer _buffer, VkImage _image, WyvMemoryUsage _usage)
+{
+	WyvAllocation *allocation = allocate(_movable->requirements, _usage, _buffer != VK_NULL_HANDLE, WYV_MEMORY_MOVABLE, VK_NULL_HANDLE, VK_NULL_HANDLE);
+	if (!allocation)
+	{
+		if (_buffer)
+			vkDestroyBuffer(m_device, _buffer, Wyvern::GetAllocator());
+		if (_image)
+			vkDestroyImage(m_device, _image, Wyvern::GetAllocator());
+		delete _movable;
+		return nullptr;
+	}
+	if (_buffer)
+		vkBindBufferMemory(m_device, _buffer, allocation->memory, allocation->offset);
+	else
+		vkBindImageMemory(m_device, _image, allocation->memory, allocation->offset);
+	allocation->buffer = _buffer;
+	allocation->image = _image;
+	allocation->movable = _movable;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_movables.insert(allocation);
+	return allocation;
+}
+
+void WyvMemory::free(WyvAllocation *_allocation)
+{
+	if (!_allocation)
+		return;
+
+	if (WyvMovable *movable = _allocation->movable)
+	{
+		//A move still copying into the allocation has to land before its memory can be reused. The defragmenter
+		//sets and clears pendingMove under the lock, the wait itself happens outside it.
+		uint64_t pendingMove;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			pendingMove = movable->pendingMove;
+		}
+		if (pendingMove)
+			Wyvern::GetQueue(WYV_QUEUE_TRANSFER).wait(pendingMove);
+		if (_allocation->buffer)
+			vkDestroyBuffer(m_device, _allocation->buffer, Wyvern::GetAllocator());
+		if (_allocation->image)
+			vkDestroyImage(m_device, _allocation->image, Wyvern::GetAllocator());
+		delete movable;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (_allocation->movable)
+		m_movables.erase(_allocation);
+	m_usedBytes[_allocation->memoryType] -= _allocation->size;
+	if (!_allocation->block)
+	{
+		freeDeviceMemory(_allocation->memoryType, _allocation->memory, _allocation->size);
+		m_dedicated[_allocation->memoryType].dedicatedCount--;
+		m_dedicated[_allocation->memoryType].dedicatedBytes -= _allocation->size;
+	}
+	else if (_allocation->slab)
+		freeSmall(m_pools[_allocation->block->pool], *_allocation);
+	else
+	{
+		_allocation->block->tlsf.free(_allocation->node);
+		releaseIfEmpty(m_pools[_allocation->block->pool], _allocation->block);
+	}
+	delete _allocation;
+}
+
+//Ranges must start and end on nonCoherentAtomSize, rounding out can't leave a block since blocks are atom aligned.
+//A dedicated allocation is the whole memory object and its size needn't be, so a range reaching its end runs to VK_WHOLE_SIZE.
+static VkMappedMemoryRange AtomRange(const WyvAllocation *_allocation, VkDeviceSize _offset, VkDeviceSize _size, VkDeviceSize _atom)
+{
+	VkDeviceSize end = _allocation->offset + (_size == VK_WHOLE_SIZE ? _allocation->size : std::min(_offset + _size, _allocation->size));
+	VkMappedMemoryRange range = {};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = _allocation->memory;
+	range.offset = (_allocation->offset + _offset) / _atom * _atom;
+	range.size = !_allocation->block && AlignUp(end, _atom) > _allocation->size ? VK_WHOLE_SIZE : AlignUp(end, _atom) - range.offset;
+	return range;
+}
+
+void WyvMemory::flush(const WyvAllocation *_allocation, VkDeviceSize _offset, VkDeviceSize _size)
+{
+	if (!_allocation || isCoherent(_allocation->memoryType))
+		return;
+	VkMappedMemoryRange range = AtomRange(_allocation, _offset, _size, m_nonCoherentAtom);
+	vkFlushMappedMemoryRanges(m_device, 1, &range);
+}
+
+void WyvMemory::invalidate(const WyvAllocation *_allocation, VkDeviceSize _offset, VkDeviceSize _size)
+{
+	if (!_allocation || isCoherent(_allocation->memoryType))
+		return;
+	VkMappedMemoryRange range = AtomRange(_allocation, _offset, _size, m_nonCoherentAtom);
+	vkInvalidateMappedMemoryRanges(m_device, 1, &range);
+}
+
+void WyvMemory::updateBudget()
+{
+	if (!m_device)
+		return;
+	std::vector<std::pair<uint32_t, WyvHeapBudget>> notify;
+	std::vector<BudgetCallback> callbacks;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::vector<WyvMemoryPressure> previous(m_budgets.size());
+		for (uint32_t i = 0; i < m_budgets.size(); i++)
+			previous[i] = m_budgets[i].pressure;
+		queryBudget();
+
+		for (uint32_t i = 0; i < m_budgets.size(); i++)
+		{
+			const WyvHeapBudget &budget = m_budgets[i];
+			if (budget.pressure > previous[i])
+				WYV_LOG_WARN("Memory heap {} under {} pressure: {} of {} MB budget used, {} MB by Wyvern", i, PressureName(budget.pressure),
+					budget.usage / (1024 * 1024), budget.budget / (1024 * 1024), budget.allocatorBytes / (1024 * 1024));
+			else if (budget.pressure == WYV_MEMORY_PRESSURE_NONE && previous[i] != WYV_MEMORY_PRESSURE_NONE)
+				WYV_LOG_INFO("Memory heap {} back within budget, {} of {} MB used", i, budget.usage / (1024 * 1024), budget.budget / (1024 * 1024));
+			if (budget.pressure != WYV_MEMORY_PRESSURE_NONE || previous[i] != WYV_MEMORY_PRESSURE_NONE)
+				notify.push_back(std::make_pair(i, budget));
+		}
+		if (!notify.empty())
+			callbacks = m_budgetCallbacks;
+	}
+	for (const auto &heap : notify)
+		for (const BudgetCallback &callback : callbacks)
+			callback(heap.first, heap.second);
+}
+
+void WyvMemory::addBudgetCallback(BudgetCallback _callback)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_budgetCallbacks.push_back(_callback);
+}
+
+void WyvMemory::setBudgetThresholds(float _throttle, float _evict)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_evictRatio = std::max(_evict, 0.0f);
+	m_throttleRatio = std::min(std::max(_throttle, 0.0f), m_evictRatio);
+}
+
+WyvHeapBudget WyvMemory::getBudget(uint32_t _heap)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return _heap < m_budgets.size() ? m_budgets[_heap] : WyvHeapBudget();
+}
+
+WyvMemoryPressure WyvMemory::getPressure(WyvMemoryUsage _usage)
+{
+	int memoryType = chooseMemoryType(UINT32_MAX, _usage);
+	if (memoryType < 0)
+		return WYV_MEMORY_PRESSURE_NONE;
+	return getBudget(m_properties.memoryTypes[memoryType].heapIndex).pressure;
+}
+
+WyvMemoryStats WyvMemory::getStats(int _memoryType)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	WyvMemoryStats stats;
+	for (const Pool &pool : m_pools)
+	{
+		if (_memoryType >= 0 && pool.memoryType != (uint32_t)_memoryType)
+			continue;
+		for (const auto &block : pool.blocks)
+		{
+			stats.blockCount++;
+			stats.blockBytes += block->tlsf.getSize();
+			stats.freeBytes += block->tlsf.getSize() - block->tlsf.getUsed();
+			stats.largestFree = std::max(stats.largestFree, block->tlsf.getLargestFree());
+			stats.allocationCount += block->tlsf.getAllocationCount();
+		}
+		//Slabs count as one TLSF allocation, count their used slots instead
+		for (const auto &slab : pool.slabs)
+		{
+			stats.allocationCount -= 1;
+			stats.allocationCount += (uint32_t)(SLAB_SIZE / slab->slotSize - slab->freeSlots.size());
+		}
+	}
+	for (uint32_t i = 0; i < m_dedicated.size(); i++)
+	{
+		if (_memoryType >= 0 && i != (uint32_t)_memoryType)
+			continue;
+		stats.dedicatedCount += m_dedicated[i].dedicatedCount;
+		stats.dedicatedBytes += m_dedicated[i].dedicatedBytes;
+		stats.usedBytes += m_usedBytes[i];
+	}
+	stats.allocationCount += stats.dedicatedCount;
+	stats.fragmentation = stats.freeBytes ? 1.0f - (float)stats.largestFree / stats.freeBytes : 0.0f;
+	return stats;
+}
+
+void WyvMemory::logStats()
+{
+	for (uint32_t i = 0; i < m_properties.memoryTypeCount; i++)
+	{
+		WyvMemoryStats stats = getStats((int)i);
+		if (!stats.blockCount && !stats.dedicatedCount)
+			continue;
+		WYV_LOG_INFO("Memory type {}: {} allocations using {} bytes, {} blocks of {} bytes, {} dedicated of {} bytes, {}% fragmented",
+			i, stats.allocationCount, (uint64_t)stats.usedBytes, stats.blockCount, (uint64_t)stats.blockBytes, stats.dedicatedCount, (uint64_t)stats.dedicatedBytes, stats.fragmentation * 100.0f);
+	}
+	for (uint32_t i = 0; i < m_properties.memoryHeapCount; i++)
+	{
+		WyvHeapBudget budget = getBudget(i);
+		WYV_LOG_INFO("Memory heap {}{}: {} of {} MB budget used, {} MB by Wyvern, {} MB heap", i, budget.deviceLocal ? " (device local)" : "",
+			budget.usage / (1024 * 1024), budget.budget / (1024 * 1024), budget.allocatorBytes / (1024 * 1024), budget.size / (1024 * 1024));
+	}
+	if (m_fallbacks || m_budgetRefusals)
+		WYV_LOG_INFO("{} allocations fell back to another memory type, {} were refused to stay within budget", m_fallbacks, m_budgetRefusals);
+}
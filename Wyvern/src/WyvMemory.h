@@ -0,0 +1,249 @@
+#ifndef _H_WYVMEMORY_
+#define _H_WYVMEMORY_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+namespace wyv
+{
+	//Two level segregated fit allocator over an abstract range, O(1) allocate and free with immediate coalescing
+	class WyvTlsf
+	{
+	public:
+		static const uint32_t NONE = 0xFFFFFFFF;
+		//Every offset and size is a multiple of this
+		static const VkDeviceSize GRANULE = 16;
+
+	private:
+		static const uint32_t SL_BITS = 5, SL_COUNT = 1 << SL_BITS, MIN_LOG2 = 8, FL_COUNT = 40;
+
+		struct Node
+		{
+			VkDeviceSize offset = 0, size = 0;
+			uint32_t prevPhysical = NONE, nextPhysical = NONE, prevFree = NONE, nextFree = NONE;
+			bool free = false;
+		};
+
+		std::vector<Node> m_nodes;
+		std::vector<uint32_t> m_unusedNodes;
+		uint64_t m_flBitmap = 0;
+		uint32_t m_slBitmap[FL_COUNT];
+		uint32_t m_heads[FL_COUNT][SL_COUNT];
+		VkDeviceSize m_size = 0, m_used = 0;
+		uint32_t m_allocationCount = 0, m_freeCount = 0;
+
+		static void Mapping(VkDeviceSize _size, uint32_t &_fl, uint32_t &_sl);
+		uint32_t newNode();
+		void releaseNode(uint32_t _node);
+		void insertFree(uint32_t _node);
+		void removeFree(uint32_t _node);
+		uint32_t findFree(VkDeviceSize _size) const;
+
+	public:
+		//Smallest range an allocation of _size at _alignment is guaranteed to fit in, free list rounding included
+		static VkDeviceSize RequiredSize(VkDeviceSize _size, VkDeviceSize _alignment);
+
+		void init(VkDeviceSize _size);
+
+		//Returns the node holding the allocation, NONE if there is no room
+		uint32_t allocate(VkDeviceSize _size, VkDeviceSize _alignment, VkDeviceSize &_offset);
+		void free(uint32_t _node);
+
+		VkDeviceSize getSize() const { return m_size; }
+		VkDeviceSize getUsed() const { return m_used; }
+		VkDeviceSize getNodeSize(uint32_t _node) const { return m_nodes[_node].size; }
+		uint32_t getAllocationCount() const { return m_allocationCount; }
+		//Number of separate free ranges
+		uint32_t getFreeRangeCount() const { return m_freeCount; }
+		VkDeviceSize getLargestFree() const;
+	};
+
+	//GPU_LAZY is for transient attachments, memory that tiled GPUs may never back. Other usages never get lazy memory.
+	enum WyvMemoryUsage { WYV_MEMORY_GPU_ONLY, WYV_MEMORY_CPU_TO_GPU, WYV_MEMORY_GPU_TO_CPU, WYV_MEMORY_CPU_ONLY, WYV_MEMORY_GPU_LAZY };
+	//WITHIN_BUDGET fails the allocation rather than take the heap past its budget, for work that can wait like streaming.
+	//MOVABLE is set by createMovableBuffer and createMovableImage, it keeps the allocation out of slabs.
+	enum WyvMemoryFlags { WYV_MEMORY_DEDICATED = 1, WYV_MEMORY_WITHIN_BUDGET = 2, WYV_MEMORY_MOVABLE = 4 };
+
+	//How close a heap is to its budget. THROTTLE asks streaming to hold back, EVICT to drop detail such as lower mips.
+	enum WyvMemoryPressure { WYV_MEMORY_PRESSURE_NONE, WYV_MEMORY_PRESSURE_THROTTLE, WYV_MEMORY_PRESSURE_EVICT };
+
+	struct WyvMemoryBlock
+	{
+		uint32_t pool = 0;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		uint8_t *mapped = nullptr;
+		WyvTlsf tlsf;
+	};
+
+	//Equal slots cut from one TLSF allocation, all of a single size class
+	struct WyvMemorySlab
+	{
+		WyvMemoryBlock *block = nullptr;
+		uint32_t node = WyvTlsf::NONE, sizeClass = 0;
+		VkDeviceSize offset = 0, slotSize = 0;
+		std::vector<uint32_t> freeSlots;
+		size_t availableIndex = SIZE_MAX; //Position in the pool's available list, SIZE_MAX while full
+	};
+
+	struct WyvAllocation;
+
+	//How to recreate a resource the defragmenter may move. Families is what the concurrent sharing mode points at.
+	struct WyvMovable
+	{
+		VkBufferCreateInfo bufferInfo = {};
+		VkImageCreateInfo imageInfo = {};
+		std::vector<uint32_t> families;
+		VkMemoryRequirements requirements = {};
+		//The layout an image is kept in between uses, it is left in the same layout after a move
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		std::function<void(WyvAllocation*)> onMove;
+		//Transfer queue value of a move still copying into the allocation, 0 otherwise
+		uint64_t pendingMove = 0;
+	};
+
+	//A sub-allocation. Bind with memory and offset; mapped is set when the memory is host visible.
+	struct WyvAllocation
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0, size = 0;
+		uint8_t *mapped = nullptr;
+		uint32_t memoryType = 0;
+
+		//Where it came from: a slab slot, a TLSF node of a block, or neither for dedicated memory
+		WyvMemoryBlock *block = nullptr;
+		WyvMemorySlab *slab = nullptr;
+		uint32_t node = WyvTlsf::NONE;
+
+		//Set for movable resources, whose handle is owned here and changes when the defragmenter moves them
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkImage image = VK_NULL_HANDLE;
+		WyvMovable *movable = nullptr;
+	};
+
+	struct WyvMemoryStats
+	{
+		uint32_t blockCount = 0, allocationCount = 0, dedicatedCount = 0;
+		VkDeviceSize blockBytes = 0, usedBytes = 0, dedicatedBytes = 0, freeBytes = 0, largestFree = 0;
+		//1 - largest free range / free bytes, 0 when all free space is contiguous
+		float fragmentation = 0.0f;
+	};
+
+	//usage is what the whole process uses of the heap, including other APIs, as of the last query plus what this allocator
+	//allocated since. Without VK_EXT_memory_budget it is only this allocator's memory and the budget a share of the heap.
+	struct WyvHeapBudget
+	{
+		VkDeviceSize size = 0, budget = 0, usage = 0, allocatorBytes = 0;
+		bool deviceLocal = false;
+		WyvMemoryPressure pressure = WYV_MEMORY_PRESSURE_NONE;
+	};
+
+	//Carves large VkDeviceMemory blocks per memory type. Allocations up to SMALL_LIMIT come from fixed size slots of
+	//slabs, larger ones from a TLSF per block, and ones over half a block or asking for it get dedicated memory.
+	//When bufferImageGranularity is above 1, linear and optimal resources use separate blocks so they never share a page.
+	class WyvMemory
+	{
+		friend class WyvDefragmenter;
+
+	public:
+		typedef std::function<void(uint32_t, const WyvHeapBudget&)> BudgetCallback;
+		typedef std::function<void(WyvAllocation*)> MoveCallback;
+
+	private:
+		static const uint32_t SIZE_CLASS_COUNT = 9;
+
+		struct Pool
+		{
+			uint32_t memoryType = 0;
+			VkDeviceSize blockSize = 0;
+			std::vector<std::unique_ptr<WyvMemoryBlock>> blocks;
+			std::vector<std::unique_ptr<WyvMemorySlab>> slabs;
+			//Slabs of each size class with a free slot
+			std::vector<WyvMemorySlab*> available[SIZE_CLASS_COUNT];
+		};
+
+		VkDevice m_device = VK_NULL_HANDLE;
+		VkPhysicalDeviceMemoryProperties m_properties = {};
+		VkDeviceSize m_granularity = 1, m_nonCoherentAtom = 1;
+		uint32_t m_maxAllocations = 0, m_deviceAllocations = 0;
+		std::vector<Pool> m_pools;
+		std::vector<WyvMemoryStats> m_dedicated;
+		std::vector<VkDeviceSize> m_usedBytes;
+		std::mutex m_mutex;
+
+		VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+		bool m_budgetExtension = false;
+		float m_throttleRatio = 0.85f, m_evictRatio = 0.95f;
+		std::vector<WyvHeapBudget> m_budgets;
+		std::vector<BudgetCallback> m_budgetCallbacks;
+		std::unordered_set<WyvAllocation*> m_movables;
+		uint32_t m_fallbacks = 0, m_budgetRefusals = 0;
+
+		int chooseMemoryType(uint32_t _typeBits, WyvMemoryUsage _usage) const;
+		bool fitsBudget(uint32_t _memoryType, VkDeviceSize _size) const;
+		void queryBudget();
+		VkDeviceMemory allocateDeviceMemory(uint32_t _memoryType, VkDeviceSize _size, const void *_pNext, bool _withinBudget);
+		void freeDeviceMemory(uint32_t _memoryType, VkDeviceMemory _memory, VkDeviceSize _size);
+		WyvMemoryBlock *createBlock(Pool &_pool, VkDeviceSize _size, bool _withinBudget);
+		void releaseIfEmpty(Pool &_pool, WyvMemoryBlock *_block);
+		bool allocateLarge(Pool &_pool, VkDeviceSize _size, VkDeviceSize _alignment, WyvAllocation &_allocation, bool _withinBudget);
+		bool allocateSmall(Pool &_pool, VkDeviceSize _size, VkDeviceSize _alignment, WyvAllocation &_allocation, bool _withinBudget);
+		void freeSmall(Pool &_pool, WyvAllocation &_allocation);
+		WyvAllocation *allocateDedicated(uint32_t _memoryType, const VkMemoryRequirements &_requirements, VkBuffer _buffer, VkImage _image, bool _withinBudget);
+		WyvAllocation *bindMovable(WyvMovable *_movable, VkBuffer _buffer, VkImage _image, WyvMemoryUsage _usage);
+		WyvAllocation *allocateFromType(uint32_t _memoryType, const VkMemoryRequirements &_requirements, bool _linear, uint32_t _flags, VkBuffer _buffer, VkImage _image);
+		WyvAllocation *allocate(const VkMemoryRequirements &_requirements, WyvMemoryUsage _usage, bool _linear, uint32_t _flags, VkBuffer _buffer, VkImage _image);
+
+	public:
+		static const VkDeviceSize SMALL_LIMIT = 64 * 1024, SLAB_SIZE = 1024 * 1024, MAX_BLOCK_SIZE = 256 * 1024 * 1024;
+
+		WyvMemory() {}
+		WyvMemory(const WyvMemory&) = delete;
+		WyvMemory &operator=(const WyvMemory&) = delete;
+
+		//_budgetExtension is whether VK_EXT_memory_budget was enabled on the device
+		void create(VkDevice _device, VkPhysicalDevice _physicalDevice, bool _budgetExtension = false);
+		void destroy();
+
+		//_linear is true for buffers and linear images, false for optimal images
+		WyvAllocation *allocate(const VkMemoryRequirements &_requirements, WyvMemoryUsage _usage, bool _linear, uint32_t _flags = 0) { return allocate(_requirements, _usage, _linear, _flags, VK_NULL_HANDLE, VK_NULL_HANDLE); }
+		//Allocate and bind, honouring the driver's dedicated allocation preference. Returns nullptr when out of memory.
+		WyvAllocation *allocateBuffer(VkBuffer _buffer, WyvMemoryUsage _usage, uint32_t _flags = 0);
+		WyvAllocation *allocateImage(VkImage _image, WyvMemoryUsage _usage, uint32_t _flags = 0);
+		//Also destroys the buffer or image of movable allocations
+		void free(WyvAllocation *_allocation);
+
+		//Buffers and images the defragmenter may move to compact memory. The handle lives in the allocation and is replaced
+		//when it moves, after which _onMove runs so the owner can rebuild views and descriptors. The GPU must only read
+		//them, and images must stay in _layout between uses. Sharing is made concurrent between the queue families.
+		WyvAllocation *createMovableBuffer(const VkBufferCreateInfo &_info, WyvMemoryUsage _usage, MoveCallback _onMove = nullptr);
+		WyvAllocation *createMovableImage(const VkImageCreateInfo &_info, VkImageLayout _layout, WyvMemoryUsage _usage, MoveCallback _onMove = nullptr);
+
+		//Needed around CPU access to memory that isn't host coherent, no-ops otherwise. The range is relative to the allocation.
+		void flush(const WyvAllocation *_allocation, VkDeviceSize _offset = 0, VkDeviceSize _size = VK_WHOLE_SIZE);
+		void invalidate(const WyvAllocation *_allocation, VkDeviceSize _offset = 0, VkDeviceSize _size = VK_WHOLE_SIZE);
+		bool isCoherent(uint32_t _memoryType) const { return (m_properties.memoryTypes[_memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0; }
+
+		//Queries the heap budgets, called by render targets once per frame. Budget callbacks run for every heap under
+		//pressure and once more when a heap leaves it, without the allocator locked so they can free memory.
+		void updateBudget();
+		void addBudgetCallback(BudgetCallback _callback);
+		//Fractions of the budget at which a heap reaches THROTTLE and EVICT pressure
+		void setBudgetThresholds(float _throttle, float _evict);
+		WyvHeapBudget getBudget(uint32_t _heap);
+		uint32_t getHeapCount() const { return m_properties.memoryHeapCount; }
+		//Pressure on the heap a usage would allocate from, for streaming code deciding whether to load more
+		WyvMemoryPressure getPressure(WyvMemoryUsage _usage);
+
+		//Stats of one memory type, or of all of them with -1
+		WyvMemoryStats getStats(int _memoryType = -1);
+		void logStats();
+	};
+}
+
+#endif //_H_WYVMEMORY_
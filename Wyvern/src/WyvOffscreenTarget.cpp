@@ -0,0 +1,94 @@
+#include "WyvOffscreenTarget.h"
+
+#include <algorithm>
+
+using namespace wyv;
+
+const uint32_t WyvOffscreenTarget::DEFAULT_IMAGE_COUNT;
+
+WyvOffscreenTarget::WyvOffscreenTarget(std::string _name, unsigned _width, unsigned _height, VkFormat _format, uint32_t _imageCount) : WyvRenderTarget(_name, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+{
+	if (!Wyvern::GetDevice())
+		Wyvern::Fail("Offscreen target '" + _name + "' created before Wyvern initialisation complete");
+
+	m_format = _format;
+	m_extent = { _width, _height };
+	createRenderPass();
+	createImages(std::max(_imageCount, 1u));
+	createImageViews();
+	createFrames();
+	WYV_LOG_MESSAGE("Offscreen target '{}' created: {}x{}, {} images", m_name, _width, _height, (uint32_t)m_images.size());
+}
+
+WyvOffscreenTarget::~WyvOffscreenTarget()
+{
+	reportFrameStats();
+	destroyFrames();
+	WyvQueue &queue = Wyvern::GetQueue(WYV_QUEUE_GRAPHICS);
+	for (uint64_t value : m_imageValues)
+		queue.wait(value);
+	destroyImageViews();
+	destroyImages();
+	vkDestroyRenderPass(Wyvern::GetDevice(), m_renderPass, Wyvern::GetAllocator());
+}
+
+void WyvOffscreenTarget::createImages(uint32_t _count)
+{
+	VkDevice device = Wyvern::GetDevice();
+	m_images.resize(_count);
+	m_memory.resize(_count);
+	m_imageValues.assign(_count, 0);
+	for (uint32_t i = 0; i < _count; i++)
+	{
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = m_format;
+		imageInfo.extent = { m_extent.width, m_extent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		if (vkCreateImage(device, &imageInfo, Wyvern::GetAllocator(), &m_images[i]) != VK_SUCCESS)
+			Wyvern::Fail("Offscreen target '" + m_name + "' image creation failed");
+
+		m_memory[i] = Wyvern::GetMemory().allocateImage(m_images[i], WYV_MEMORY_GPU_ONLY);
+		if (!m_memory[i])
+			Wyvern::Fail("Offscreen target '" + m_name + "' image memory allocation failed");
+	}
+}
+
+void WyvOffscreenTarget::destroyImages()
+{
+	VkDevice device = Wyvern::GetDevice();
+	for (size_t i = 0; i < m_images.size(); i++)
+	{
+		vkDestroyImage(device, m_images[i], Wyvern::GetAllocator());
+		Wyvern::GetMemory().free(m_memory[i]);
+	}
+	m_images.clear();
+	m_memory.clear();
+	m_imageValues.clear();
+}
+
+bool WyvOffscreenTarget::acquireImage(Frame &_frame)
+{
+	//Only blocks when the CPU is a full m_framesInFlight frames ahead of the GPU, or the ring is shorter than that
+	WyvQueue &queue = Wyvern::GetQueue(WYV_QUEUE_GRAPHICS);
+	queue.wait(_frame.submitValue);
+	m_imageIndex = m_nextImage;
+	m_nextImage = (m_nextImage + 1) % (uint32_t)m_images.size();
+	queue.wait(m_imageValues[m_imageIndex]);
+	queue.getTimeline().collect();
+	return true;
+}
+
+uint64_t WyvOffscreenTarget::submitFrame(Frame &_frame)
+{
+	uint64_t submitValue = Wyvern::Submit(WYV_QUEUE_GRAPHICS, WyvSubmitInfo(_frame.commandBuffer));
+	m_imageValues[m_imageIndex] = submitValue;
+	return submitValue;
+}
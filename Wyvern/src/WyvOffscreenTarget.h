@@ -0,0 +1,39 @@
+#ifndef _H_WYVOFFSCREENTARGET_
+#define _H_WYVOFFSCREENTARGET_
+
+#include "WyvRenderTarget.h"
+
+namespace wyv
+{
+	class WyvOffscreenTarget;
+	typedef std::shared_ptr<WyvOffscreenTarget> SharedOffscreenTarget;
+	//Renders into a ring of device images instead of a swapchain, for headless rendering without a display.
+	//Finished images are left in TRANSFER_SRC_OPTIMAL so they can be copied out.
+	class WyvOffscreenTarget : public WyvRenderTarget
+	{
+		std::vector<WyvAllocation*> m_memory;
+		//Graphics timeline value of the last frame rendered to each image
+		std::vector<uint64_t> m_imageValues;
+		uint32_t m_nextImage = 0;
+
+		void createImages(uint32_t _count);
+		void destroyImages();
+
+		bool acquireImage(Frame &_frame) override;
+		uint64_t submitFrame(Frame &_frame) override;
+
+	public:
+		static const uint32_t DEFAULT_IMAGE_COUNT = 3;
+
+		WyvOffscreenTarget(std::string _name, unsigned _width, unsigned _height, VkFormat _format = VK_FORMAT_R8G8B8A8_UNORM, uint32_t _imageCount = DEFAULT_IMAGE_COUNT);
+		~WyvOffscreenTarget();
+
+		//Submission that last rendered image _index, wait on it before reading the image
+		uint64_t getImageSubmitValue(uint32_t _index) const { return m_imageValues[_index]; }
+
+		static SharedOffscreenTarget CreateShared(std::string _name, unsigned _width, unsigned _height, VkFormat _format = VK_FORMAT_R8G8B8A8_UNORM, uint32_t _imageCount = DEFAULT_IMAGE_COUNT)
+			{ return std::make_shared<WyvOffscreenTarget>(_name, _width, _height, _format, _imageCount); }
+	};
+}
+
+#endif //_H_WYVOFFSCREENTARGET_
@@ -0,0 +1,91 @@
+#include "WyvParallelRecorder.h"
+
+#include <algorithm>
+
+using namespace wyv;
+
+const uint32_t WyvParallelRecorder::MIN_CHUNK_DRAWS, WyvParallelRecorder::CHUNKS_PER_THREAD;
+
+void WyvParallelRecorder::create(const std::string &_name, uint32_t _threads)
+{
+	destroy();
+	m_name = _name;
+	m_threads.create(_threads);
+	//One slot more than the target can have in flight, so the pools never wait on the GPU before the target does
+	m_commandPools.create(_name, WYV_QUEUE_GRAPHICS, WyvRenderTarget::MAX_FRAMES_IN_FLIGHT + 1);
+	WYV_LOG_MESSAGE("'{}' records on {} threads", m_name, m_threads.getThreadCount());
+}
+
+void WyvParallelRecorder::destroy()
+{
+	if (m_name.empty())
+		return;
+	if (m_records)
+		WYV_LOG_MESSAGE("'{}': {} draws in {} chunks over {} recordings", m_name, m_draws, m_chunkCount, m_records);
+	m_threads.destroy();
+	m_commandPools.destroy();
+	m_chunks.clear();
+	m_hooked = false;
+	m_draws = m_chunkCount = m_records = 0;
+	m_name.clear();
+}
+
+uint32_t WyvParallelRecorder::record(WyvRenderTarget &_target, VkCommandBuffer _primary, uint32_t _drawCount, const RecordFunction &_record)
+{
+	if (!_target.isInFrame() || !_drawCount)
+		return 0;
+	m_records++;
+	m_draws += _drawCount;
+	if (_target.getSubpassContents() != VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+	{
+		_record(_primary, 0, _drawCount);
+		return 0;
+	}
+
+	//A few chunks per thread keeps threads busy when draws cost unevenly, the minimum keeps chunks worth a command buffer
+	uint32_t perChunk = std::max(MIN_CHUNK_DRAWS, (_drawCount + m_threads.getThreadCount() * CHUNKS_PER_THREAD - 1) / (m_threads.getThreadCount() * CHUNKS_PER_THREAD));
+	uint32_t chunkCount = (_drawCount + perChunk - 1) / perChunk;
+	m_chunks.assign(chunkCount, VK_NULL_HANDLE);
+
+	VkCommandBufferInheritanceInfo inheritance = {};
+	inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritance.renderPass = _target.getRenderPass();
+	inheritance.subpass = 0;
+	inheritance.framebuffer = _target.getFramebuffer();
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritance;
+
+	m_threads.parallelFor(chunkCount, [&](uint32_t _chunk)
+	{
+		VkCommandBuffer commandBuffer = m_commandPools.getSecondary();
+		if (!commandBuffer)
+			return;
+		uint32_t first = _chunk * perChunk;
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		_record(commandBuffer, first, std::min(perChunk, _drawCount - first));
+		vkEndCommandBuffer(commandBuffer);
+		m_chunks[_chunk] = commandBuffer;
+	});
+
+	size_t recorded = m_chunks.size();
+	m_chunks.erase(std::remove(m_chunks.begin(), m_chunks.end(), (VkCommandBuffer)VK_NULL_HANDLE), m_chunks.end());
+	if (m_chunks.size() != recorded)
+		WYV_LOG_ERROR("'{}' dropped {} of {} chunks without a command buffer", m_name, (uint32_t)(recorded - m_chunks.size()), (uint32_t)recorded);
+	if (!m_chunks.empty())
+		vkCmdExecuteCommands(_primary, (uint32_t)m_chunks.size(), m_chunks.data());
+	m_chunkCount += m_chunks.size();
+
+	//The pools move on to the next frame once this one is submitted
+	if (!m_hooked)
+	{
+		m_hooked = true;
+		_target.addFrameHook(nullptr, [this](uint64_t _value)
+		{
+			m_commandPools.endFrame(_value);
+			m_hooked = false;
+		});
+	}
+	return (uint32_t)m_chunks.size();
+}
@@ -0,0 +1,55 @@
+#ifndef _H_WYVPARALLELRECORDER_
+#define _H_WYVPARALLELRECORDER_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "WyvCommandPools.h"
+#include "WyvRenderTarget.h"
+#include "WyvThreadPool.h"
+
+namespace wyv
+{
+	//Records a list of draws across threads. The list is split into chunks, each recorded on a worker into a secondary
+	//command buffer that inherits the target's render pass and framebuffer, and the chunks are executed in list order
+	//from the frame's primary command buffer. The target's frame must have begun with
+	//VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS; a frame begun inline is recorded into the primary on the calling thread.
+	//The command buffers follow the target's frames, so each recorder serves a single target.
+	class WyvParallelRecorder
+	{
+		std::string m_name;
+		WyvThreadPool m_threads;
+		WyvCommandPools m_commandPools;
+		std::vector<VkCommandBuffer> m_chunks;
+		//Whether endFrame of the command pools is hooked to the current frame's submission yet
+		bool m_hooked = false;
+		uint64_t m_draws = 0, m_chunkCount = 0, m_records = 0;
+
+	public:
+		//Receives the command buffer and the range of draws to record. Secondaries start with no state set,
+		//so every chunk binds its pipeline and sets its dynamic state itself.
+		typedef std::function<void(VkCommandBuffer, uint32_t, uint32_t)> RecordFunction;
+
+		static const uint32_t MIN_CHUNK_DRAWS = 128, CHUNKS_PER_THREAD = 4;
+
+		WyvParallelRecorder() {}
+		~WyvParallelRecorder() { destroy(); }
+
+		WyvParallelRecorder(const WyvParallelRecorder&) = delete;
+		WyvParallelRecorder &operator=(const WyvParallelRecorder&) = delete;
+
+		//_threads counts the calling thread, 0 means one per hardware thread
+		void create(const std::string &_name, uint32_t _threads = 0);
+		void destroy();
+
+		//Records _drawCount draws into _target's current frame, call between its beginFrame and endFrame.
+		//Returns the number of secondary command buffers executed.
+		uint32_t record(WyvRenderTarget &_target, VkCommandBuffer _primary, uint32_t _drawCount, const RecordFunction &_record);
+
+		uint32_t getThreadCount() const { return m_threads.getThreadCount(); }
+		WyvThreadPool &getThreadPool() { return m_threads; }
+	};
+}
+
+#endif //_H_WYVPARALLELRECORDER_
@@ -0,0 +1,194 @@
+#include "WyvPipelineCache.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif //_WIN32
+
+#include "Wyvern.h"
+
+using namespace wyv;
+
+const uint32_t WyvPipelineCache::VERSION;
+
+uint64_t WyvPipelineCache::Checksum(const void *_data, size_t _size)
+{
+	//FNV-1a, only meant to catch truncated or torn files
+	uint64_t hash = 14695981039346656037ull;
+	const uint8_t *bytes = (const uint8_t*)_data;
+	for (size_t i = 0; i < _size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+bool WyvPipelineCache::matches(const FileHeader &_header) const
+{
+	return !memcmp(_header.magic, "WYPC", 4) && _header.version == VERSION
+		&& _header.vendorID == m_properties.vendorID && _header.deviceID == m_properties.deviceID
+		&& _header.driverVersion == m_properties.driverVersion
+		&& !memcmp(_header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+bool WyvPipelineCache::read(std::string &_data) const
+{
+	std::ifstream file(m_path, std::ios::binary);
+	if (!file)
+		return false;
+
+	FileHeader header;
+	if (!file.read((char*)&header, sizeof(header)))
+	{
+		WYV_LOG_WARN("Pipeline cache '{}' is truncated, discarding", m_path);
+		return false;
+	}
+	if (!matches(header))
+	{
+		WYV_LOG_MESSAGE("Pipeline cache '{}' was written for another device or driver, discarding", m_path);
+		return false;
+	}
+
+	_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	if (_data.size() != header.dataSize || Checksum(_data.data(), _data.size()) != header.checksum)
+	{
+		WYV_LOG_WARN("Pipeline cache '{}' is corrupt, discarding", m_path);
+		_data.clear();
+		return false;
+	}
+
+	//The driver checks its own header too (headerSize, headerVersion, vendorID, deviceID, UUID), but a mismatch is cheaper to catch here
+	uint32_t driverHeader[4];
+	if (_data.size() < sizeof(driverHeader) + VK_UUID_SIZE)
+		return false;
+	memcpy(driverHeader, _data.data(), sizeof(driverHeader));
+	if (driverHeader[1] != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || driverHeader[2] != m_properties.vendorID || driverHeader[3] != m_properties.deviceID
+		|| memcmp(_data.data() + sizeof(driverHeader), m_properties.pipelineCacheUUID, VK_UUID_SIZE))
+	{
+		_data.clear();
+		return false;
+	}
+	return true;
+}
+
+bool WyvPipelineCache::writeAtomic(const std::string &_data) const
+{
+	//Write a sibling file, flush it to disk and rename it over the old cache so a crash
+	//at any point leaves either the previous cache or the complete new one
+	std::string tempPath = m_path + ".tmp";
+	FILE *file = fopen(tempPath.c_str(), "wb");
+	if (!file)
+		return false;
+
+	FileHeader header = {};
+	memcpy(header.magic, "WYPC", 4);
+	header.version = VERSION;
+	header.vendorID = m_properties.vendorID;
+	header.deviceID = m_properties.deviceID;
+	header.driverVersion = m_properties.driverVersion;
+	memcpy(header.pipelineCacheUUID, m_properties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = _data.size();
+	header.checksum = Checksum(_data.data(), _data.size());
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 && fwrite(_data.data(), 1, _data.size(), file) == _data.size() && !fflush(file);
+#ifdef _WIN32
+	written = written && FlushFileBuffers((HANDLE)_get_osfhandle(_fileno(file)));
+#else
+	written = written && !fsync(fileno(file));
+#endif //_WIN32
+	written = !fclose(file) && written;
+
+	if (written)
+	{
+#ifdef _WIN32
+		written = MoveFileExA(tempPath.c_str(), m_path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+		written = !rename(tempPath.c_str(), m_path.c_str());
+#endif //_WIN32
+	}
+	if (!written)
+		remove(tempPath.c_str());
+	return written;
+}
+
+void WyvPipelineCache::create(VkDevice _device, VkPhysicalDevice _physicalDevice, const std::string &_path)
+{
+	auto start = std::chrono::steady_clock::now();
+	m_path = _path;
+	vkGetPhysicalDeviceProperties(_physicalDevice, &m_properties);
+
+	std::string data;
+	bool warm = !m_path.empty() && read(data);
+
+	VkPipelineCacheCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = data.size();
+	createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	if (vkCreatePipelineCache(_device, &createInfo, Wyvern::GetAllocator(), &m_cache) != VK_SUCCESS)
+	{
+		//A driver may still reject data that passed our checks, start cold rather than without a cache
+		createInfo.initialDataSize = 0;
+		createInfo.pInitialData = nullptr;
+		warm = false;
+		if (vkCreatePipelineCache(_device, &createInfo, Wyvern::GetAllocator(), &m_cache) != VK_SUCCESS)
+		{
+			WYV_LOG_WARN("Pipeline cache creation failed, pipelines will not be cached");
+			m_cache = VK_NULL_HANDLE;
+			return;
+		}
+	}
+
+	if (warm)
+	{
+		m_loadedSize = data.size();
+		m_loadedChecksum = Checksum(data.data(), data.size());
+	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	if (warm)
+		WYV_LOG_INFO("Pipeline cache warm: {} bytes loaded from '{}' in {} ms", data.size(), m_path, ms);
+	else
+		WYV_LOG_INFO("Pipeline cache cold, created in {} ms", ms);
+}
+
+void WyvPipelineCache::save(VkDevice _device)
+{
+	if (!m_cache || m_path.empty())
+		return;
+
+	size_t size = 0;
+	if (vkGetPipelineCacheData(_device, m_cache, &size, nullptr) != VK_SUCCESS || !size)
+		return;
+	std::string data(size, '\0');
+	if (vkGetPipelineCacheData(_device, m_cache, &size, &data[0]) != VK_SUCCESS)
+		return;
+	data.resize(size);
+
+	if (size == m_loadedSize && Checksum(data.data(), size) == m_loadedChecksum)
+		return;
+
+	if (writeAtomic(data))
+		WYV_LOG_INFO("Pipeline cache saved: {} bytes to '{}'", size, m_path);
+	else
+		WYV_LOG_WARN("Pipeline cache could not be written to '{}'", m_path);
+}
+
+void WyvPipelineCache::destroy(VkDevice _device)
+{
+	if (m_cache)
+		vkDestroyPipelineCache(_device, m_cache, Wyvern::GetAllocator());
+	m_cache = VK_NULL_HANDLE;
+	m_loadedSize = m_loadedChecksum = 0;
+}
@@ -0,0 +1,51 @@
+#ifndef _H_WYVPIPELINECACHE_
+#define _H_WYVPIPELINECACHE_
+
+#include <cstdint>
+#include <string>
+
+#include "vulkan/vulkan.h"
+
+namespace wyv
+{
+	//VkPipelineCache persisted between runs. The file is only reused if it was written for the
+	//same vendor, device, driver version and pipelineCacheUUID, and is replaced atomically on save.
+	class WyvPipelineCache
+	{
+		struct FileHeader
+		{
+			char magic[4];
+			uint32_t version;
+			uint32_t vendorID;
+			uint32_t deviceID;
+			uint32_t driverVersion;
+			uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+			uint64_t dataSize;
+			uint64_t checksum;
+		};
+
+		static const uint32_t VERSION = 1;
+
+		VkPipelineCache m_cache = VK_NULL_HANDLE;
+		VkPhysicalDeviceProperties m_properties = {};
+		std::string m_path;
+		uint64_t m_loadedSize = 0, m_loadedChecksum = 0;
+
+		bool read(std::string &_data) const;
+		bool writeAtomic(const std::string &_data) const;
+		bool matches(const FileHeader &_header) const;
+
+		static uint64_t Checksum(const void *_data, size_t _size);
+
+	public:
+		WyvPipelineCache() {}
+
+		void create(VkDevice _device, VkPhysicalDevice _physicalDevice, const std::string &_path);
+		void save(VkDevice _device);
+		void destroy(VkDevice _device);
+
+		VkPipelineCache get() const { return m_cache; }
+	};
+}
+
+#endif //_H_WYVPIPELINECACHE_
@@ -0,0 +1,210 @@
+#include "WyvQueue.h"
+
+#include "Wyvern.h"
+
+using namespace wyv;
+
+void WyvSubmitInfo::wait(const WyvQueueHandoff &_handoff)
+{
+	if (_handoff.getSemaphore())
+		wait(_handoff.getSemaphore(), _handoff.getDestinationStage());
+}
+
+void WyvSubmitInfo::signal(const WyvQueueHandoff &_handoff)
+{
+	if (_handoff.getSemaphore())
+		signalSemaphores.push_back(_handoff.getSemaphore());
+}
+
+void WyvSubmitInfo::wait(WyvQueueRole _role, uint64_t _value, VkPipelineStageFlags _stage)
+{
+	WyvTimeline &timeline = Wyvern::GetQueue(_role).getTimeline();
+	if (timeline.usesSemaphore())
+		wait(timeline.getSemaphore(), _stage, _value);
+	else
+		hostWaits.push_back(std::make_pair(_role, _value));
+}
+
+void WyvQueue::create(VkDevice _device, uint32_t _family, uint32_t _index, bool _useTimelineSemaphore)
+{
+	m_family = _family;
+	vkGetDeviceQueue(_device, _family, _index, &m_queue);
+	m_timeline.create(_device, _useTimelineSemaphore);
+}
+
+void WyvQueue::destroy()
+{
+	m_timeline.destroy();
+	m_queue = VK_NULL_HANDLE;
+}
+
+void WyvQueue::waitBeforeNextSubmit(WyvQueueRole _role, uint64_t _value, VkPipelineStageFlags _stage)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_deferredWaits.push_back({ _role, _value, _stage });
+}
+
+uint64_t WyvQueue::submit(const WyvSubmitInfo &_info)
+{
+	std::vector<DeferredWait> deferred;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		deferred.swap(m_deferredWaits);
+	}
+	WyvSubmitInfo merged;
+	if (!deferred.empty())
+	{
+		merged = _info;
+		for (const DeferredWait &wait : deferred)
+			merged.wait(wait.role, wait.value, wait.stage);
+	}
+	const WyvSubmitInfo &info = deferred.empty() ? _info : merged;
+
+	for (auto &hostWait : info.hostWaits)
+		Wyvern::GetQueue(hostWait.first).wait(hostWait.second);
+
+	std::vector<VkSemaphore> signalSemaphores = info.signalSemaphores;
+	std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+
+	VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = (uint32_t)info.commandBuffers.size();
+	submitInfo.pCommandBuffers = info.commandBuffers.data();
+	submitInfo.waitSemaphoreCount = (uint32_t)info.waitSemaphores.size();
+	submitInfo.pWaitSemaphores = info.waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = info.waitStages.data();
+
+	uint64_t value;
+	VkResult result;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		VkFence fence;
+		value = m_timeline.beginSubmit(fence);
+		if (m_timeline.usesSemaphore())
+		{
+			signalSemaphores.push_back(m_timeline.getSemaphore());
+			signalValues.push_back(value);
+			timelineInfo.waitSemaphoreValueCount = (uint32_t)info.waitValues.size();
+			timelineInfo.pWaitSemaphoreValues = info.waitValues.data();
+			timelineInfo.signalSemaphoreValueCount = (uint32_t)signalValues.size();
+			timelineInfo.pSignalSemaphoreValues = signalValues.data();
+			submitInfo.pNext = &timelineInfo;
+		}
+		submitInfo.signalSemaphoreCount = (uint32_t)signalSemaphores.size();
+		submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+		result = vkQueueSubmit(m_queue, 1, &submitInfo, fence);
+		if (result != VK_SUCCESS)
+			m_timeline.cancelSubmit(value, fence);
+	}
+	if (result != VK_SUCCESS)
+		Wyvern::Fail("Queue submission failed with error " + std::to_string(result));
+
+	m_timeline.collect();
+	return value;
+}
+
+VkResult WyvQueue::present(const VkPresentInfoKHR &_info)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return vkQueuePresentKHR(m_queue, &_info);
+}
+
+void WyvQueue::waitIdle()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	vkQueueWaitIdle(m_queue);
+}
+
+WyvQueueHandoff::WyvQueueHandoff(WyvQueueRole _source, WyvQueueRole _destination, VkPipelineStageFlags _sourceStage, VkPipelineStageFlags _destinationStage)
+	: m_source(_source), m_destination(_destination), m_sourceStage(_sourceStage), m_destinationStage(_destinationStage)
+{
+	m_sourceFamily = Wyvern::GetQueue(_source).getFamily();
+	m_destinationFamily = Wyvern::GetQueue(_destination).getFamily();
+
+	//Roles that share a VkQueue are already ordered by submission order
+	if (&Wyvern::GetQueue(_source) != &Wyvern::GetQueue(_destination))
+	{
+		VkSemaphoreCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		if (vkCreateSemaphore(Wyvern::GetDevice(), &createInfo, Wyvern::GetAllocator(), &m_semaphore) != VK_SUCCESS)
+			Wyvern::Fail("Queue handoff semaphore creation failed");
+	}
+}
+
+WyvQueueHandoff::~WyvQueueHandoff()
+{
+	if (m_semaphore)
+		vkDestroySemaphore(Wyvern::GetDevice(), m_semaphore, Wyvern::GetAllocator());
+}
+
+void WyvQueueHandoff::addBuffer(VkBuffer _buffer, VkAccessFlags _sourceAccess, VkAccessFlags _destinationAccess, VkDeviceSize _offset, VkDeviceSize _size)
+{
+	VkBufferMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = _sourceAccess;
+	barrier.dstAccessMask = _destinationAccess;
+	barrier.srcQueueFamilyIndex = crossesFamilies() ? m_sourceFamily : VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = crossesFamilies() ? m_destinationFamily : VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = _buffer;
+	barrier.offset = _offset;
+	barrier.size = _size;
+	m_buffers.push_back(barrier);
+}
+
+void WyvQueueHandoff::addImage(VkImage _image, VkImageLayout _oldLayout, VkImageLayout _newLayout, VkAccessFlags _sourceAccess, VkAccessFlags _destinationAccess, VkImageSubresourceRange _range)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = _sourceAccess;
+	barrier.dstAccessMask = _destinationAccess;
+	barrier.oldLayout = _oldLayout;
+	barrier.newLayout = _newLayout;
+	barrier.srcQueueFamilyIndex = crossesFamilies() ? m_sourceFamily : VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = crossesFamilies() ? m_destinationFamily : VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = _image;
+	barrier.subresourceRange = _range;
+	m_images.push_back(barrier);
+}
+
+void WyvQueueHandoff::recordRelease(VkCommandBuffer _commandBuffer) const
+{
+	if (m_buffers.empty() && m_images.empty())
+		return;
+
+	if (!crossesFamilies())
+	{
+		//Same family, a single barrier covers both the execution dependency and any layout change
+		vkCmdPipelineBarrier(_commandBuffer, m_sourceStage, m_destinationStage, 0, 0, nullptr,
+			(uint32_t)m_buffers.size(), m_buffers.data(), (uint32_t)m_images.size(), m_images.data());
+		return;
+	}
+
+	//The release half only makes the writes available, visibility is the acquire's job
+	std::vector<VkBufferMemoryBarrier> buffers = m_buffers;
+	std::vector<VkImageMemoryBarrier> images = m_images;
+	for (VkBufferMemoryBarrier &barrier : buffers)
+		barrier.dstAccessMask = 0;
+	for (VkImageMemoryBarrier &barrier : images)
+		barrier.dstAccessMask = 0;
+	vkCmdPipelineBarrier(_commandBuffer, m_sourceStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+		(uint32_t)buffers.size(), buffers.data(), (uint32_t)images.size(), images.data());
+}
+
+void WyvQueueHandoff::recordAcquire(VkCommandBuffer _commandBuffer) const
+{
+	if (!crossesFamilies() || (m_buffers.empty() && m_images.empty()))
+		return;
+
+	std::vector<VkBufferMemoryBarrier> buffers = m_buffers;
+	std::vector<VkImageMemoryBarrier> images = m_images;
+	for (VkBufferMemoryBarrier &barrier : buffers)
+		barrier.srcAccessMask = 0;
+	for (VkImageMemoryBarrier &barrier : images)
+		barrier.srcAccessMask = 0;
+	vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_destinationStage, 0, 0, nullptr,
+		(uint32_t)buffers.size(), buffers.data(), (uint32_t)images.size(), images.data());
+}
@@ -0,0 +1,109 @@
+#ifndef _H_WYVQUEUE_
+#define _H_WYVQUEUE_
+
+#include <mutex>
+#include <vector>
+
+#include "WyvTimeline.h"
+
+namespace wyv
+{
+	//Roles are backed by dedicated queue families when the device has them, otherwise they share the graphics queue
+	enum WyvQueueRole { WYV_QUEUE_GRAPHICS, WYV_QUEUE_COMPUTE, WYV_QUEUE_TRANSFER, WYV_QUEUE_ROLE_COUNT };
+
+	class WyvQueueHandoff;
+
+	struct WyvSubmitInfo
+	{
+		std::vector<VkCommandBuffer> commandBuffers;
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<VkPipelineStageFlags> waitStages;
+		std::vector<uint64_t> waitValues; //0 for binary semaphores
+		std::vector<VkSemaphore> signalSemaphores;
+		std::vector<std::pair<WyvQueueRole, uint64_t>> hostWaits; //Cross-queue waits when timeline semaphores are unavailable
+
+		WyvSubmitInfo() {}
+		WyvSubmitInfo(VkCommandBuffer _commandBuffer) : commandBuffers(1, _commandBuffer) {}
+
+		void wait(VkSemaphore _semaphore, VkPipelineStageFlags _stage, uint64_t _value = 0) { waitSemaphores.push_back(_semaphore); waitStages.push_back(_stage); waitValues.push_back(_value); }
+		void wait(const WyvQueueHandoff &_handoff);
+		//Waits for submission _value of another role's queue on the GPU, or on the CPU before submitting in fence fallback mode
+		void wait(WyvQueueRole _role, uint64_t _value, VkPipelineStageFlags _stage);
+		void signal(const WyvQueueHandoff &_handoff);
+	};
+
+	//A VkQueue with the external synchronization Vulkan requires, so any thread can submit to a role.
+	//Each submit is numbered by the queue's timeline, which is how callers wait for or poll their work.
+	class WyvQueue
+	{
+		struct DeferredWait
+		{
+			WyvQueueRole role;
+			uint64_t value;
+			VkPipelineStageFlags stage;
+		};
+
+		VkQueue m_queue = VK_NULL_HANDLE;
+		uint32_t m_family = 0;
+		std::mutex m_mutex;
+		WyvTimeline m_timeline;
+		std::vector<DeferredWait> m_deferredWaits;
+
+	public:
+		WyvQueue() {}
+
+		WyvQueue(const WyvQueue&) = delete;
+		WyvQueue &operator=(const WyvQueue&) = delete;
+
+		void create(VkDevice _device, uint32_t _family, uint32_t _index, bool _useTimelineSemaphore);
+		void destroy();
+
+		//Returns the timeline value signalled when the submission completes
+		uint64_t submit(const WyvSubmitInfo &_info);
+		//Makes whichever submission comes next wait for _value of _role's queue, for work the submitter doesn't know about
+		void waitBeforeNextSubmit(WyvQueueRole _role, uint64_t _value, VkPipelineStageFlags _stage);
+		VkResult present(const VkPresentInfoKHR &_info);
+		void waitIdle();
+
+		VkQueue get() const { return m_queue; }
+		uint32_t getFamily() const { return m_family; }
+		WyvTimeline &getTimeline() { return m_timeline; }
+
+		bool isComplete(uint64_t _value) { return m_timeline.isComplete(_value); }
+		bool wait(uint64_t _value, uint64_t _timeout = UINT64_MAX) { return m_timeline.wait(_value, _timeout); }
+		//Defers _release until all work submitted to this queue so far has completed
+		void release(std::function<void()> _release) { m_timeline.release(std::move(_release)); }
+	};
+
+	//Moves buffers and images from one queue role to another. Records the release barriers on the source
+	//queue and the matching acquire barriers on the destination queue, and owns the semaphore that orders
+	//the two submissions. Collapses to a single barrier and no semaphore when both roles share a family.
+	class WyvQueueHandoff
+	{
+		WyvQueueRole m_source, m_destination;
+		uint32_t m_sourceFamily, m_destinationFamily;
+		VkPipelineStageFlags m_sourceStage, m_destinationStage;
+		VkSemaphore m_semaphore = VK_NULL_HANDLE;
+		std::vector<VkBufferMemoryBarrier> m_buffers;
+		std::vector<VkImageMemoryBarrier> m_images;
+
+	public:
+		WyvQueueHandoff(WyvQueueRole _source, WyvQueueRole _destination, VkPipelineStageFlags _sourceStage, VkPipelineStageFlags _destinationStage);
+		~WyvQueueHandoff();
+
+		WyvQueueHandoff(const WyvQueueHandoff&) = delete;
+		WyvQueueHandoff &operator=(const WyvQueueHandoff&) = delete;
+
+		void addBuffer(VkBuffer _buffer, VkAccessFlags _sourceAccess, VkAccessFlags _destinationAccess, VkDeviceSize _offset = 0, VkDeviceSize _size = VK_WHOLE_SIZE);
+		void addImage(VkImage _image, VkImageLayout _oldLayout, VkImageLayout _newLayout, VkAccessFlags _sourceAccess, VkAccessFlags _destinationAccess, VkImageSubresourceRange _range);
+
+		void recordRelease(VkCommandBuffer _commandBuffer) const;
+		void recordAcquire(VkCommandBuffer _commandBuffer) const;
+
+		bool crossesFamilies() const { return m_sourceFamily != m_destinationFamily; }
+		VkSemaphore getSemaphore() const { return m_semaphore; }
+		VkPipelineStageFlags getDestinationStage() const { return m_destinationStage; }
+	};
+}
+
+#endif //_H_WYVQUEUE_
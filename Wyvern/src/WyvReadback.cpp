@@ -0,0 +1,245 @@
+#include "WyvReadback.h"
+
+#include <algorithm>
+#include <memory>
+
+using namespace wyv;
+
+const uint32_t WyvReadback::DEFAULT_DEPTH;
+
+//The same numeric format with red and blue swapped
+static VkFormat SwizzledFormat(VkFormat _format)
+{
+	switch (_format)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM: return VK_FORMAT_B8G8R8A8_UNORM;
+	case VK_FORMAT_R8G8B8A8_SRGB: return VK_FORMAT_B8G8R8A8_SRGB;
+	case VK_FORMAT_R8G8B8A8_UINT: return VK_FORMAT_B8G8R8A8_UINT;
+	case VK_FORMAT_B8G8R8A8_UNORM: return VK_FORMAT_R8G8B8A8_UNORM;
+	case VK_FORMAT_B8G8R8A8_SRGB: return VK_FORMAT_R8G8B8A8_SRGB;
+	case VK_FORMAT_B8G8R8A8_UINT: return VK_FORMAT_R8G8B8A8_UINT;
+	default: return _format;
+	}
+}
+
+//Bytes per pixel, and whether the format is 8 bit RGBA or BGRA so it can be swizzled
+static uint32_t FormatSize(VkFormat _format, bool &_rgba8, bool &_bgra8)
+{
+	_rgba8 = _bgra8 = false;
+	switch (_format)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_R8G8B8A8_UINT:
+		_rgba8 = true;
+		return 4;
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+	case VK_FORMAT_B8G8R8A8_UINT:
+		_bgra8 = true;
+		return 4;
+	case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+	case VK_FORMAT_A2R10G10B10_UNORM_PACK32:
+	case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+	case VK_FORMAT_R32_SFLOAT:
+		return 4;
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+		return 8;
+	case VK_FORMAT_R32G32B32A32_SFLOAT:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+WyvReadback::WyvReadback(WyvOffscreenTarget &_target, WyvReadbackLayout _layout, uint32_t _depth) : m_target(_target), m_layout(_layout)
+{
+	bool rgba8, bgra8;
+	m_bytesPerPixel = FormatSize(m_target.getFormat(), rgba8, bgra8);
+	if (!m_bytesPerPixel)
+		Wyvern::Fail("Readback of '" + m_target.getName() + "' doesn't support the target's format");
+	if (m_layout != WYV_READBACK_NATIVE && !rgba8 && !bgra8)
+	{
+		Wyvern::Error("Readback of '" + m_target.getName() + "' can only repack 8 bit RGBA or BGRA targets, delivering the native layout");
+		m_layout = WYV_READBACK_NATIVE;
+	}
+	m_swizzle = (m_layout == WYV_READBACK_RGBA8 && bgra8) || (m_layout == WYV_READBACK_BGRA8 && rgba8);
+
+	VkDevice device = Wyvern::GetDevice();
+	VkExtent2D extent = m_target.getExtent();
+	m_size = (VkDeviceSize)extent.width * extent.height * m_bytesPerPixel;
+	if (m_swizzle)
+		m_scratch.resize((size_t)m_size);
+
+	m_slots.resize(std::max(_depth, 1u));
+	for (Slot &slot : m_slots)
+	{
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = m_size;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		if (vkCreateBuffer(device, &bufferInfo, Wyvern::GetAllocator(), &slot.buffer) != VK_SUCCESS)
+			Wyvern::Fail("Readback of '" + m_target.getName() + "' buffer creation failed");
+
+		//GPU_TO_CPU prefers cached memory, CPU reads from uncached memory are several times slower
+		slot.memory = Wyvern::GetMemory().allocateBuffer(slot.buffer, WYV_MEMORY_GPU_TO_CPU);
+		if (!slot.memory || !slot.memory->mapped)
+			Wyvern::Fail("Readback of '" + m_target.getName() + "' has no host visible memory");
+	}
+	WYV_LOG_MESSAGE("Readback of '{}' created: {} slots of {} bytes, {} memory", m_target.getName(), (uint32_t)m_slots.size(), (uint64_t)m_size,
+		Wyvern::GetMemory().isCoherent(m_slots[0].memory->memoryType) ? "coherent" : "cached");
+}
+
+WyvReadback::~WyvReadback()
+{
+	finish();
+	if (m_delivered)
+		WYV_LOG_INFO("Readback of '{}': {} frames delivered, {} dropped, {} frames/s, {} MB/s", m_target.getName(), m_delivered, m_dropped,
+			getFramesPerSecond(), getBytesPerSecond() / (1024.0 * 1024.0));
+
+	VkDevice device = Wyvern::GetDevice();
+	for (Slot &slot : m_slots)
+	{
+		vkDestroyBuffer(device, slot.buffer, Wyvern::GetAllocator());
+		Wyvern::GetMemory().free(slot.memory);
+	}
+}
+
+bool WyvReadback::capture(Callback _callback)
+{
+	poll();
+	Slot &slot = m_slots[m_next];
+	if (slot.state != SLOT_FREE)
+	{
+		m_dropped++;
+		return false;
+	}
+
+	VkImage image = m_target.getImage();
+	VkExtent2D extent = m_target.getExtent();
+	VkBuffer buffer = slot.buffer;
+	VkDeviceSize size = m_size;
+	auto record = [image, extent, buffer, size](VkCommandBuffer _commandBuffer)
+	{
+		//The render pass leaves the image in TRANSFER_SRC_OPTIMAL and its external dependency makes the colour writes visible to the copy
+		VkBufferImageCopy region = {};
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageExtent = { extent.width, extent.height, 1 };
+		vkCmdCopyImageToBuffer(_commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+		VkBufferMemoryBarrier bufferBarrier = {};
+		bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.buffer = buffer;
+		bufferBarrier.size = size;
+		vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+	};
+	Slot *submitted = &slot;
+	auto submit = [submitted](uint64_t _value)
+	{
+		submitted->submitValue = _value;
+		submitted->state = SLOT_SUBMITTED;
+	};
+	if (!m_target.addFrameHook(record, submit))
+	{
+		m_dropped++;
+		return false;
+	}
+
+	if (!m_captured)
+		m_start = std::chrono::steady_clock::now();
+	slot.state = SLOT_RECORDED;
+	slot.frame = m_captured++;
+	slot.callback = _callback;
+	m_next = (m_next + 1) % m_slots.size();
+	return true;
+}
+
+std::future<WyvReadbackImage> WyvReadback::capture()
+{
+	//std::function needs a copyable callable, so the promise is shared
+	auto promise = std::make_shared<std::promise<WyvReadbackImage>>();
+	std::future<WyvReadbackImage> future = promise->get_future();
+	bool captured = capture([promise](const WyvReadbackView &_view)
+	{
+		WyvReadbackImage image;
+		image.pixels.assign(_view.pixels, _view.pixels + (size_t)_view.width * _view.height * _view.bytesPerPixel);
+		image.width = _view.width;
+		image.height = _view.height;
+		image.bytesPerPixel = _view.bytesPerPixel;
+		image.format = _view.format;
+		image.frame = _view.frame;
+		promise->set_value(std::move(image));
+	});
+	return captured ? std::move(future) : std::future<WyvReadbackImage>();
+}
+
+void WyvReadback::deliver(Slot &_slot)
+{
+	Wyvern::GetMemory().invalidate(_slot.memory);
+
+	VkExtent2D extent = m_target.getExtent();
+	WyvReadbackView view;
+	view.pixels = _slot.memory->mapped;
+	view.width = extent.width;
+	view.height = extent.height;
+	view.bytesPerPixel = m_bytesPerPixel;
+	view.format = m_target.getFormat();
+	view.frame = _slot.frame;
+	if (m_swizzle)
+	{
+		const uint8_t *source = _slot.memory->mapped;
+		uint8_t *destination = m_scratch.data();
+		for (size_t i = 0; i < m_scratch.size(); i += 4)
+		{
+			destination[i] = source[i + 2];
+			destination[i + 1] = source[i + 1];
+			destination[i + 2] = source[i];
+			destination[i + 3] = source[i + 3];
+		}
+		view.pixels = destination;
+		view.format = SwizzledFormat(view.format);
+	}
+
+	if (_slot.callback)
+		_slot.callback(view);
+	_slot.callback = nullptr;
+	_slot.state = SLOT_FREE;
+	m_delivered++;
+	m_last = std::chrono::steady_clock::now();
+}
+
+double WyvReadback::getFramesPerSecond() const
+{
+	double seconds = std::chrono::duration<double>(m_last - m_start).count();
+	return seconds > 0.0 ? m_delivered / seconds : 0.0;
+}
+
+size_t WyvReadback::poll()
+{
+	WyvQueue &queue = Wyvern::GetQueue(WYV_QUEUE_GRAPHICS);
+	size_t delivered = 0;
+	while (m_slots[m_oldest].state == SLOT_SUBMITTED && queue.isComplete(m_slots[m_oldest].submitValue))
+	{
+		deliver(m_slots[m_oldest]);
+		m_oldest = (m_oldest + 1) % m_slots.size();
+		delivered++;
+	}
+	return delivered;
+}
+
+void WyvReadback::finish()
+{
+	WyvQueue &queue = Wyvern::GetQueue(WYV_QUEUE_GRAPHICS);
+	while (m_slots[m_oldest].state == SLOT_SUBMITTED)
+	{
+		queue.wait(m_slots[m_oldest].submitValue);
+		poll();
+	}
+	if (m_slots[m_oldest].state == SLOT_RECORDED)
+		WYV_LOG_WARN("Readback of '{}' finished with a capture whose frame was never ended", m_target.getName());
+}
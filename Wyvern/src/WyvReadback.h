@@ -0,0 +1,95 @@
+#ifndef _H_WYVREADBACK_
+#define _H_WYVREADBACK_
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <vector>
+
+#include "WyvOffscreenTarget.h"
+
+namespace wyv
+{
+	//NATIVE hands out the target's own byte order, the others swizzle 8 bit four channel formats on delivery and keep their numeric format
+	enum WyvReadbackLayout { WYV_READBACK_NATIVE, WYV_READBACK_RGBA8, WYV_READBACK_BGRA8 };
+
+	//A delivered frame. Rows are tightly packed, pixels point into mapped memory that is only valid during the callback.
+	struct WyvReadbackView
+	{
+		const uint8_t *pixels;
+		uint32_t width, height, bytesPerPixel;
+		VkFormat format;
+		uint64_t frame;
+	};
+
+	//Owning copy of a frame, what the futures resolve to
+	struct WyvReadbackImage
+	{
+		std::vector<uint8_t> pixels;
+		uint32_t width = 0, height = 0, bytesPerPixel = 0;
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		uint64_t frame = 0;
+	};
+
+	//Copies frames of an offscreen target into a ring of persistently mapped host buffers. A capture is recorded into
+	//the frame's own command buffer and delivered from poll once the graphics timeline reaches that frame, so the
+	//render loop never waits on the copy. A full ring drops the capture rather than stall.
+	class WyvReadback
+	{
+		typedef std::function<void(const WyvReadbackView&)> Callback;
+
+		enum SlotState { SLOT_FREE, SLOT_RECORDED, SLOT_SUBMITTED };
+		struct Slot
+		{
+			VkBuffer buffer = VK_NULL_HANDLE;
+			WyvAllocation *memory = nullptr;
+			SlotState state = SLOT_FREE;
+			uint64_t submitValue = 0, frame = 0;
+			Callback callback;
+		};
+
+		WyvOffscreenTarget &m_target;
+		WyvReadbackLayout m_layout;
+		uint32_t m_bytesPerPixel = 0;
+		bool m_swizzle = false;
+		VkDeviceSize m_size = 0;
+		std::vector<Slot> m_slots;
+		size_t m_next = 0, m_oldest = 0;
+		std::vector<uint8_t> m_scratch;
+
+		uint64_t m_captured = 0, m_delivered = 0, m_dropped = 0;
+		std::chrono::steady_clock::time_point m_start, m_last;
+
+		void deliver(Slot &_slot);
+
+	public:
+		static const uint32_t DEFAULT_DEPTH = 4;
+
+		//_depth slots give each capture that many frames to complete before the ring is full
+		WyvReadback(WyvOffscreenTarget &_target, WyvReadbackLayout _layout = WYV_READBACK_NATIVE, uint32_t _depth = DEFAULT_DEPTH);
+		~WyvReadback();
+
+		WyvReadback(const WyvReadback&) = delete;
+		WyvReadback &operator=(const WyvReadback&) = delete;
+
+		//Call between the target's beginFrame and endFrame. Returns false if the ring is full or no frame is being recorded, the frame counts as dropped either way.
+		bool capture(Callback _callback);
+		//Same as capture, but the frame is copied out of mapped memory into the future. An invalid future means it was dropped.
+		std::future<WyvReadbackImage> capture();
+
+		//Delivers every finished capture in order, returns how many were delivered
+		size_t poll();
+		//Blocks until every capture in flight is delivered
+		void finish();
+
+		uint64_t getCapturedCount() const { return m_captured; }
+		uint64_t getDeliveredCount() const { return m_delivered; }
+		uint64_t getDroppedCount() const { return m_dropped; }
+		VkDeviceSize getFrameSize() const { return m_size; }
+		//Delivery rate from the first capture to the latest delivery
+		double getFramesPerSecond() const;
+		double getBytesPerSecond() const { return getFramesPerSecond() * m_size; }
+	};
+}
+
+#endif //_H_WYVREADBACK_
@@ -0,0 +1,1104 @@
+#include "WyvRenderGraph.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#include "WyvRenderTarget.h"
+
+using namespace wyv;
+
+namespace
+{
+	struct UsageInfo
+	{
+		VkPipelineStageFlags stages;
+		VkAccessFlags access;
+		VkImageLayout layout; //Undefined for usages only buffers have
+		bool write;
+		VkImageUsageFlags imageUsage;
+	};
+
+	const char *g_usageNames[WYV_GRAPH_USAGE_COUNT] = { "color attachment", "depth attachment", "depth read", "sampled", "storage read",
+		"storage write", "uniform", "vertex", "indirect", "transfer src", "transfer dst", "present" };
+
+	const VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+		| VK_ACCESS_TRANSFER_WRITE_BIT;
+}
+
+//Returns false if a pass of _kind can't use a resource that way
+static bool DescribeUsage(WyvGraphUsage _usage, WyvGraphPassKind _kind, UsageInfo &_info)
+{
+	const VkPipelineStageFlags shaderStages = _kind == WYV_PASS_COMPUTE ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+		: VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	const VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	bool graphics = _kind == WYV_PASS_GRAPHICS, shaders = _kind != WYV_PASS_TRANSFER;
+	switch (_usage)
+	{
+	case WYV_GRAPH_COLOR_ATTACHMENT:
+		_info = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT };
+		return graphics;
+	case WYV_GRAPH_DEPTH_ATTACHMENT:
+		_info = { depthStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+		return graphics;
+	case WYV_GRAPH_DEPTH_READ:
+		if (graphics)
+			_info = { depthStages | shaderStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT };
+		else
+			_info = { shaderStages, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false, VK_IMAGE_USAGE_SAMPLED_BIT };
+		return shaders;
+	case WYV_GRAPH_SAMPLED:
+		_info = { shaderStages, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false, VK_IMAGE_USAGE_SAMPLED_BIT };
+		return shaders;
+	case WYV_GRAPH_STORAGE_READ:
+		_info = { shaderStages, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false, VK_IMAGE_USAGE_STORAGE_BIT };
+		return shaders;
+	case WYV_GRAPH_STORAGE_WRITE:
+		_info = { shaderStages, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true, VK_IMAGE_USAGE_STORAGE_BIT };
+		return shaders;
+	case WYV_GRAPH_UNIFORM:
+		_info = { shaderStages, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false, 0 };
+		return shaders;
+	case WYV_GRAPH_VERTEX:
+		_info = { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false, 0 };
+		return graphics;
+	case WYV_GRAPH_INDIRECT:
+		_info = { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false, 0 };
+		return shaders;
+	case WYV_GRAPH_TRANSFER_SRC:
+		_info = { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false, VK_IMAGE_USAGE_TRANSFER_SRC_BIT };
+		return true;
+	case WYV_GRAPH_TRANSFER_DST:
+		_info = { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true, VK_IMAGE_USAGE_TRANSFER_DST_BIT };
+		return true;
+	case WYV_GRAPH_PRESENT:
+		_info = { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false, 0 };
+		return false;
+	default:
+		_info = {};
+		return false;
+	}
+}
+
+static bool IsImageOnly(WyvGraphUsage _usage)
+{
+	return _usage == WYV_GRAPH_COLOR_ATTACHMENT || _usage == WYV_GRAPH_DEPTH_ATTACHMENT || _usage == WYV_GRAPH_DEPTH_READ || _usage == WYV_GRAPH_SAMPLED
+		|| _usage == WYV_GRAPH_PRESENT;
+}
+
+static const char *LayoutName(VkImageLayout _layout)
+{
+	switch (_layout)
+	{
+	case VK_IMAGE_LAYOUT_UNDEFINED: return "UNDEFINED";
+	case VK_IMAGE_LAYOUT_GENERAL: return "GENERAL";
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL: return "COLOR_ATTACHMENT";
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return "DEPTH_STENCIL_ATTACHMENT";
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL: return "DEPTH_STENCIL_READ_ONLY";
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL: return "SHADER_READ_ONLY";
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL: return "TRANSFER_SRC";
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL: return "TRANSFER_DST";
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR: return "PRESENT_SRC";
+	default: return "OTHER";
+	}
+}
+
+static uint32_t FamilyOf(WyvQueueRole _role)
+{
+	return Wyvern::GetQueue(_role).getFamily();
+}
+
+static std::string Escape(const std::string &_text)
+{
+	std::string result;
+	for (char c : _text)
+	{
+		if (c == '"' || c == '\\')
+			result += '\\';
+		result += c;
+	}
+	return result;
+}
+
+WyvRenderGraph::WyvRenderGraph(std::string _name) : m_name(_name), m_transients(_name + " transients")
+{
+}
+
+uint32_t WyvRenderGraph::createImage(const WyvTransientDesc &_desc)
+{
+	if (m_compiled)
+		Wyvern::Fail("Render graph '" + m_name + "' got a declaration after it was compiled");
+	Resource resource;
+	resource.name = _desc.name;
+	resource.transient = true;
+	resource.aspect = Wyvern::AspectOf(_desc.format);
+	resource.desc = _desc;
+	m_resources.push_back(resource);
+	return (uint32_t)m_resources.size() - 1;
+}
+
+uint32_t WyvRenderGraph::importImage(const std::string &_name, VkImage _image, VkImageView _view, VkFormat _format, VkImageLayout _initialLayout)
+{
+	if (m_compiled)
+		Wyvern::Fail("Render graph '" + m_name + "' got a declaration after it was compiled");
+	Resource resource;
+	resource.name = _name;
+	resource.image = _image;
+	resource.view = _view;
+	resource.aspect = Wyvern::AspectOf(_format);
+	resource.initialLayout = _initialLayout;
+	m_resources.push_back(resource);
+	return (uint32_t)m_resources.size() - 1;
+}
+
+uint32_t WyvRenderGraph::importBuffer(const std::string &_name, VkBuffer _buffer)
+{
+	if (m_compiled)
+		Wyvern::Fail("Render graph '" + m_name + "' got a declaration after it was compiled");
+	Resource resource;
+	resource.name = _name;
+	resource.isImage = false;
+	resource.buffer = _buffer;
+	m_resources.push_back(resource);
+	return (uint32_t)m_resources.size() - 1;
+}
+
+void WyvRenderGraph::setImage(uint32_t _resource, VkImage _image, VkImageView _view)
+{
+	m_resources[_resource].image = _image;
+	m_resources[_resource].view = _view;
+}
+
+void WyvRenderGraph::markOutput(uint32_t _resource, WyvGraphUsage _finalUsage)
+{
+	if (m_compiled)
+		Wyvern::Fail("Render graph '" + m_name + "' got a declaration after it was compiled");
+	m_resources[_resource].output = true;
+	m_resources[_resource].finalUsage = m_resources[_resource].isImage ? _finalUsage : WYV_GRAPH_USAGE_COUNT;
+}
+
+uint32_t WyvRenderGraph::addPass(const std::string &_name, WyvGraphPassKind _kind, RecordFunction _record)
+{
+	if (m_compiled)
+		Wyvern::Fail("Render graph '" + m_name + "' got a declaration after it was compiled");
+	Pass pass;
+	pass.name = _name;
+	pass.kind = _kind;
+	pass.record = _record;
+	m_passes.push_back(pass);
+	return (uint32_t)m_passes.size() - 1;
+}
+
+void WyvRenderGraph::setAsyncCompute(uint32_t _pass)
+{
+	if (m_compiled)
+		Wyvern::Fail("Render graph '" + m_name + "' got a declaration after it was compiled");
+	if (m_passes[_pass].kind != WYV_PASS_COMPUTE)
+	{
+		Wyvern::Error("Render graph '" + m_name + "': only compute passes can run async, '" + m_passes[_pass].name + "' isn't one");
+		return;
+	}
+	m_passes[_pass].async = true;
+}
+
+void WyvRenderGraph::setTimestamps(bool _enable)
+{
+	if (m_compiled)
+		Wyvern::Fail("Render graph '" + m_name + "' got a declaration after it was compiled");
+	m_timestamps = _enable;
+}
+
+void WyvRenderGraph::use(uint32_t _pass, uint32_t _resource, WyvGraphUsage _usage)
+{
+	if (m_compiled)
+		Wyvern::Fail("Render graph '" + m_name + "' got a declaration after it was compiled");
+	Pass &pass = m_passes[_pass];
+	Resource &resource = m_resources[_resource];
+	UsageInfo info;
+	bool valid = DescribeUsage(_usage, pass.kind, info);
+	valid = valid && (resource.isImage ? info.layout != VK_IMAGE_LAYOUT_UNDEFINED : !IsImageOnly(_usage));
+	if (!valid)
+	{
+		Wyvern::Error("Render graph '" + m_name + "': pass '" + pass.name + "' can't use '" + resource.name + "' as " + g_usageNames[_usage]);
+		return;
+	}
+	if (resource.transient)
+		resource.desc.usage |= info.imageUsage;
+
+	for (Use &use : pass.uses)
+	{
+		if (use.resource != _resource)
+			continue;
+		if (resource.isImage && use.layout != info.layout)
+		{
+			Wyvern::Error("Render graph '" + m_name + "': pass '" + pass.name + "' uses '" + resource.name + "' in two layouts");
+			return;
+		}
+		use.usages |= 1u << _usage;
+		use.stages |= info.stages;
+		use.access |= info.access;
+		use.write = use.write || info.write;
+		return;
+	}
+	pass.uses.push_back({ _resource, 1u << _usage, info.stages, info.access, resource.isImage ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED, info.write });
+}
+
+const WyvRenderGraph::Use *WyvRenderGraph::findUse(const Pass &_pass, uint32_t _resource) const
+{
+	for (const Use &use : _pass.uses)
+		if (use.resource == _resource)
+			return &use;
+	return nullptr;
+}
+
+//Links every pass to the earlier ones it conflicts with, then keeps the passes with side effects or writing outputs
+//and, walking back, every pass whose writes a kept pass uses. Readers a kept pass only has to wait for aren't kept.
+void WyvRenderGraph::cull()
+{
+	for (Pass &pass : m_passes)
+	{
+		pass.culled = !pass.sideEffects;
+		pass.order = pass.batch = UINT32_MAX;
+		pass.producers.clear();
+		pass.barriers.clear();
+		pass.releases.clear();
+		pass.acquires.clear();
+		pass.waits.clear();
+		for (const Use &use : pass.uses)
+			if (use.write && m_resources[use.resource].output)
+				pass.culled = false;
+	}
+
+	for (uint32_t p = (uint32_t)m_passes.size(); p-- > 0; )
+	{
+		Pass &pass = m_passes[p];
+		for (const Use &use : pass.uses)
+		{
+			//The latest earlier writer orders everything before it, so the walk stops there
+			for (uint32_t q = p; q-- > 0; )
+			{
+				const Use *other = findUse(m_passes[q], use.resource);
+				if (!other)
+					continue;
+				if (use.write || other->write || use.layout != other->layout)
+					pass.producers.push_back(q);
+				if (other->write)
+				{
+					if (!pass.culled)
+						m_passes[q].culled = false;
+					break;
+				}
+			}
+		}
+		std::sort(pass.producers.begin(), pass.producers.end());
+		pass.producers.erase(std::unique(pass.producers.begin(), pass.producers.end()), pass.producers.end());
+	}
+
+	//Async passes only leave the graphics queue for a compute queue of its own
+	bool dedicated = Wyvern::HasDedicatedQueue(WYV_QUEUE_COMPUTE);
+	m_async = false;
+	for (Pass &pass : m_passes)
+	{
+		pass.role = pass.async && dedicated ? WYV_QUEUE_COMPUTE : WYV_QUEUE_GRAPHICS;
+		m_async = m_async || (!pass.culled && pass.role == WYV_QUEUE_COMPUTE);
+	}
+}
+
+//Greedy topological order: of the passes whose producers are all scheduled, the one furthest from its latest
+//producer goes next, so barriers mostly wait on work that finished a while ago. Declaration order breaks ties.
+//Async passes go as soon as they are ready, the compute queue has nothing else to do.
+void WyvRenderGraph::schedule()
+{
+	m_schedule.clear();
+	size_t live = std::count_if(m_passes.begin(), m_passes.end(), [](const Pass &_pass) { return !_pass.culled; });
+	while (m_schedule.size() < live)
+	{
+		uint32_t best = UINT32_MAX;
+		int64_t bestDistance = -1;
+		for (uint32_t p = 0; p < m_passes.size(); p++)
+		{
+			const Pass &pass = m_passes[p];
+			if (pass.culled || pass.order != UINT32_MAX)
+				continue;
+			int64_t latest = -1;
+			bool ready = true;
+			for (uint32_t producer : pass.producers)
+			{
+				if (m_passes[producer].culled)
+					continue;
+				if (m_passes[producer].order == UINT32_MAX)
+				{
+					ready = false;
+					break;
+				}
+				latest = std::max(latest, (int64_t)m_passes[producer].order);
+			}
+			if (!ready)
+				continue;
+			if (pass.role == WYV_QUEUE_COMPUTE)
+			{
+				best = p;
+				break;
+			}
+			int64_t distance = latest < 0 ? INT64_MAX : (int64_t)m_schedule.size() - latest;
+			if (distance > bestDistance)
+			{
+				best = p;
+				bestDistance = distance;
+			}
+		}
+		m_passes[best].order = (uint32_t)m_schedule.size();
+		m_schedule.push_back(best);
+	}
+}
+
+//Transient images live from the first to the last scheduled pass using them, images no kept pass uses aren't created.
+//The compute queue runs beside passes scheduled before and after its own, so its images live for the whole frame.
+bool WyvRenderGraph::createTransients()
+{
+	m_transients.reset();
+	std::vector<uint32_t> first(m_resources.size(), UINT32_MAX), last(m_resources.size(), 0);
+	for (uint32_t p : m_schedule)
+		for (const Use &use : m_passes[p].uses)
+		{
+			bool whole = m_passes[p].role == WYV_QUEUE_COMPUTE;
+			first[use.resource] = std::min(first[use.resource], whole ? 0 : m_passes[p].order);
+			last[use.resource] = std::max(last[use.resource], whole ? (uint32_t)m_schedule.size() - 1 : m_passes[p].order);
+		}
+
+	bool any = false;
+	for (uint32_t r = 0; r < m_resources.size(); r++)
+	{
+		Resource &resource = m_resources[r];
+		resource.transientIndex = UINT32_MAX;
+		if (!resource.transient || first[r] == UINT32_MAX)
+			continue;
+		resource.desc.firstPass = first[r];
+		resource.desc.lastPass = last[r];
+		resource.transientIndex = m_transients.declare(resource.desc);
+		any = true;
+	}
+	return !any || m_transients.build();
+}
+
+//Waits on the readers since the last write if there were any, they already waited on the write; otherwise on the write itself
+void WyvRenderGraph::AddSource(WyvGraphBarrier &_barrier, const State &_state)
+{
+	if (_state.readStages)
+		_barrier.srcStages |= _state.readStages;
+	else
+	{
+		_barrier.srcStages |= _state.writeStages | _state.transitionStages;
+		_barrier.srcAccess |= _state.writeAccess;
+	}
+}
+
+void WyvRenderGraph::AddWait(std::vector<Wait> &_waits, uint32_t _target, VkPipelineStageFlags _stages)
+{
+	for (Wait &wait : _waits)
+		if (wait.first == _target)
+		{
+			wait.second |= _stages;
+			return;
+		}
+	_waits.push_back(std::make_pair(_target, _stages));
+}
+
+//What _use in _pass on _role's queue needs given what the resource went through so far. _final uses are the
+//transitions to the outputs' final usages, which only happen when the layout or the queue changes.
+void WyvRenderGraph::placeUse(uint32_t _pass, WyvQueueRole _role, const Use &_use, State &_state, std::vector<WyvGraphBarrier> &_barriers, std::vector<Wait> &_waits, bool _final)
+{
+	const Resource &resource = m_resources[_use.resource];
+	bool transition = resource.isImage && _use.layout != _state.layout;
+	bool moved = _state.touched && _state.role != _role;
+	//Transient images nothing used don't exist
+	if (_final && ((!moved && !transition) || (resource.transient && !_state.touched)))
+		return;
+
+	WyvGraphBarrier barrier;
+	barrier.resource = _use.resource;
+	barrier.dstStages = _use.stages;
+	barrier.dstAccess = _use.access;
+	barrier.oldLayout = _state.layout;
+	barrier.newLayout = _use.layout;
+	bool needed = false;
+	if (!_state.touched)
+	{
+		if (!_final && !_use.write && resource.isImage && (resource.transient || _state.layout == VK_IMAGE_LAYOUT_UNDEFINED))
+			WYV_LOG_WARN("Render graph '{}': pass '{}' reads '{}' before anything wrote it", m_name, m_passes[_pass].name, resource.name);
+		//Chains with whatever the caller synchronized an imported resource with at these stages. Transients get
+		//their sources once the last use of every image sharing their memory is known.
+		if (!resource.transient)
+			barrier.srcStages = _use.stages;
+		needed = transition;
+	}
+	else if (moved)
+	{
+		//The semaphore wait orders the queues, the barrier chains with it at the same stages
+		AddWait(_waits, _state.lastPass, _use.stages);
+		barrier.srcStages = _use.stages;
+		uint32_t from = FamilyOf(_state.role), to = FamilyOf(_role);
+		if (from != to)
+		{
+			barrier.srcFamily = from;
+			barrier.dstFamily = to;
+			WyvGraphBarrier release = barrier;
+			release.srcStages = release.dstStages = 0;
+			release.srcAccess = release.dstAccess = 0;
+			AddSource(release, _state);
+			m_passes[_state.lastPass].releases.push_back(release);
+			m_transferCount++;
+		}
+		needed = transition || from != to;
+	}
+	else if (_use.write || transition)
+	{
+		AddSource(barrier, _state);
+		needed = true;
+	}
+	else if ((_state.writeStages | _state.transitionStages) && ((_use.stages & ~_state.visibleStages) || (_use.access & ~_state.visibleAccess)))
+	{
+		barrier.srcStages = _state.writeStages | _state.transitionStages;
+		barrier.srcAccess = _state.writeAccess;
+		needed = true;
+	}
+	if (needed)
+	{
+		_barriers.push_back(barrier);
+		m_transitionCount += transition ? 1 : 0;
+	}
+
+	_state.touched = true;
+	_state.layout = _use.layout;
+	_state.role = _role;
+	_state.lastPass = _pass;
+	if (_use.write)
+	{
+		_state.writeStages = _use.stages;
+		_state.writeAccess = _use.access & WRITE_ACCESS;
+		_state.transitionStages = _state.readStages = _state.visibleStages = 0;
+		_state.visibleAccess = 0;
+	}
+	else if (transition || moved)
+	{
+		//Writes from the other queue are only this queue's business through the barrier above
+		if (moved)
+		{
+			_state.writeStages = 0;
+			_state.writeAccess = 0;
+		}
+		_state.transitionStages = _state.readStages = _state.visibleStages = _use.stages;
+		_state.visibleAccess = _use.access;
+	}
+	else
+	{
+		_state.readStages |= _use.stages;
+		if (needed)
+		{
+			_state.visibleStages |= _use.stages;
+			_state.visibleAccess |= _use.access;
+		}
+	}
+}
+
+void WyvRenderGraph::placeBarriers()
+{
+	std::vector<State> states(m_resources.size());
+	for (uint32_t r = 0; r < m_resources.size(); r++)
+		states[r].layout = m_resources[r].transient ? VK_IMAGE_LAYOUT_UNDEFINED : m_resources[r].initialLayout;
+	//Barriers of the first use of each transient image, completed once every image's last use is known
+	std::vector<std::pair<uint32_t, size_t>> firstUses;
+	std::vector<uint32_t> firstPasses(m_resources.size(), UINT32_MAX);
+
+	for (uint32_t p : m_schedule)
+	{
+		Pass &pass = m_passes[p];
+		for (const Use &use : pass.uses)
+		{
+			if (!states[use.resource].touched)
+			{
+				firstPasses[use.resource] = p;
+				if (m_resources[use.resource].transient)
+					firstUses.push_back(std::make_pair(p, pass.barriers.size()));
+			}
+			placeUse(p, pass.role, use, states[use.resource], pass.barriers, pass.waits, false);
+		}
+	}
+
+	//A transient image's memory was last used by the image itself in the previous frame, or by an image aliasing it,
+	//which ended earlier in this frame or is later in the frame before. Only images of the same queue alias, and work
+	//of the previous frame on the other queue is covered by submit(), which starts each queue's frame after the
+	//other queue's last submission.
+	std::vector<uint32_t> byTransient(m_transients.getResourceCount());
+	for (uint32_t r = 0; r < m_resources.size(); r++)
+		if (m_resources[r].transientIndex != UINT32_MAX)
+			byTransient[m_resources[r].transientIndex] = r;
+	std::vector<std::vector<uint32_t>> sharing(byTransient.size());
+	for (uint32_t t = 0; t < byTransient.size(); t++)
+	{
+		sharing[t].push_back(t);
+		for (uint32_t alias : m_transients.getAliases(t))
+		{
+			sharing[t].push_back(alias);
+			sharing[alias].push_back(t);
+		}
+	}
+	for (const auto &first : firstUses)
+	{
+		Pass &pass = m_passes[first.first];
+		WyvGraphBarrier &barrier = pass.barriers[first.second];
+		for (uint32_t t : sharing[m_resources[barrier.resource].transientIndex])
+		{
+			const State &state = states[byTransient[t]];
+			if (state.role != pass.role)
+				continue;
+			barrier.srcStages |= state.writeStages | state.transitionStages | state.readStages;
+			barrier.srcAccess |= state.writeAccess;
+		}
+	}
+
+	m_finalBarriers.clear();
+	m_finalWaits.clear();
+	for (uint32_t r = 0; r < m_resources.size(); r++)
+	{
+		const Resource &resource = m_resources[r];
+		if (resource.finalUsage == WYV_GRAPH_USAGE_COUNT)
+			continue;
+		UsageInfo info;
+		DescribeUsage(resource.finalUsage, WYV_PASS_GRAPHICS, info);
+		Use use = { r, 1u << resource.finalUsage, info.stages, info.access, info.layout, false };
+		placeUse(UINT32_MAX, WYV_QUEUE_GRAPHICS, use, states[r], m_finalBarriers, m_finalWaits, true);
+	}
+
+	//Imported resources whose contents matter go back to the family of their first use for the next frame, which
+	//acquires them before its first use. Layouts stay as they are, the first use's own barrier transitions them.
+	for (uint32_t r = 0; r < m_resources.size(); r++)
+	{
+		const Resource &resource = m_resources[r];
+		const State &state = states[r];
+		if (resource.transient || !state.touched)
+			continue;
+		if (resource.isImage && resource.initialLayout != VK_IMAGE_LAYOUT_UNDEFINED && state.layout != resource.initialLayout)
+			WYV_LOG_WARN("Render graph '{}' leaves '{}' in {} but expects it in {} at the start", m_name, resource.name, LayoutName(state.layout), LayoutName(resource.initialLayout));
+		Pass &first = m_passes[firstPasses[r]];
+		uint32_t from = FamilyOf(state.role), to = FamilyOf(first.role);
+		if (from == to || (resource.isImage && resource.initialLayout == VK_IMAGE_LAYOUT_UNDEFINED))
+			continue;
+
+		const Use *use = findUse(first, r);
+		WyvGraphBarrier acquire;
+		acquire.resource = r;
+		acquire.srcStages = acquire.dstStages = use->stages;
+		acquire.dstAccess = use->access;
+		acquire.oldLayout = acquire.newLayout = state.layout;
+		acquire.srcFamily = from;
+		acquire.dstFamily = to;
+		first.acquires.push_back(acquire);
+
+		WyvGraphBarrier release = acquire;
+		release.srcStages = release.dstStages = 0;
+		release.dstAccess = 0;
+		AddSource(release, state);
+		if (state.lastPass != UINT32_MAX)
+			m_passes[state.lastPass].releases.push_back(release);
+		else
+			m_finalBarriers.push_back(release);
+		m_transferCount++;
+	}
+
+	m_barrierCount = (uint32_t)m_finalBarriers.size();
+	m_batchCount = m_finalBarriers.empty() ? 0 : 1;
+	for (uint32_t p : m_schedule)
+	{
+		const Pass &pass = m_passes[p];
+		m_barrierCount += (uint32_t)(pass.acquires.size() + pass.barriers.size() + pass.releases.size());
+		m_batchCount += (pass.acquires.empty() ? 0 : 1) + (pass.barriers.empty() ? 0 : 1) + (pass.releases.empty() ? 0 : 1);
+	}
+}
+
+//Splits the schedule into submissions. A pass joins the open submission of its queue unless it waits on a submission
+//of the other queue that one doesn't, and a submission waited on is closed so the wait covers no more than needed.
+void WyvRenderGraph::buildBatches()
+{
+	m_batches.clear();
+	int open[2] = { -1, -1 };
+	for (uint32_t p : m_schedule)
+	{
+		Pass &pass = m_passes[p];
+		int queue = pass.role == WYV_QUEUE_COMPUTE ? 1 : 0;
+		std::vector<Wait> waits;
+		for (const Wait &wait : pass.waits)
+			AddWait(waits, m_passes[wait.first].batch, wait.second);
+
+		bool fits = open[queue] >= 0;
+		for (size_t w = 0; fits && w < waits.size(); w++)
+		{
+			const std::vector<Wait> &existing = m_batches[open[queue]].waits;
+			uint32_t target = waits[w].first;
+			fits = std::any_of(existing.begin(), existing.end(), [target](const Wait &_other) { return _other.first == target; });
+		}
+		if (!fits)
+		{
+			Batch batch;
+			batch.role = pass.role;
+			open[queue] = (int)m_batches.size();
+			m_batches.push_back(batch);
+		}
+		Batch &batch = m_batches[open[queue]];
+		for (const Wait &wait : waits)
+		{
+			AddWait(batch.waits, wait.first, wait.second);
+			if (open[1 - queue] == (int)wait.first)
+				open[1 - queue] = -1;
+		}
+		batch.passes.push_back(p);
+		pass.batch = (uint32_t)open[queue];
+	}
+
+	if (m_finalBarriers.empty())
+		return;
+	std::vector<Wait> waits;
+	for (const Wait &wait : m_finalWaits)
+		AddWait(waits, m_passes[wait.first].batch, wait.second);
+	if (open[0] < 0 || !waits.empty())
+	{
+		Batch batch;
+		batch.role = WYV_QUEUE_GRAPHICS;
+		batch.waits = waits;
+		open[0] = (int)m_batches.size();
+		m_batches.push_back(batch);
+	}
+	m_batches[open[0]].final = true;
+}
+
+bool WyvRenderGraph::createSubmitObjects()
+{
+	uint32_t frames = WyvRenderTarget::MAX_FRAMES_IN_FLIGHT + 1;
+	for (int queue = 0; queue < 2; queue++)
+	{
+		if (m_poolsCreated[queue] || (queue == 1 && !m_async))
+			continue;
+		m_commandPools[queue].create(m_name, queue ? WYV_QUEUE_COMPUTE : WYV_QUEUE_GRAPHICS, frames);
+		m_poolsCreated[queue] = true;
+	}
+	if (!m_timestamps || m_passes.empty() || !m_queryPools.empty())
+		return true;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(Wyvern::GetPhysicalDevice(), &properties);
+	m_timestampPeriod = properties.limits.timestampPeriod;
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(Wyvern::GetPhysicalDevice(), &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(Wyvern::GetPhysicalDevice(), &familyCount, families.data());
+	m_timestampRoles[0] = families[FamilyOf(WYV_QUEUE_GRAPHICS)].timestampValidBits > 0;
+	m_timestampRoles[1] = families[FamilyOf(WYV_QUEUE_COMPUTE)].timestampValidBits > 0;
+	if (!m_timestampRoles[0] && !m_timestampRoles[1])
+	{
+		WYV_LOG_WARN("Render graph '{}': the device's queues don't support timestamps", m_name);
+		m_timestamps = false;
+		return true;
+	}
+
+	VkQueryPoolCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	createInfo.queryCount = (uint32_t)m_passes.size() * 2;
+	m_queryPools.assign(frames, VK_NULL_HANDLE);
+	m_queriesWritten.assign(frames, false);
+	for (VkQueryPool &pool : m_queryPools)
+		if (vkCreateQueryPool(Wyvern::GetDevice(), &createInfo, Wyvern::GetAllocator(), &pool) != VK_SUCCESS)
+		{
+			Wyvern::Error("Render graph '" + m_name + "' couldn't create its timestamp query pools");
+			destroySubmitObjects();
+			return false;
+		}
+	return true;
+}
+
+//Waits for the graph's submissions on both queues, the query pools and transients may still be in use by them
+void WyvRenderGraph::destroySubmitObjects()
+{
+	for (int queue = 0; queue < 2; queue++)
+		if (m_lastValues[queue])
+			Wyvern::GetQueue(queue ? WYV_QUEUE_COMPUTE : WYV_QUEUE_GRAPHICS).wait(m_lastValues[queue]);
+	for (VkQueryPool pool : m_queryPools)
+		if (pool)
+			vkDestroyQueryPool(Wyvern::GetDevice(), pool, Wyvern::GetAllocator());
+	m_queryPools.clear();
+	m_queriesWritten.clear();
+	m_timings.clear();
+	m_overlap = 0.0;
+}
+
+bool WyvRenderGraph::compile()
+{
+	if (m_compiled)
+		return true;
+	m_barrierCount = m_batchCount = m_transitionCount = m_transferCount = 0;
+	cull();
+	schedule();
+	if (!createTransients())
+	{
+		Wyvern::Error("Render graph '" + m_name + "' couldn't create its transient images");
+		return false;
+	}
+	placeBarriers();
+	buildBatches();
+	m_compiled = true;
+	logReport();
+	return true;
+}
+
+void WyvRenderGraph::recordBarriers(VkCommandBuffer _commandBuffer, const std::vector<WyvGraphBarrier> &_barriers)
+{
+	if (_barriers.empty())
+		return;
+	VkPipelineStageFlags srcStages = 0, dstStages = 0;
+	VkMemoryBarrier memoryBarrier = {};
+	memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	m_imageBarriers.clear();
+	m_bufferBarriers.clear();
+	for (const WyvGraphBarrier &barrier : _barriers)
+	{
+		srcStages |= barrier.srcStages;
+		dstStages |= barrier.dstStages;
+		const Resource &resource = m_resources[barrier.resource];
+		if (!resource.isImage && barrier.srcFamily == barrier.dstFamily)
+		{
+			//Nothing finer than a global memory barrier is needed, which drivers handle better than many buffer barriers
+			if (barrier.srcAccess)
+			{
+				memoryBarrier.srcAccessMask |= barrier.srcAccess;
+				memoryBarrier.dstAccessMask |= barrier.dstAccess;
+			}
+			continue;
+		}
+		if (!resource.isImage)
+		{
+			VkBufferMemoryBarrier bufferBarrier = {};
+			bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			bufferBarrier.srcAccessMask = barrier.srcAccess;
+			bufferBarrier.dstAccessMask = barrier.dstAccess;
+			bufferBarrier.srcQueueFamilyIndex = barrier.srcFamily;
+			bufferBarrier.dstQueueFamilyIndex = barrier.dstFamily;
+			bufferBarrier.buffer = resource.buffer;
+			bufferBarrier.size = VK_WHOLE_SIZE;
+			m_bufferBarriers.push_back(bufferBarrier);
+			continue;
+		}
+		VkImageMemoryBarrier imageBarrier = {};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.srcAccessMask = barrier.srcAccess;
+		imageBarrier.dstAccessMask = barrier.dstAccess;
+		imageBarrier.oldLayout = barrier.oldLayout;
+		imageBarrier.newLayout = barrier.newLayout;
+		imageBarrier.srcQueueFamilyIndex = barrier.srcFamily;
+		imageBarrier.dstQueueFamilyIndex = barrier.dstFamily;
+		imageBarrier.image = getImage(barrier.resource);
+		imageBarrier.subresourceRange = { resource.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+		m_imageBarriers.push_back(imageBarrier);
+	}
+	if (!srcStages)
+		srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	if (!dstStages)
+		dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	vkCmdPipelineBarrier(_commandBuffer, srcStages, dstStages, 0,
+		memoryBarrier.srcAccessMask ? 1 : 0, &memoryBarrier, (uint32_t)m_bufferBarriers.size(), m_bufferBarriers.data(), (uint32_t)m_imageBarriers.size(), m_imageBarriers.data());
+}
+
+void WyvRenderGraph::execute(VkCommandBuffer _commandBuffer)
+{
+	if (!compile())
+		return;
+	if (m_async)
+	{
+		Wyvern::Error("Render graph '" + m_name + "' has passes on the compute queue, submit it instead");
+		return;
+	}
+	for (uint32_t p : m_schedule)
+	{
+		recordBarriers(_commandBuffer, m_passes[p].barriers);
+		if (m_passes[p].record)
+			m_passes[p].record(_commandBuffer);
+	}
+	recordBarriers(_commandBuffer, m_finalBarriers);
+}
+
+uint64_t WyvRenderGraph::submit()
+{
+	if (!compile() || !createSubmitObjects())
+		return 0;
+	//The command pools waited for this slot's previous frame when the last one ended, so its queries are done too
+	uint32_t slot = (uint32_t)(m_commandPools[0].getFrame() % (WyvRenderTarget::MAX_FRAMES_IN_FLIGHT + 1));
+	VkQueryPool queries = m_queryPools.empty() ? VK_NULL_HANDLE : m_queryPools[slot];
+	if (queries)
+		collectTimings(slot);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	std::vector<uint64_t> values(m_batches.size(), 0);
+	uint64_t previous[2] = { m_lastValues[0], m_lastValues[1] };
+	bool started[2] = {};
+	for (uint32_t b = 0; b < m_batches.size(); b++)
+	{
+		const Batch &batch = m_batches[b];
+		int queue = batch.role == WYV_QUEUE_COMPUTE ? 1 : 0;
+		VkCommandBuffer commandBuffer = m_commandPools[queue].getPrimary();
+		//Earlier batches are already queued and later ones wait on values that would never be signaled
+		if (!commandBuffer)
+			Wyvern::Fail("Render graph '" + m_name + "' couldn't get a command buffer");
+		vkBeginCommandBuffer(commandBuffer, &beginInfo);
+		for (uint32_t p : batch.passes)
+		{
+			Pass &pass = m_passes[p];
+			bool timed = queries && m_timestampRoles[queue];
+			if (timed)
+			{
+				vkCmdResetQueryPool(commandBuffer, queries, p * 2, 2);
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queries, p * 2);
+			}
+			//The first frame has nothing to acquire, the resources start out owned by the family of their first use
+			if (previous[0] || previous[1])
+				recordBarriers(commandBuffer, pass.acquires);
+			recordBarriers(commandBuffer, pass.barriers);
+			if (pass.record)
+				pass.record(commandBuffer);
+			if (timed)
+				vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queries, p * 2 + 1);
+			recordBarriers(commandBuffer, pass.releases);
+		}
+		if (batch.final)
+			recordBarriers(commandBuffer, m_finalBarriers);
+		vkEndCommandBuffer(commandBuffer);
+
+		WyvSubmitInfo info(commandBuffer);
+		for (const Wait &wait : batch.waits)
+			info.wait(m_batches[wait.first].role, values[wait.first], wait.second);
+		//The previous frame's last work on the other queue may still use what this frame overwrites
+		if (!started[queue] && previous[1 - queue])
+			info.wait(queue ? WYV_QUEUE_GRAPHICS : WYV_QUEUE_COMPUTE, previous[1 - queue], VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+		started[queue] = true;
+		values[b] = Wyvern::Submit(batch.role, info);
+		m_lastValues[queue] = values[b];
+	}
+
+	if (queries)
+		m_queriesWritten[slot] = true;
+	for (int queue = 0; queue < 2; queue++)
+		if (m_poolsCreated[queue])
+			m_commandPools[queue].endFrame(m_lastValues[queue]);
+	return m_lastValues[0];
+}
+
+//Length of the time both queues were busy, from the passes' merged intervals on each
+static double OverlapOf(const std::vector<WyvGraphTiming> &_timings)
+{
+	std::vector<std::pair<double, double>> intervals[2];
+	for (const WyvGraphTiming &timing : _timings)
+		intervals[timing.role == WYV_QUEUE_COMPUTE ? 1 : 0].push_back(std::make_pair(timing.begin, timing.end));
+	for (auto &queue : intervals)
+	{
+		std::sort(queue.begin(), queue.end());
+		std::vector<std::pair<double, double>> merged;
+		for (const auto &interval : queue)
+		{
+			if (!merged.empty() && interval.first <= merged.back().second)
+				merged.back().second = std::max(merged.back().second, interval.second);
+			else
+				merged.push_back(interval);
+		}
+		queue.swap(merged);
+	}
+	double overlap = 0.0;
+	for (const auto &graphics : intervals[0])
+		for (const auto &compute : intervals[1])
+			overlap += std::max(0.0, std::min(graphics.second, compute.second) - std::max(graphics.first, compute.first));
+	return overlap;
+}
+
+//Timestamps of different queues are compared directly, drivers take them from one device clock
+void WyvRenderGraph::collectTimings(uint32_t _slot)
+{
+	if (!m_queriesWritten[_slot])
+		return;
+	//Value and availability of every query. Only scheduled passes on queues with timestamps reset and wrote theirs,
+	//the others were never reset and can't be read.
+	std::vector<uint64_t> results(m_passes.size() * 4, 0);
+	for (uint32_t p : m_schedule)
+		if (m_timestampRoles[m_passes[p].role == WYV_QUEUE_COMPUTE ? 1 : 0])
+			vkGetQueryPoolResults(Wyvern::GetDevice(), m_queryPools[_slot], p * 2, 2, 4 * sizeof(uint64_t), &results[p * 4],
+				2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+	m_timings.clear();
+	uint64_t base = UINT64_MAX;
+	for (uint32_t p : m_schedule)
+		if (results[p * 4 + 1] && results[p * 4 + 3])
+			base = std::min(base, results[p * 4]);
+	for (uint32_t p : m_schedule)
+	{
+		if (!results[p * 4 + 1] || !results[p * 4 + 3])
+			continue;
+		WyvGraphTiming timing;
+		timing.pass = p;
+		timing.role = m_passes[p].role;
+		timing.begin = (double)(results[p * 4] - base) * m_timestampPeriod / 1000000.0;
+		timing.end = (double)(results[p * 4 + 2] - base) * m_timestampPeriod / 1000000.0;
+		m_timings.push_back(timing);
+	}
+	m_overlap = OverlapOf(m_timings);
+}
+
+void WyvRenderGraph::reset()
+{
+	destroySubmitObjects();
+	m_transients.reset();
+	m_passes.clear();
+	m_resources.clear();
+	m_schedule.clear();
+	m_finalBarriers.clear();
+	m_finalWaits.clear();
+	m_batches.clear();
+	m_compiled = m_async = false;
+	m_barrierCount = m_batchCount = m_transitionCount = m_transferCount = 0;
+}
+
+VkImageLayout WyvRenderGraph::GetLayout(WyvGraphUsage _usage)
+{
+	UsageInfo info;
+	DescribeUsage(_usage, WYV_PASS_GRAPHICS, info);
+	return info.layout;
+}
+
+VkImage WyvRenderGraph::getImage(uint32_t _resource) const
+{
+	const Resource &resource = m_resources[_resource];
+	if (!resource.transient)
+		return resource.image;
+	return resource.transientIndex != UINT32_MAX ? m_transients.getImage(resource.transientIndex) : VK_NULL_HANDLE;
+}
+
+VkImageView WyvRenderGraph::getImageView(uint32_t _resource) const
+{
+	const Resource &resource = m_resources[_resource];
+	if (!resource.transient)
+		return resource.view;
+	return resource.transientIndex != UINT32_MAX ? m_transients.getImageView(resource.transientIndex) : VK_NULL_HANDLE;
+}
+
+std::string WyvRenderGraph::toDot() const
+{
+	static const char *kindNames[] = { "graphics", "compute", "transfer" };
+	std::ostringstream dot;
+	dot << "digraph \"" << Escape(m_name) << "\" {\n\trankdir=LR;\n\tnode [fontname=\"Helvetica\", fontsize=10];\n\tedge [fontname=\"Helvetica\", fontsize=8];\n";
+
+	//Passes of each queue in a cluster of their own when there are two
+	for (int queue = 0; queue < 2; queue++)
+	{
+		if (m_async)
+			dot << "\tsubgraph cluster_" << (queue ? "compute" : "graphics") << " {\n\tlabel=\"" << (queue ? "compute" : "graphics") << " queue\";\n";
+		for (uint32_t p = 0; p < m_passes.size(); p++)
+		{
+			const Pass &pass = m_passes[p];
+			if (pass.culled || (pass.role == WYV_QUEUE_COMPUTE) != (queue == 1))
+				continue;
+			dot << "\tpass" << p << " [shape=box, style=filled, fillcolor=\"" << (pass.kind == WYV_PASS_COMPUTE ? "#d5e8f6" : pass.kind == WYV_PASS_TRANSFER ? "#e4e4e4" : "#f6e4d0")
+				<< "\", label=\"#" << pass.order << " " << Escape(pass.name) << "\\n" << kindNames[pass.kind] << (pass.async ? " async" : "") << ", " << pass.barriers.size() << " barriers";
+			if (!pass.releases.empty())
+				dot << ", " << pass.releases.size() << " releases";
+			if (m_async)
+				dot << "\\nsubmission " << pass.batch;
+			dot << "\"];\n";
+		}
+		if (m_async)
+			dot << "\t}\n";
+	}
+	for (uint32_t p = 0; p < m_passes.size(); p++)
+		if (m_passes[p].culled)
+			dot << "\tpass" << p << " [shape=box, style=dashed, color=gray, fontcolor=gray, label=\"" << Escape(m_passes[p].name) << "\\nculled\"];\n";
+	for (uint32_t r = 0; r < m_resources.size(); r++)
+	{
+		const Resource &resource = m_resources[r];
+		dot << "\tres" << r << " [shape=" << (resource.isImage ? "ellipse" : "cds") << ", label=\"" << Escape(resource.name) << "\\n"
+			<< (resource.transient ? "transient" : "imported") << (resource.output ? ", output" : "") << "\"";
+		if (resource.transient && resource.transientIndex == UINT32_MAX)
+			dot << ", style=dashed, color=gray, fontcolor=gray";
+		dot << "];\n";
+	}
+
+	for (uint32_t p = 0; p < m_passes.size(); p++)
+	{
+		const Pass &pass = m_passes[p];
+		for (const Use &use : pass.uses)
+		{
+			std::string label;
+			for (uint32_t u = 0; u < WYV_GRAPH_USAGE_COUNT; u++)
+				if (use.usages & (1u << u))
+					label += (label.empty() ? "" : ", ") + std::string(g_usageNames[u]);
+			for (const WyvGraphBarrier &barrier : pass.barriers)
+			{
+				if (barrier.resource != use.resource)
+					continue;
+				if (barrier.oldLayout != barrier.newLayout)
+					label += std::string("\\n") + LayoutName(barrier.oldLayout) + " -> " + LayoutName(barrier.newLayout);
+				if (barrier.srcFamily != barrier.dstFamily)
+					label += "\\nacquired from family " + std::to_string(barrier.srcFamily);
+			}
+			if (use.write)
+				dot << "\tpass" << p << " -> res" << use.resource;
+			else
+				dot << "\tres" << use.resource << " -> pass" << p;
+			dot << " [label=\"" << label << "\"" << (pass.culled ? ", style=dashed, color=gray" : "") << "];\n";
+		}
+		for (const Wait &wait : pass.waits)
+			dot << "\tpass" << wait.first << " -> pass" << p << " [style=bold, color=\"#c03030\", fontcolor=\"#c03030\", label=\"semaphore\", constraint=false];\n";
+	}
+
+	if (!m_finalBarriers.empty())
+	{
+		dot << "\tend [shape=doublecircle, label=\"end\"];\n";
+		for (const WyvGraphBarrier &barrier : m_finalBarriers)
+			dot << "\tres" << barrier.resource << " -> end [label=\"" << LayoutName(barrier.oldLayout) << " -> " << LayoutName(barrier.newLayout) << "\"];\n";
+		for (const Wait &wait : m_finalWaits)
+			dot << "\tpass" << wait.first << " -> end [style=bold, color=\"#c03030\", fontcolor=\"#c03030\", label=\"semaphore\", constraint=false];\n";
+	}
+	dot << "}\n";
+	return dot.str();
+}
+
+bool WyvRenderGraph::writeDot(const std::string &_path) const
+{
+	std::ofstream file(_path);
+	if (!file)
+	{
+		WYV_LOG_WARN("Render graph '{}' couldn't write '{}'", m_name, _path);
+		return false;
+	}
+	file << toDot();
+	return (bool)file;
+}
+
+void WyvRenderGraph::logReport() const
+{
+	WYV_LOG_INFO("Render graph '{}': {} of {} passes kept, {} barriers in {} batches, {} of them layout transitions",
+		m_name, (uint32_t)m_schedule.size(), (uint32_t)m_passes.size(), m_barrierCount, m_batchCount, m_transitionCount);
+	if (m_async)
+		WYV_LOG_INFO("Render graph '{}': {} submissions over the graphics and compute queues, {} ownership transfers",
+			m_name, (uint32_t)m_batches.size(), m_transferCount);
+	for (uint32_t p : m_schedule)
+		WYV_LOG_DEBUG("  #{} '{}' on the {} queue: {} barriers", m_passes[p].order, m_passes[p].name,
+			m_passes[p].role == WYV_QUEUE_COMPUTE ? "compute" : "graphics", (uint32_t)m_passes[p].barriers.size());
+}
+
+void WyvRenderGraph::logTimings() const
+{
+	if (m_timings.empty())
+		return;
+	WYV_LOG_INFO("Render graph '{}' GPU timings, graphics and compute overlapped for {} ms", m_name, m_overlap);
+	for (const WyvGraphTiming &timing : m_timings)
+		WYV_LOG_INFO("  {} '{}': {} - {} ms", timing.role == WYV_QUEUE_COMPUTE ? "compute " : "graphics", m_passes[timing.pass].name, timing.begin, timing.end);
+}
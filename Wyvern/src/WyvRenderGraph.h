@@ -0,0 +1,245 @@
+#ifndef _H_WYVRENDERGRAPH_
+#define _H_WYVRENDERGRAPH_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Wyvern.h"
+#include "WyvCommandPools.h"
+#include "WyvTransientPool.h"
+
+namespace wyv
+{
+	enum WyvGraphPassKind { WYV_PASS_GRAPHICS, WYV_PASS_COMPUTE, WYV_PASS_TRANSFER };
+
+	//How a pass uses a resource, which decides the stages, access and image layout it is synchronized for
+	enum WyvGraphUsage
+	{
+		WYV_GRAPH_COLOR_ATTACHMENT,
+		WYV_GRAPH_DEPTH_ATTACHMENT,
+		WYV_GRAPH_DEPTH_READ, //Read-only depth attachment, sampled depth or both
+		WYV_GRAPH_SAMPLED,
+		WYV_GRAPH_STORAGE_READ,
+		WYV_GRAPH_STORAGE_WRITE, //Covers reads in the same pass too
+		WYV_GRAPH_UNIFORM,
+		WYV_GRAPH_VERTEX, //Vertex or index buffer
+		WYV_GRAPH_INDIRECT,
+		WYV_GRAPH_TRANSFER_SRC,
+		WYV_GRAPH_TRANSFER_DST,
+		WYV_GRAPH_PRESENT, //Only as an output's final usage
+		WYV_GRAPH_USAGE_COUNT
+	};
+
+	//A dependency on one resource with stages of its own, like VkImageMemoryBarrier2. The 1.1 API has no per-barrier
+	//stages, so the barriers before a pass are merged into a single vkCmdPipelineBarrier when recorded.
+	struct WyvGraphBarrier
+	{
+		uint32_t resource = 0;
+		VkPipelineStageFlags srcStages = 0, dstStages = 0;
+		VkAccessFlags srcAccess = 0, dstAccess = 0;
+		VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED, newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		//Set on both halves of a queue family ownership transfer
+		uint32_t srcFamily = VK_QUEUE_FAMILY_IGNORED, dstFamily = VK_QUEUE_FAMILY_IGNORED;
+	};
+
+	//When a pass ran on the GPU, in milliseconds from the frame's earliest timestamp
+	struct WyvGraphTiming
+	{
+		uint32_t pass = 0;
+		WyvQueueRole role = WYV_QUEUE_GRAPHICS;
+		double begin = 0.0, end = 0.0;
+	};
+
+	//A frame as passes that declare the resources they use and how. compile() culls the passes whose results nothing
+	//uses, orders the rest so dependent passes sit as far apart as the dependencies allow, and works out the barriers
+	//and layout transitions between them, skipping any that earlier ones already cover.
+	//A pass sees what the latest pass declared before it wrote. Transient images get their lifetimes from the schedule
+	//and share memory through a WyvTransientPool. When a pass records, its images are in the layouts of their usages
+	//(GetLayout), which render passes it begins should use as both initial and final layout.
+	//Work on imported resources outside the graph is the caller's to synchronize, e.g. with the semaphores the frame
+	//waits on and signals. Imported images start every execute in their initial layout; give them a final usage that
+	//brings them back to it, or to where the next user of the image expects it.
+	//Compute passes marked async run on the dedicated compute queue when the device has one. submit() then splits the
+	//frame into submissions per queue, ordered by timeline semaphore waits, and moves resources between the queue
+	//families with release and acquire barriers. Between frames a resource belongs to the family of its first use;
+	//an imported one used by async passes must start out owned by it.
+	class WyvRenderGraph
+	{
+	public:
+		typedef std::function<void(VkCommandBuffer _commandBuffer)> RecordFunction;
+
+	private:
+		//A pass or submission waited on, with the stages that wait
+		typedef std::pair<uint32_t, VkPipelineStageFlags> Wait;
+
+		struct Use
+		{
+			uint32_t resource;
+			uint32_t usages; //Bits of WyvGraphUsage
+			VkPipelineStageFlags stages;
+			VkAccessFlags access;
+			VkImageLayout layout;
+			bool write;
+		};
+
+		struct Pass
+		{
+			std::string name;
+			WyvGraphPassKind kind;
+			RecordFunction record;
+			std::vector<Use> uses;
+			//Earlier passes this one has to run after
+			std::vector<uint32_t> producers;
+			std::vector<WyvGraphBarrier> barriers;
+			//Release halves of ownership transfers, recorded right after the pass
+			std::vector<WyvGraphBarrier> releases;
+			//Acquire halves of the transfers the previous frame ended with, recorded before the barriers
+			std::vector<WyvGraphBarrier> acquires;
+			//Passes on the other queue this one waits for
+			std::vector<Wait> waits;
+			bool sideEffects = false, culled = false, async = false;
+			WyvQueueRole role = WYV_QUEUE_GRAPHICS;
+			uint32_t order = UINT32_MAX, batch = UINT32_MAX;
+		};
+
+		//Consecutive passes of one queue submitted together
+		struct Batch
+		{
+			WyvQueueRole role;
+			std::vector<uint32_t> passes;
+			//Earlier batches on the other queue
+			std::vector<Wait> waits;
+			bool final = false;
+		};
+
+		struct Resource
+		{
+			std::string name;
+			bool isImage = true, transient = false, output = false;
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkImageAspectFlags aspect = 0;
+			VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			WyvGraphUsage finalUsage = WYV_GRAPH_USAGE_COUNT;
+			WyvTransientDesc desc;
+			uint32_t transientIndex = UINT32_MAX;
+		};
+
+		//What a resource went through so far while the barriers are worked out
+		struct State
+		{
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			VkPipelineStageFlags writeStages = 0, transitionStages = 0, readStages = 0, visibleStages = 0;
+			VkAccessFlags writeAccess = 0, visibleAccess = 0;
+			bool touched = false;
+			//Queue of the latest use and the latest pass using it there
+			WyvQueueRole role = WYV_QUEUE_GRAPHICS;
+			uint32_t lastPass = UINT32_MAX;
+		};
+
+		std::string m_name;
+		std::vector<Pass> m_passes;
+		std::vector<Resource> m_resources;
+		std::vector<uint32_t> m_schedule;
+		std::vector<WyvGraphBarrier> m_finalBarriers;
+		std::vector<Wait> m_finalWaits;
+		std::vector<Batch> m_batches;
+		std::vector<VkImageMemoryBarrier> m_imageBarriers;
+		std::vector<VkBufferMemoryBarrier> m_bufferBarriers;
+		WyvTransientPool m_transients;
+		bool m_compiled = false, m_async = false;
+		uint32_t m_barrierCount = 0, m_batchCount = 0, m_transitionCount = 0, m_transferCount = 0;
+
+		//Indexed by role, graphics and compute
+		WyvCommandPools m_commandPools[2];
+		bool m_poolsCreated[2] = {};
+		uint64_t m_lastValues[2] = {};
+		bool m_timestamps = false, m_timestampRoles[2] = {};
+		double m_timestampPeriod = 1.0;
+		//One pool per frame slot with a begin and an end query per pass
+		std::vector<VkQueryPool> m_queryPools;
+		std::vector<bool> m_queriesWritten;
+		std::vector<WyvGraphTiming> m_timings;
+		double m_overlap = 0.0;
+
+		const Use *findUse(const Pass &_pass, uint32_t _resource) const;
+		void cull();
+		void schedule();
+		bool createTransients();
+		void placeBarriers();
+		void placeUse(uint32_t _pass, WyvQueueRole _role, const Use &_use, State &_state, std::vector<WyvGraphBarrier> &_barriers, std::vector<Wait> &_waits, bool _final);
+		void buildBatches();
+		bool createSubmitObjects();
+		void destroySubmitObjects();
+		void collectTimings(uint32_t _slot);
+		static void AddSource(WyvGraphBarrier &_barrier, const State &_state);
+		static void AddWait(std::vector<Wait> &_waits, uint32_t _target, VkPipelineStageFlags _stages);
+		void recordBarriers(VkCommandBuffer _commandBuffer, const std::vector<WyvGraphBarrier> &_barriers);
+
+	public:
+		WyvRenderGraph(std::string _name);
+		~WyvRenderGraph() { destroySubmitObjects(); }
+
+		WyvRenderGraph(const WyvRenderGraph&) = delete;
+		WyvRenderGraph &operator=(const WyvRenderGraph&) = delete;
+
+		//The desc's pass range is ignored and its usage is completed from the passes using the image
+		uint32_t createImage(const WyvTransientDesc &_desc);
+		uint32_t importImage(const std::string &_name, VkImage _image, VkImageView _view, VkFormat _format, VkImageLayout _initialLayout);
+		uint32_t importBuffer(const std::string &_name, VkBuffer _buffer);
+		//Swaps an imported resource's handles between executes, e.g. for the acquired swapchain image
+		void setImage(uint32_t _resource, VkImage _image, VkImageView _view);
+		void setBuffer(uint32_t _resource, VkBuffer _buffer) { m_resources[_resource].buffer = _buffer; }
+		//Passes writing an output are never culled. An image output is transitioned to _finalUsage's layout after the last pass.
+		void markOutput(uint32_t _resource, WyvGraphUsage _finalUsage = WYV_GRAPH_USAGE_COUNT);
+
+		//Returns the pass's index. _record may be empty for passes that only exist for their transitions.
+		uint32_t addPass(const std::string &_name, WyvGraphPassKind _kind, RecordFunction _record);
+		void use(uint32_t _pass, uint32_t _resource, WyvGraphUsage _usage);
+		//Keeps a pass whose results leave the graph some other way, e.g. a readback
+		void setSideEffects(uint32_t _pass) { m_passes[_pass].sideEffects = true; }
+		//Lets a compute pass run on the compute queue, next to the graphics work it doesn't depend on
+		void setAsyncCompute(uint32_t _pass);
+		//Writes a timestamp before and after every pass in submit(), read back once the frame's slot comes around again
+		void setTimestamps(bool _enable);
+
+		//Declarations are only taken before compiling. Returns false if the transient images couldn't be created.
+		bool compile();
+		//Records the passes and their barriers into a graphics command buffer, compiling first if needed.
+		//Only for graphs without passes on the compute queue.
+		void execute(VkCommandBuffer _commandBuffer);
+		//Records the frame into command buffers of the graph's own and submits them to their queues, compiling first if needed.
+		//Returns the graphics submit value after which the outputs are ready, later graphics submissions see them in order.
+		uint64_t submit();
+		//Forgets every pass and resource and destroys the transient images once the GPU is done with them
+		void reset();
+
+		static VkImageLayout GetLayout(WyvGraphUsage _usage);
+
+		VkImage getImage(uint32_t _resource) const;
+		VkImageView getImageView(uint32_t _resource) const;
+		VkBuffer getBuffer(uint32_t _resource) const { return m_resources[_resource].buffer; }
+		bool isCulled(uint32_t _pass) const { return m_passes[_pass].culled; }
+		//Compiled order of the passes that weren't culled
+		const std::vector<uint32_t> &getSchedule() const { return m_schedule; }
+		const std::vector<WyvGraphBarrier> &getBarriers(uint32_t _pass) const { return m_passes[_pass].barriers; }
+		uint32_t getBarrierCount() const { return m_barrierCount; }
+		uint32_t getSubmissionCount() const { return (uint32_t)m_batches.size(); }
+		WyvQueueRole getQueueRole(uint32_t _pass) const { return m_passes[_pass].role; }
+		const WyvTransientPool &getTransientPool() const { return m_transients; }
+		//Timings of the latest frame read back, and how long graphics and compute passes ran at the same time in it
+		const std::vector<WyvGraphTiming> &getTimings() const { return m_timings; }
+		double getOverlap() const { return m_overlap; }
+
+		//The compiled graph in Graphviz DOT: passes in their order with their barriers and queues, culled ones dashed,
+		//the resources between them with the layout transitions on the edges, and the semaphore waits between queues
+		std::string toDot() const;
+		bool writeDot(const std::string &_path) const;
+		void logReport() const;
+		void logTimings() const;
+	};
+}
+
+#endif //_H_WYVRENDERGRAPH_
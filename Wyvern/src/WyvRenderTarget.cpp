@@ -0,0 +1,239 @@
+#include "WyvRenderTarget.h"
+
+#include <algorithm>
+
+using namespace wyv;
+
+const uint32_t WyvRenderTarget::MIN_FRAMES_IN_FLIGHT, WyvRenderTarget::MAX_FRAMES_IN_FLIGHT;
+
+void WyvRenderTarget::createRenderPass()
+{
+	VkAttachmentDescription colorAttachment = {};
+	colorAttachment.format = m_format;
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	colorAttachment.finalLayout = m_finalLayout;
+
+	VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+	VkSubpassDescription subpass = {};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorReference;
+
+	//Layout transition waits for the acquire semaphore, which is waited on at the colour output stage
+	VkSubpassDependency dependency = {};
+	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+	dependency.dstSubpass = 0;
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	//Targets left in TRANSFER_SRC_OPTIMAL are copied from after the pass, the colour writes must be visible to those reads
+	VkSubpassDependency dependencies[2] = { dependency, {} };
+	dependencies[1].srcSubpass = 0;
+	dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+	dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	VkRenderPassCreateInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &colorAttachment;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+	renderPassInfo.dependencyCount = m_finalLayout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL ? 2 : 1;
+	renderPassInfo.pDependencies = dependencies;
+
+	if (vkCreateRenderPass(Wyvern::GetDevice(), &renderPassInfo, Wyvern::GetAllocator(), &m_renderPass) != VK_SUCCESS)
+		Wyvern::Fail("Render target '" + m_name + "' render pass creation failed");
+	m_renderPassFormat = m_format;
+}
+
+void WyvRenderTarget::createImageViews()
+{
+	VkDevice device = Wyvern::GetDevice();
+	m_imageViews.resize(m_images.size());
+	m_framebuffers.resize(m_images.size());
+	for (size_t i = 0; i < m_images.size(); i++)
+	{
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = m_images[i];
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = m_format;
+		viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		if (vkCreateImageView(device, &viewInfo, Wyvern::GetAllocator(), &m_imageViews[i]) != VK_SUCCESS)
+			Wyvern::Fail("Render target '" + m_name + "' image view creation failed");
+
+		VkFramebufferCreateInfo framebufferInfo = {};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = m_renderPass;
+		framebufferInfo.attachmentCount = 1;
+		framebufferInfo.pAttachments = &m_imageViews[i];
+		framebufferInfo.width = m_extent.width;
+		framebufferInfo.height = m_extent.height;
+		framebufferInfo.layers = 1;
+		if (vkCreateFramebuffer(device, &framebufferInfo, Wyvern::GetAllocator(), &m_framebuffers[i]) != VK_SUCCESS)
+			Wyvern::Fail("Render target '" + m_name + "' framebuffer creation failed");
+	}
+}
+
+void WyvRenderTarget::destroyImageViews()
+{
+	VkDevice device = Wyvern::GetDevice();
+	for (size_t i = 0; i < m_imageViews.size(); i++)
+	{
+		vkDestroyFramebuffer(device, m_framebuffers[i], Wyvern::GetAllocator());
+		vkDestroyImageView(device, m_imageViews[i], Wyvern::GetAllocator());
+	}
+	m_framebuffers.clear();
+	m_imageViews.clear();
+}
+
+void WyvRenderTarget::createFrames()
+{
+	VkDevice device = Wyvern::GetDevice();
+	m_frames.resize(m_framesInFlight);
+	for (Frame &frame : m_frames)
+	{
+		VkCommandPoolCreateInfo poolInfo = {};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = Wyvern::GetGraphicsQueueFamily();
+		if (vkCreateCommandPool(device, &poolInfo, Wyvern::GetAllocator(), &frame.commandPool) != VK_SUCCESS)
+			Wyvern::Fail("Render target '" + m_name + "' command pool creation failed");
+
+		VkCommandBufferAllocateInfo allocateInfo = {};
+		allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocateInfo.commandPool = frame.commandPool;
+		allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocateInfo.commandBufferCount = 1;
+		if (vkAllocateCommandBuffers(device, &allocateInfo, &frame.commandBuffer) != VK_SUCCESS)
+			Wyvern::Fail("Render target '" + m_name + "' command buffer allocation failed");
+
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		if (vkCreateSemaphore(device, &semaphoreInfo, Wyvern::GetAllocator(), &frame.imageAvailable) != VK_SUCCESS)
+			Wyvern::Fail("Render target '" + m_name + "' semaphore creation failed");
+		frame.submitValue = 0;
+	}
+	m_frameIndex = 0;
+}
+
+void WyvRenderTarget::destroyFrames()
+{
+	VkDevice device = Wyvern::GetDevice();
+	WyvQueue &queue = Wyvern::GetQueue(WYV_QUEUE_GRAPHICS);
+	for (Frame &frame : m_frames)
+	{
+		queue.wait(frame.submitValue);
+		vkDestroySemaphore(device, frame.imageAvailable, Wyvern::GetAllocator());
+		vkDestroyCommandPool(device, frame.commandPool, Wyvern::GetAllocator());
+	}
+	m_frames.clear();
+}
+
+void WyvRenderTarget::setFramesInFlight(uint32_t _frames)
+{
+	_frames = std::max(MIN_FRAMES_IN_FLIGHT, std::min(MAX_FRAMES_IN_FLIGHT, _frames));
+	if (_frames == m_framesInFlight || m_inFrame)
+		return;
+
+	if (!m_frames.empty())
+	{
+		reportFrameStats();
+		destroyFrames();
+		m_framesInFlight = _frames;
+		createFrames();
+	}
+	else
+		m_framesInFlight = _frames;
+	m_frameStats.reset();
+}
+
+void WyvRenderTarget::reportFrameStats()
+{
+	if (m_frameStats.getSampleCount() < 2)
+		return;
+	WyvFrameStats::Summary summary = m_frameStats.summarize();
+	WYV_LOG_INFO("'{}' with {} frames in flight: avg {} ms, p50 {} ms, p95 {} ms, p99 {} ms, max {} ms over {} frames",
+		m_name, m_framesInFlight, summary.average, summary.p50, summary.p95, summary.p99, summary.max, summary.samples);
+}
+
+bool WyvRenderTarget::addFrameHook(std::function<void(VkCommandBuffer)> _afterPass, std::function<void(uint64_t)> _afterSubmit)
+{
+	if (!m_inFrame)
+	{
+		WYV_LOG_WARN("'{}' frame hook added outside of a frame, ignored", m_name);
+		return false;
+	}
+	m_afterPass.push_back(_afterPass);
+	m_afterSubmit.push_back(_afterSubmit);
+	return true;
+}
+
+VkCommandBuffer WyvRenderTarget::beginFrame(VkSubpassContents _contents)
+{
+	if (m_frames.empty() || m_inFrame)
+		return VK_NULL_HANDLE;
+
+	Frame &frame = m_frames[m_frameIndex];
+	if (!acquireImage(frame))
+		return VK_NULL_HANDLE;
+
+	vkResetCommandPool(Wyvern::GetDevice(), frame.commandPool, 0);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(frame.commandBuffer, &beginInfo);
+
+	VkClearValue clearValue;
+	clearValue.color = m_clearColor;
+
+	VkRenderPassBeginInfo renderPassBegin = {};
+	renderPassBegin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassBegin.renderPass = m_renderPass;
+	renderPassBegin.framebuffer = m_framebuffers[m_imageIndex];
+	renderPassBegin.renderArea.extent = m_extent;
+	renderPassBegin.clearValueCount = 1;
+	renderPassBegin.pClearValues = &clearValue;
+	vkCmdBeginRenderPass(frame.commandBuffer, &renderPassBegin, _contents);
+
+	m_subpassContents = _contents;
+	m_inFrame = true;
+	return frame.commandBuffer;
+}
+
+void WyvRenderTarget::endFrame()
+{
+	if (!m_inFrame)
+		return;
+	m_inFrame = false;
+
+	Frame &frame = m_frames[m_frameIndex];
+	vkCmdEndRenderPass(frame.commandBuffer);
+	for (auto &hook : m_afterPass)
+		if (hook)
+			hook(frame.commandBuffer);
+	vkEndCommandBuffer(frame.commandBuffer);
+
+	frame.submitValue = submitFrame(frame);
+	for (auto &hook : m_afterSubmit)
+		if (hook)
+			hook(frame.submitValue);
+	m_afterPass.clear();
+	m_afterSubmit.clear();
+
+	m_frameIndex = (m_frameIndex + 1) % m_framesInFlight;
+	m_frameStats.tick();
+	//Staging allocations made up to here are read by this submission or by earlier ones on the graphics queue
+	Wyvern::GetStagingRing().endFrame(frame.submitValue, WYV_QUEUE_GRAPHICS);
+	Wyvern::GetMemory().updateBudget();
+}
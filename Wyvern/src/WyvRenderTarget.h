@@ -0,0 +1,104 @@
+#ifndef _H_WYVRENDERTARGET_
+#define _H_WYVRENDERTARGET_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Wyvern.h"
+#include "WyvFrameStats.h"
+#include "WyvObject.h"
+
+namespace wyv
+{
+	//Frame loop shared by everything rendered to: frames in flight, a render pass that clears the target
+	//and a framebuffer per image. Subclasses decide where the images come from and where they go.
+	class WyvRenderTarget : public WyvObject
+	{
+	protected:
+		//Per frame-in-flight resources, reused once the graphics timeline passes submitValue
+		struct Frame
+		{
+			VkCommandPool commandPool = VK_NULL_HANDLE;
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			VkSemaphore imageAvailable = VK_NULL_HANDLE;
+			uint64_t submitValue = 0;
+		};
+
+		std::string m_name;
+		VkFormat m_format = VK_FORMAT_UNDEFINED;
+		VkExtent2D m_extent = {};
+		VkImageLayout m_finalLayout;
+		VkRenderPass m_renderPass = VK_NULL_HANDLE;
+		VkFormat m_renderPassFormat = VK_FORMAT_UNDEFINED;
+
+		std::vector<VkImage> m_images;
+		std::vector<VkImageView> m_imageViews;
+		std::vector<VkFramebuffer> m_framebuffers;
+
+		std::vector<Frame> m_frames;
+		uint32_t m_framesInFlight = 2;
+		uint32_t m_frameIndex = 0, m_imageIndex = 0;
+		bool m_inFrame = false;
+		VkSubpassContents m_subpassContents = VK_SUBPASS_CONTENTS_INLINE;
+		VkClearColorValue m_clearColor = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+		WyvFrameStats m_frameStats;
+
+		std::vector<std::function<void(VkCommandBuffer)>> m_afterPass;
+		std::vector<std::function<void(uint64_t)>> m_afterSubmit;
+
+		WyvRenderTarget(const std::string &_name, VkImageLayout _finalLayout) : m_name(_name), m_finalLayout(_finalLayout) {}
+
+		//Clears on load and leaves the image in m_finalLayout
+		void createRenderPass();
+		//Views and framebuffers for m_images at m_format and m_extent
+		void createImageViews();
+		void destroyImageViews();
+		void createFrames();
+		void destroyFrames();
+		virtual void reportFrameStats();
+
+		//Waits until _frame can be recorded again and sets m_imageIndex, returning false skips the frame
+		virtual bool acquireImage(Frame &_frame) = 0;
+		//Submits _frame's recorded command buffer, returns its graphics timeline value
+		virtual uint64_t submitFrame(Frame &_frame) = 0;
+
+	public:
+		static const uint32_t MIN_FRAMES_IN_FLIGHT = 2, MAX_FRAMES_IN_FLIGHT = 4;
+
+		virtual ~WyvRenderTarget() {}
+
+		WyvRenderTarget(const WyvRenderTarget&) = delete;
+		WyvRenderTarget &operator=(const WyvRenderTarget&) = delete;
+
+		//Acquires an image and begins its render pass with the clear colour. With VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+		//the pass only takes vkCmdExecuteCommands, e.g. from a WyvParallelRecorder.
+		//Returns the command buffer to record into, or VK_NULL_HANDLE if no frame can be rendered right now.
+		VkCommandBuffer beginFrame(VkSubpassContents _contents = VK_SUBPASS_CONTENTS_INLINE);
+		//Ends the render pass, submits to the graphics queue and retires the shared staging ring's allocations with it
+		void endFrame();
+
+		//Clamped to [MIN_FRAMES_IN_FLIGHT, MAX_FRAMES_IN_FLIGHT], waits for frames in flight to finish
+		void setFramesInFlight(uint32_t _frames);
+		//Only valid between beginFrame and endFrame, returns false otherwise. _afterPass records into the frame's command buffer once the render
+		//pass has ended, _afterSubmit receives the frame's graphics timeline value.
+		bool addFrameHook(std::function<void(VkCommandBuffer)> _afterPass, std::function<void(uint64_t)> _afterSubmit = nullptr);
+		void setClearColor(float _r, float _g, float _b, float _a = 1.0f) { m_clearColor = { { _r, _g, _b, _a } }; }
+
+		const std::string &getName() const { return m_name; }
+		VkFormat getFormat() const { return m_format; }
+		VkExtent2D getExtent() const { return m_extent; }
+		VkRenderPass getRenderPass() const { return m_renderPass; }
+		VkFramebuffer getFramebuffer() const { return m_framebuffers[m_imageIndex]; }
+		VkImage getImage() const { return m_images[m_imageIndex]; }
+		VkImageView getImageView() const { return m_imageViews[m_imageIndex]; }
+		uint32_t getImageIndex() const { return m_imageIndex; }
+		uint32_t getImageCount() const { return (uint32_t)m_images.size(); }
+		uint32_t getFramesInFlight() const { return m_framesInFlight; }
+		bool isInFrame() const { return m_inFrame; }
+		VkSubpassContents getSubpassContents() const { return m_subpassContents; }
+		const WyvFrameStats &getFrameStats() const { return m_frameStats; }
+	};
+}
+
+#endif //_H_WYVRENDERTARGET_
@@ -0,0 +1,179 @@
+#include "WyvStagingRing.h"
+
+#include <algorithm>
+
+#include "Wyvern.h"
+
+using namespace wyv;
+
+const VkDeviceSize WyvStagingRing::DEFAULT_SIZE, WyvStagingRing::DEFAULT_CHUNK_SIZE;
+
+//Vulkan alignments are powers of two, but vertex strides used as alignment need not be
+static VkDeviceSize AlignTo(VkDeviceSize _value, VkDeviceSize _alignment)
+{
+	return (_value + _alignment - 1) / _alignment * _alignment;
+}
+
+WyvStagingAllocation WyvStagingWriter::allocate(VkDeviceSize _size, VkDeviceSize _alignment)
+{
+	WyvStagingAllocation allocation;
+	if (!m_ring || !m_ring->m_mapped)
+		return allocation;
+	_size = std::max<VkDeviceSize>(_size, 1);
+	_alignment = std::max<VkDeviceSize>(_alignment, 1);
+
+	uint64_t epoch = m_ring->m_epoch.load(std::memory_order_acquire);
+	if (m_epoch != epoch)
+	{
+		m_offset = m_end = 0;
+		m_epoch = epoch;
+	}
+
+	VkDeviceSize offset = AlignTo(m_offset, _alignment);
+	if (offset + _size > m_end)
+	{
+		//Chunks start on multiples of the chunk size, the padding only matters for alignments that don't divide it
+		VkDeviceSize chunkSize = m_ring->m_chunkSize;
+		uint32_t chunks = (uint32_t)((_size + _alignment - 1 + chunkSize - 1) / chunkSize);
+		VkDeviceSize start;
+		if (!m_ring->claim(chunks, start))
+			return allocation;
+		m_end = start + chunks * chunkSize;
+		offset = AlignTo(start, _alignment);
+	}
+	m_offset = offset + _size;
+
+	allocation.mapped = m_ring->m_mapped + offset;
+	allocation.buffer = m_ring->m_buffer;
+	allocation.offset = offset;
+	allocation.size = _size;
+	return allocation;
+}
+
+void WyvStagingRing::create(VkDevice _device, VkDeviceSize _size, VkDeviceSize _chunkSize)
+{
+	m_device = _device;
+	//256 bytes covers minUniformBufferOffsetAlignment and nonCoherentAtomSize on every implementation
+	m_chunkSize = AlignTo(std::max<VkDeviceSize>(_chunkSize, 256), 256);
+	m_chunkCount = (uint32_t)std::max<VkDeviceSize>((_size + m_chunkSize - 1) / m_chunkSize, 1);
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = m_chunkSize * m_chunkCount;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if (vkCreateBuffer(m_device, &bufferInfo, Wyvern::GetAllocator(), &m_buffer) != VK_SUCCESS)
+		Wyvern::Fail("Staging ring buffer creation failed");
+
+	m_memory = Wyvern::GetMemory().allocateBuffer(m_buffer, WYV_MEMORY_CPU_TO_GPU);
+	if (!m_memory || !m_memory->mapped)
+		Wyvern::Fail("Staging ring has no host visible memory");
+	m_mapped = (uint8_t*)m_memory->mapped;
+	m_writer = createWriter();
+
+	WYV_LOG_MESSAGE("Staging ring created: {} chunks of {} KB, {} memory", m_chunkCount, (uint64_t)(m_chunkSize / 1024),
+		Wyvern::GetMemory().isCoherent(m_memory->memoryType) ? "coherent" : "non-coherent");
+}
+
+void WyvStagingRing::destroy()
+{
+	if (!m_buffer)
+		return;
+	for (const Retired &retired : m_retired)
+		Wyvern::GetQueue(retired.role).wait(retired.value);
+
+	WYV_LOG_MESSAGE("Staging ring: {} frames, {} MB claimed, peak {} of {} MB, {} stalls, {} failed allocations", m_frames,
+		(double)(m_claimedTotal * m_chunkSize) / (1024.0 * 1024.0), (double)getPeakUsage() / (1024.0 * 1024.0), (double)getSize() / (1024.0 * 1024.0), m_stalls, m_failures);
+
+	vkDestroyBuffer(m_device, m_buffer, Wyvern::GetAllocator());
+	Wyvern::GetMemory().free(m_memory);
+	m_buffer = VK_NULL_HANDLE;
+	m_memory = nullptr;
+	m_mapped = nullptr;
+	m_retired.clear();
+	m_head = m_tail = m_claimed = m_frameHead = m_frameChunks = 0;
+	m_writer = WyvStagingWriter();
+}
+
+//Frames are released strictly in order, a later frame that completed first waits for the one before it
+void WyvStagingRing::reclaim()
+{
+	while (!m_retired.empty() && Wyvern::GetQueue(m_retired.front().role).isComplete(m_retired.front().value))
+	{
+		const Retired &oldest = m_retired.front();
+		m_tail = (oldest.head + oldest.chunks) % m_chunkCount;
+		m_claimed -= oldest.chunks;
+		m_retired.pop_front();
+	}
+	//Starting over from the front of an idle ring keeps large claims from skipping its tail
+	if (m_claimed == 0)
+		m_head = m_tail = m_frameHead = 0;
+}
+
+bool WyvStagingRing::claim(uint32_t _chunks, VkDeviceSize &_offset)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (_chunks > m_chunkCount)
+	{
+		m_failures++;
+		WYV_LOG_ERROR("Staging allocation of {} chunks doesn't fit a ring of {}", _chunks, m_chunkCount);
+		return false;
+	}
+
+	//A claim running past the end skips the remaining chunks, they are retired with the frame like any other
+	uint32_t skip;
+	while (true)
+	{
+		reclaim();
+		skip = m_head + _chunks > m_chunkCount ? m_chunkCount - m_head : 0;
+		if (m_claimed + skip + _chunks <= m_chunkCount)
+			break;
+		if (m_retired.empty())
+		{
+			m_failures++;
+			WYV_LOG_ERROR("Staging ring exhausted within a single frame, {} of {} chunks claimed", m_claimed, m_chunkCount);
+			return false;
+		}
+		m_stalls++;
+		Wyvern::GetQueue(m_retired.front().role).wait(m_retired.front().value);
+	}
+
+	if (skip)
+	{
+		m_claimed += skip;
+		m_frameChunks += skip;
+		m_head = 0;
+	}
+	_offset = m_head * m_chunkSize;
+	m_head = (m_head + _chunks) % m_chunkCount;
+	m_claimed += _chunks;
+	m_frameChunks += _chunks;
+	m_claimedTotal += _chunks;
+	m_peakChunks = std::max(m_peakChunks, m_claimed);
+	return true;
+}
+
+void WyvStagingRing::flushRange(uint32_t _first, uint32_t _chunks)
+{
+	WyvMemory &memory = Wyvern::GetMemory();
+	if (memory.isCoherent(m_memory->memoryType))
+		return;
+	uint32_t tail = std::min(_chunks, m_chunkCount - _first);
+	memory.flush(m_memory, _first * m_chunkSize, tail * m_chunkSize);
+	if (tail < _chunks)
+		memory.flush(m_memory, 0, (_chunks - tail) * m_chunkSize);
+}
+
+void WyvStagingRing::endFrame(uint64_t _value, WyvQueueRole _role)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (m_frameChunks)
+	{
+		flushRange(m_frameHead, m_frameChunks);
+		m_retired.push_back({ _value, _role, m_frameHead, m_frameChunks });
+		m_frameHead = m_head;
+		m_frameChunks = 0;
+	}
+	m_frames++;
+	m_epoch.fetch_add(1, std::memory_order_release);
+}
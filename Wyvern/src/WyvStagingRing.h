@@ -0,0 +1,112 @@
+#ifndef _H_WYVSTAGINGRING_
+#define _H_WYVSTAGINGRING_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include "vulkan/vulkan.h"
+
+#include "WyvMemory.h"
+#include "WyvQueue.h"
+
+namespace wyv
+{
+	class WyvStagingRing;
+
+	//Space for one upload, valid until the frame it was allocated in completes. mapped is nullptr if the ring was exhausted.
+	struct WyvStagingAllocation
+	{
+		void *mapped = nullptr;
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0, size = 0;
+
+		explicit operator bool() const { return mapped != nullptr; }
+	};
+
+	//A thread's sub-ring. Bump allocates from a chunk it owns and only takes the ring's lock to claim the next chunk,
+	//so each recording thread should use its own writer and never share it.
+	class WyvStagingWriter
+	{
+		friend class WyvStagingRing;
+
+		WyvStagingRing *m_ring = nullptr;
+		VkDeviceSize m_offset = 0, m_end = 0;
+		uint64_t m_epoch = 0;
+
+		explicit WyvStagingWriter(WyvStagingRing *_ring) : m_ring(_ring) {}
+
+	public:
+		WyvStagingWriter() {}
+
+		//_alignment doesn't have to be a power of two, e.g. the stride of a vertex format
+		WyvStagingAllocation allocate(VkDeviceSize _size, VkDeviceSize _alignment = 16);
+	};
+
+	//Persistently mapped ring buffer for per-frame uploads. Writers claim fixed size chunks in ring order; endFrame
+	//tags everything claimed since the previous call with the timeline value of the submission that reads it, and
+	//those chunks are reclaimed once the queue reaches that value. The buffer can be copied from or bound directly
+	//as vertex, index or uniform data.
+	class WyvStagingRing
+	{
+		friend class WyvStagingWriter;
+
+		struct Retired
+		{
+			uint64_t value;
+			WyvQueueRole role;
+			uint32_t head, chunks;
+		};
+
+		VkDevice m_device = VK_NULL_HANDLE;
+		VkBuffer m_buffer = VK_NULL_HANDLE;
+		WyvAllocation *m_memory = nullptr;
+		uint8_t *m_mapped = nullptr;
+		VkDeviceSize m_chunkSize = 0;
+		uint32_t m_chunkCount = 0;
+
+		std::mutex m_mutex;
+		uint32_t m_head = 0, m_tail = 0, m_claimed = 0;
+		uint32_t m_frameHead = 0, m_frameChunks = 0;
+		std::deque<Retired> m_retired;
+		//Bumped by endFrame so writers drop the chunk they hold instead of writing into a retired one
+		std::atomic<uint64_t> m_epoch;
+		WyvStagingWriter m_writer;
+
+		uint32_t m_peakChunks = 0, m_stalls = 0, m_failures = 0;
+		uint64_t m_frames = 0, m_claimedTotal = 0;
+
+		void reclaim();
+		bool claim(uint32_t _chunks, VkDeviceSize &_offset);
+		void flushRange(uint32_t _first, uint32_t _chunks);
+
+	public:
+		static const VkDeviceSize DEFAULT_SIZE = 32 * 1024 * 1024, DEFAULT_CHUNK_SIZE = 256 * 1024;
+
+		WyvStagingRing() : m_epoch(1) {}
+		WyvStagingRing(const WyvStagingRing&) = delete;
+		WyvStagingRing &operator=(const WyvStagingRing&) = delete;
+
+		void create(VkDevice _device, VkDeviceSize _size = DEFAULT_SIZE, VkDeviceSize _chunkSize = DEFAULT_CHUNK_SIZE);
+		//Waits for every retired frame, the device must not be reading the ring past that
+		void destroy();
+
+		WyvStagingWriter createWriter() { return WyvStagingWriter(this); }
+		//Shorthand for the ring's own writer, only for the thread that calls endFrame
+		WyvStagingAllocation allocate(VkDeviceSize _size, VkDeviceSize _alignment = 16) { return m_writer.allocate(_size, _alignment); }
+
+		//Call once the work reading this frame's allocations is submitted, and only while no writer is allocating.
+		//_value is the submit value returned by _role's queue. Flushes the frame's chunks if the memory isn't coherent.
+		void endFrame(uint64_t _value, WyvQueueRole _role = WYV_QUEUE_GRAPHICS);
+
+		VkBuffer getBuffer() const { return m_buffer; }
+		VkDeviceSize getSize() const { return m_chunkSize * m_chunkCount; }
+		VkDeviceSize getChunkSize() const { return m_chunkSize; }
+		//Times a claim had to wait for the GPU to release a frame
+		uint32_t getStallCount() const { return m_stalls; }
+		VkDeviceSize getPeakUsage() const { return m_peakChunks * m_chunkSize; }
+	};
+}
+
+#endif //_H_WYVSTAGINGRING_
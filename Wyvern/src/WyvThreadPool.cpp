@@ -0,0 +1,85 @@
+#include "WyvThreadPool.h"
+
+#include <algorithm>
+
+using namespace wyv;
+
+void WyvThreadPool::create(uint32_t _threads)
+{
+	destroy();
+	if (!_threads)
+		_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	m_stop = false;
+	for (uint32_t i = 1; i < _threads; i++)
+		m_workers.emplace_back(&WyvThreadPool::work, this);
+}
+
+void WyvThreadPool::destroy()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (std::thread &worker : m_workers)
+		worker.join();
+	m_workers.clear();
+}
+
+//A worker that wakes after the job was finished finds it gone and goes back to sleep
+void WyvThreadPool::work()
+{
+	uint64_t seen = 0;
+	while (true)
+	{
+		const std::function<void(uint32_t)> *job;
+		uint32_t count;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this, seen] { return m_stop || m_generation != seen; });
+			if (m_stop)
+				return;
+			seen = m_generation;
+			if (!m_job)
+				continue;
+			job = m_job;
+			count = m_jobCount;
+			m_busy++;
+		}
+		runJob(*job, count);
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_busy == 0)
+			m_done.notify_all();
+	}
+}
+
+void WyvThreadPool::runJob(const std::function<void(uint32_t)> &_job, uint32_t _count)
+{
+	for (uint32_t index = m_next.fetch_add(1, std::memory_order_relaxed); index < _count; index = m_next.fetch_add(1, std::memory_order_relaxed))
+		_job(index);
+}
+
+void WyvThreadPool::parallelFor(uint32_t _count, const std::function<void(uint32_t)> &_job)
+{
+	if (m_workers.empty() || _count < 2)
+	{
+		for (uint32_t i = 0; i < _count; i++)
+			_job(i);
+		return;
+	}
+
+	std::lock_guard<std::mutex> caller(m_callerMutex);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_job = &_job;
+		m_jobCount = _count;
+		m_next.store(0, std::memory_order_relaxed);
+		m_generation++;
+	}
+	m_wake.notify_all();
+	runJob(_job, _count);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_done.wait(lock, [this] { return m_busy == 0; });
+	m_job = nullptr;
+}
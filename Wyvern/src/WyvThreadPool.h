@@ -0,0 +1,48 @@
+#ifndef _H_WYVTHREADPOOL_
+#define _H_WYVTHREADPOOL_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wyv
+{
+	//Fixed set of worker threads for fork-join work. parallelFor hands out indices one at a time, so uneven jobs
+	//balance themselves, and the calling thread works alongside the workers until every index is done.
+	class WyvThreadPool
+	{
+		std::vector<std::thread> m_workers;
+		std::mutex m_mutex, m_callerMutex;
+		std::condition_variable m_wake, m_done;
+		const std::function<void(uint32_t)> *m_job = nullptr;
+		uint32_t m_jobCount = 0, m_busy = 0;
+		uint64_t m_generation = 0;
+		bool m_stop = false;
+		std::atomic<uint32_t> m_next;
+
+		void work();
+		void runJob(const std::function<void(uint32_t)> &_job, uint32_t _count);
+
+	public:
+		WyvThreadPool() : m_next(0) {}
+		~WyvThreadPool() { destroy(); }
+
+		WyvThreadPool(const WyvThreadPool&) = delete;
+		WyvThreadPool &operator=(const WyvThreadPool&) = delete;
+
+		//_threads counts the calling thread, so 1 starts no workers and 0 means one per hardware thread
+		void create(uint32_t _threads = 0);
+		void destroy();
+
+		//Calls _job for every index below _count and returns once all of them returned. Calls from several threads take turns.
+		void parallelFor(uint32_t _count, const std::function<void(uint32_t)> &_job);
+
+		uint32_t getThreadCount() const { return (uint32_t)m_workers.size() + 1; }
+	};
+}
+
+#endif //_H_WYVTHREADPOOL_
@@ -0,0 +1,209 @@
+#include "WyvTimeline.h"
+
+#include "Wyvern.h"
+
+using namespace wyv;
+
+PFN_vkGetSemaphoreCounterValueKHR WyvTimeline::g_getCounterValue = nullptr;
+PFN_vkWaitSemaphoresKHR WyvTimeline::g_waitSemaphores = nullptr;
+
+void WyvTimeline::LoadFunctions(VkDevice _device)
+{
+	g_getCounterValue = (PFN_vkGetSemaphoreCounterValueKHR)vkGetDeviceProcAddr(_device, "vkGetSemaphoreCounterValueKHR");
+	g_waitSemaphores = (PFN_vkWaitSemaphoresKHR)vkGetDeviceProcAddr(_device, "vkWaitSemaphoresKHR");
+}
+
+void WyvTimeline::create(VkDevice _device, bool _useSemaphore)
+{
+	m_device = _device;
+	m_submitted.store(0);
+	m_completed.store(0);
+
+	if (!_useSemaphore || !g_getCounterValue || !g_waitSemaphores)
+		return;
+
+	VkSemaphoreTypeCreateInfoKHR typeInfo = {};
+	typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+	typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+	typeInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	createInfo.pNext = &typeInfo;
+
+	if (vkCreateSemaphore(_device, &createInfo, Wyvern::GetAllocator(), &m_semaphore) != VK_SUCCESS)
+	{
+		WYV_LOG_WARN("Timeline semaphore creation failed, falling back to fences");
+		m_semaphore = VK_NULL_HANDLE;
+	}
+}
+
+void WyvTimeline::destroy()
+{
+	collect();
+	{
+		std::lock_guard<std::mutex> lock(m_releaseMutex);
+		for (auto &release : m_releases)
+			release.second();
+		m_releases.clear();
+	}
+
+	std::lock_guard<std::mutex> lock(m_fenceMutex);
+	for (auto &pending : m_pendingFences)
+		m_freeFences.push_back(pending.second);
+	m_pendingFences.clear();
+	m_freeFences.insert(m_freeFences.end(), m_retiredFences.begin(), m_retiredFences.end());
+	m_retiredFences.clear();
+	for (VkFence fence : m_freeFences)
+		vkDestroyFence(m_device, fence, Wyvern::GetAllocator());
+	m_freeFences.clear();
+
+	if (m_semaphore)
+		vkDestroySemaphore(m_device, m_semaphore, Wyvern::GetAllocator());
+	m_semaphore = VK_NULL_HANDLE;
+}
+
+uint64_t WyvTimeline::beginSubmit(VkFence &_fence)
+{
+	uint64_t value = m_submitted.load(std::memory_order_relaxed) + 1;
+	_fence = VK_NULL_HANDLE;
+	if (!m_semaphore)
+	{
+		std::lock_guard<std::mutex> lock(m_fenceMutex);
+		if (m_freeFences.empty())
+		{
+			VkFenceCreateInfo createInfo = {};
+			createInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			if (vkCreateFence(m_device, &createInfo, Wyvern::GetAllocator(), &_fence) != VK_SUCCESS)
+				Wyvern::Fail("Submission fence creation failed");
+		}
+		else
+		{
+			_fence = m_freeFences.back();
+			m_freeFences.pop_back();
+		}
+		m_pendingFences.push_back(std::make_pair(value, _fence));
+	}
+	m_submitted.store(value, std::memory_order_release);
+	return value;
+}
+
+void WyvTimeline::cancelSubmit(uint64_t _value, VkFence _fence)
+{
+	m_submitted.store(_value - 1, std::memory_order_release);
+	if (_fence)
+	{
+		std::lock_guard<std::mutex> lock(m_fenceMutex);
+		m_pendingFences.pop_back();
+		recycleFence(_fence);
+	}
+}
+
+void WyvTimeline::recycleFence(VkFence _fence)
+{
+	//Called with m_fenceMutex held
+	if (m_fenceWaiters)
+	{
+		m_retiredFences.push_back(_fence);
+		return;
+	}
+	vkResetFences(m_device, 1, &_fence);
+	m_freeFences.push_back(_fence);
+}
+
+void WyvTimeline::retireFences()
+{
+	//Fences signal in submission order on one queue, so stop at the first unsignalled one
+	std::lock_guard<std::mutex> lock(m_fenceMutex);
+	while (!m_pendingFences.empty() && vkGetFenceStatus(m_device, m_pendingFences.front().second) == VK_SUCCESS)
+	{
+		m_completed.store(m_pendingFences.front().first, std::memory_order_release);
+		recycleFence(m_pendingFences.front().second);
+		m_pendingFences.pop_front();
+	}
+}
+
+uint64_t WyvTimeline::getCompletedValue()
+{
+	if (m_semaphore)
+	{
+		uint64_t value = 0;
+		g_getCounterValue(m_device, m_semaphore, &value);
+		m_completed.store(value, std::memory_order_release);
+		return value;
+	}
+	retireFences();
+	return m_completed.load(std::memory_order_acquire);
+}
+
+bool WyvTimeline::isComplete(uint64_t _value)
+{
+	return _value <= m_completed.load(std::memory_order_acquire) || _value <= getCompletedValue();
+}
+
+bool WyvTimeline::wait(uint64_t _value, uint64_t _timeout)
+{
+	if (isComplete(_value))
+		return true;
+
+	if (m_semaphore)
+	{
+		VkSemaphoreWaitInfoKHR waitInfo = {};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &m_semaphore;
+		waitInfo.pValues = &_value;
+		return g_waitSemaphores(m_device, &waitInfo, _timeout) == VK_SUCCESS && isComplete(_value);
+	}
+
+	VkFence fence = VK_NULL_HANDLE;
+	{
+		std::lock_guard<std::mutex> lock(m_fenceMutex);
+		//Another thread may have retired the value since isComplete, its fence could already be recycled
+		if (_value <= m_completed.load(std::memory_order_acquire))
+			return true;
+		auto pending = m_pendingFences.begin();
+		while (pending != m_pendingFences.end() && pending->first < _value)
+			pending++;
+		//Value not submitted yet, nothing to wait on
+		if (pending == m_pendingFences.end())
+			return false;
+		fence = pending->second;
+		m_fenceWaiters++;
+	}
+
+	//Waited on without the lock so pollers and submitters aren't blocked, the waiter count keeps the fence from being reset
+	VkResult result = vkWaitForFences(m_device, 1, &fence, VK_TRUE, _timeout);
+	{
+		std::lock_guard<std::mutex> lock(m_fenceMutex);
+		if (!--m_fenceWaiters)
+		{
+			for (VkFence retired : m_retiredFences)
+				recycleFence(retired);
+			m_retiredFences.clear();
+		}
+	}
+	return result == VK_SUCCESS && isComplete(_value);
+}
+
+void WyvTimeline::release(std::function<void()> _release)
+{
+	std::lock_guard<std::mutex> lock(m_releaseMutex);
+	m_releases.push_back(std::make_pair(getSubmittedValue(), std::move(_release)));
+}
+
+void WyvTimeline::collect()
+{
+	uint64_t completed = getCompletedValue();
+	std::deque<std::function<void()>> ready;
+	{
+		std::lock_guard<std::mutex> lock(m_releaseMutex);
+		while (!m_releases.empty() && m_releases.front().first <= completed)
+		{
+			ready.push_back(std::move(m_releases.front().second));
+			m_releases.pop_front();
+		}
+	}
+	for (auto &release : ready)
+		release();
+}
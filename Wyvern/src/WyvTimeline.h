@@ -0,0 +1,72 @@
+#ifndef _H_WYVTIMELINE_
+#define _H_WYVTIMELINE_
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "WyvVulkanExt.h"
+
+namespace wyv
+{
+	//Monotonic submission counter for one queue. Every submit signals the next value, so CPU code can
+	//poll or wait on any earlier submission by value alone. Backed by a VK_KHR_timeline_semaphore when
+	//the device has one, otherwise by a recycled pool of fences, one per in-flight submission.
+	class WyvTimeline
+	{
+		static PFN_vkGetSemaphoreCounterValueKHR g_getCounterValue;
+		static PFN_vkWaitSemaphoresKHR g_waitSemaphores;
+
+		VkDevice m_device = VK_NULL_HANDLE;
+		VkSemaphore m_semaphore = VK_NULL_HANDLE;
+		std::atomic<uint64_t> m_submitted, m_completed;
+
+		std::mutex m_fenceMutex;
+		std::deque<std::pair<uint64_t, VkFence>> m_pendingFences;
+		std::vector<VkFence> m_freeFences;
+		//Signalled fences held back from reuse while a wait() outside the lock may still be blocked on one
+		std::vector<VkFence> m_retiredFences;
+		uint32_t m_fenceWaiters = 0;
+
+		std::mutex m_releaseMutex;
+		std::deque<std::pair<uint64_t, std::function<void()>>> m_releases;
+
+		void retireFences();
+		void recycleFence(VkFence _fence);
+
+	public:
+		WyvTimeline() : m_submitted(0), m_completed(0) {}
+		~WyvTimeline() {}
+
+		WyvTimeline(const WyvTimeline&) = delete;
+		WyvTimeline &operator=(const WyvTimeline&) = delete;
+
+		static void LoadFunctions(VkDevice _device);
+
+		void create(VkDevice _device, bool _useSemaphore);
+		void destroy();
+
+		//Called by the owning queue with its submit lock held. Returns the value the submission will signal
+		//and, in fallback mode, the fence to submit with.
+		uint64_t beginSubmit(VkFence &_fence);
+		//Rolls the counter back if vkQueueSubmit failed
+		void cancelSubmit(uint64_t _value, VkFence _fence);
+
+		bool isComplete(uint64_t _value);
+		uint64_t getCompletedValue();
+		bool wait(uint64_t _value, uint64_t _timeout = UINT64_MAX);
+
+		//Runs _release once everything submitted so far has completed, see collect()
+		void release(std::function<void()> _release);
+		void collect();
+
+		bool usesSemaphore() const { return m_semaphore != VK_NULL_HANDLE; }
+		VkSemaphore getSemaphore() const { return m_semaphore; }
+		uint64_t getSubmittedValue() const { return m_submitted.load(std::memory_order_acquire); }
+	};
+}
+
+#endif //_H_WYVTIMELINE_
@@ -0,0 +1,260 @@
+#include "WyvTransientPool.h"
+
+#include <algorithm>
+
+using namespace wyv;
+
+static VkDeviceSize AlignUp(VkDeviceSize _value, VkDeviceSize _alignment)
+{
+	return (_value + _alignment - 1) / _alignment * _alignment;
+}
+
+static bool Overlaps(const WyvTransientDesc &_a, const WyvTransientDesc &_b)
+{
+	return _a.firstPass <= _b.lastPass && _b.firstPass <= _a.lastPass;
+}
+
+WyvTransientPool::WyvTransientPool(std::string _name) : m_name(_name)
+{
+}
+
+WyvTransientPool::~WyvTransientPool()
+{
+	destroyImages();
+}
+
+uint32_t WyvTransientPool::declare(const WyvTransientDesc &_desc)
+{
+	if (m_built)
+		Wyvern::Fail("Transient pool '" + m_name + "' got a declaration after it was built");
+	Resource resource;
+	resource.desc = _desc;
+	resource.desc.lastPass = std::max(_desc.firstPass, _desc.lastPass);
+	resource.desc.mipLevels = std::max(_desc.mipLevels, 1u);
+	m_resources.push_back(resource);
+	return (uint32_t)m_resources.size() - 1;
+}
+
+//Lowest offset in the first compatible group where the target's memory doesn't overlap any target alive at the same time
+void WyvTransientPool::place(uint32_t _resource)
+{
+	Resource &resource = m_resources[_resource];
+	const VkMemoryRequirements &requirements = resource.requirements;
+	for (uint32_t g = 0; g < m_groups.size(); g++)
+	{
+		Group &group = m_groups[g];
+		if (!(group.typeBits & requirements.memoryTypeBits))
+			continue;
+
+		std::vector<std::pair<VkDeviceSize, VkDeviceSize>> busy;
+		for (uint32_t other : group.resources)
+			if (Overlaps(m_resources[other].desc, resource.desc))
+				busy.push_back(std::make_pair(m_resources[other].offset, m_resources[other].offset + m_resources[other].requirements.size));
+		std::sort(busy.begin(), busy.end());
+
+		VkDeviceSize offset = 0;
+		for (const auto &range : busy)
+		{
+			if (AlignUp(offset, requirements.alignment) + requirements.size <= range.first)
+				break;
+			offset = std::max(offset, range.second);
+		}
+		resource.group = (int)g;
+		resource.offset = AlignUp(offset, requirements.alignment);
+		group.typeBits &= requirements.memoryTypeBits;
+		group.alignment = std::max(group.alignment, requirements.alignment);
+		group.size = std::max(group.size, resource.offset + requirements.size);
+		group.resources.push_back(_resource);
+		return;
+	}
+
+	Group group;
+	group.typeBits = requirements.memoryTypeBits;
+	group.alignment = requirements.alignment;
+	group.size = requirements.size;
+	group.resources.push_back(_resource);
+	resource.group = (int)m_groups.size();
+	resource.offset = 0;
+	m_groups.push_back(group);
+}
+
+bool WyvTransientPool::build()
+{
+	if (m_built)
+		return true;
+	VkDevice device = Wyvern::GetDevice();
+	WyvMemory &memory = Wyvern::GetMemory();
+	const VkPhysicalDeviceMemoryProperties &properties = Wyvern::GetMemoryProperties();
+	uint32_t lazyTypes = 0;
+	for (uint32_t i = 0; i < properties.memoryTypeCount; i++)
+		if (properties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+			lazyTypes |= 1u << i;
+	const VkImageUsageFlags attachmentUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+
+	m_built = true;
+	for (Resource &resource : m_resources)
+	{
+		//A target that never leaves its pass and is only ever an attachment can live in tile memory
+		bool transient = lazyTypes && resource.desc.firstPass == resource.desc.lastPass && !(resource.desc.usage & ~attachmentUsage);
+
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = resource.desc.format;
+		imageInfo.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+		imageInfo.mipLevels = resource.desc.mipLevels;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = resource.desc.samples;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = resource.desc.usage | (transient ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		if (vkCreateImage(device, &imageInfo, Wyvern::GetAllocator(), &resource.image) != VK_SUCCESS)
+		{
+			Wyvern::Error("Transient pool '" + m_name + "' couldn't create '" + resource.desc.name + "'");
+			destroyImages();
+			return false;
+		}
+		vkGetImageMemoryRequirements(device, resource.image, &resource.requirements);
+		resource.lazy = transient && (resource.requirements.memoryTypeBits & lazyTypes);
+	}
+
+	//Largest first packs tightest, ties go to the earliest pass so chains alias in order
+	std::vector<uint32_t> order;
+	for (uint32_t i = 0; i < m_resources.size(); i++)
+		if (!m_resources[i].lazy)
+			order.push_back(i);
+	std::sort(order.begin(), order.end(), [this](uint32_t _a, uint32_t _b)
+	{
+		const Resource &a = m_resources[_a], &b = m_resources[_b];
+		return a.requirements.size != b.requirements.size ? a.requirements.size > b.requirements.size : a.desc.firstPass < b.desc.firstPass;
+	});
+	for (uint32_t index : order)
+	{
+		place(index);
+		m_separateBytes += m_resources[index].requirements.size;
+	}
+
+	bool failed = false;
+	for (Group &group : m_groups)
+	{
+		VkMemoryRequirements requirements = { group.size, group.alignment, group.typeBits };
+		group.memory = memory.allocate(requirements, WYV_MEMORY_GPU_ONLY, false, WYV_MEMORY_DEDICATED);
+		if (!group.memory)
+		{
+			failed = true;
+			break;
+		}
+		for (uint32_t index : group.resources)
+			vkBindImageMemory(device, m_resources[index].image, group.memory->memory, group.memory->offset + m_resources[index].offset);
+		m_aliasedBytes += group.size;
+	}
+	for (Resource &resource : m_resources)
+	{
+		if (failed || !resource.lazy)
+			continue;
+		if (!(resource.lazyMemory = memory.allocateImage(resource.image, WYV_MEMORY_GPU_LAZY, WYV_MEMORY_DEDICATED)))
+			failed = true;
+		else
+			m_lazyBytes += resource.requirements.size;
+	}
+	if (failed)
+	{
+		Wyvern::Error("Transient pool '" + m_name + "' is out of memory");
+		destroyImages();
+		return false;
+	}
+
+	for (Resource &resource : m_resources)
+	{
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = resource.image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = resource.desc.format;
+		viewInfo.subresourceRange = { Wyvern::AspectOf(resource.desc.format), 0, resource.desc.mipLevels, 0, 1 };
+		if (vkCreateImageView(device, &viewInfo, Wyvern::GetAllocator(), &resource.view) != VK_SUCCESS)
+		{
+			Wyvern::Error("Transient pool '" + m_name + "' couldn't create a view of '" + resource.desc.name + "'");
+			destroyImages();
+			return false;
+		}
+	}
+
+	logReport();
+	return true;
+}
+
+//Released through the graphics queue so targets still in use by frames in flight outlive them
+void WyvTransientPool::destroyImages()
+{
+	std::vector<VkImage> images;
+	std::vector<VkImageView> views;
+	std::vector<WyvAllocation*> allocations;
+	for (Resource &resource : m_resources)
+	{
+		if (resource.view)
+			views.push_back(resource.view);
+		if (resource.image)
+			images.push_back(resource.image);
+		if (resource.lazyMemory)
+			allocations.push_back(resource.lazyMemory);
+		resource.view = VK_NULL_HANDLE;
+		resource.image = VK_NULL_HANDLE;
+		resource.lazyMemory = nullptr;
+		resource.lazy = false;
+		resource.group = -1;
+		resource.offset = 0;
+	}
+	for (Group &group : m_groups)
+		if (group.memory)
+			allocations.push_back(group.memory);
+	m_groups.clear();
+	m_built = false;
+	m_separateBytes = m_aliasedBytes = m_lazyBytes = 0;
+	if (images.empty() && allocations.empty())
+		return;
+
+	VkDevice device = Wyvern::GetDevice();
+	Wyvern::GetQueue(WYV_QUEUE_GRAPHICS).release([device, images, views, allocations]()
+	{
+		for (VkImageView view : views)
+			vkDestroyImageView(device, view, Wyvern::GetAllocator());
+		for (VkImage image : images)
+			vkDestroyImage(device, image, Wyvern::GetAllocator());
+		for (WyvAllocation *allocation : allocations)
+			Wyvern::GetMemory().free(allocation);
+	});
+}
+
+void WyvTransientPool::reset()
+{
+	destroyImages();
+	m_resources.clear();
+}
+
+std::vector<uint32_t> WyvTransientPool::getAliases(uint32_t _resource) const
+{
+	std::vector<uint32_t> result;
+	const Resource &resource = m_resources[_resource];
+	if (resource.group < 0)
+		return result;
+	VkDeviceSize begin = resource.offset, end = resource.offset + resource.requirements.size;
+	for (uint32_t other : m_groups[resource.group].resources)
+	{
+		const Resource &candidate = m_resources[other];
+		if (candidate.desc.lastPass < resource.desc.firstPass && candidate.offset < end && begin < candidate.offset + candidate.requirements.size)
+			result.push_back(other);
+	}
+	return result;
+}
+
+void WyvTransientPool::logReport() const
+{
+	double saved = m_separateBytes ? 100.0 * (1.0 - (double)m_aliasedBytes / m_separateBytes) : 0.0;
+	WYV_LOG_INFO("Transient pool '{}': {} targets in {} KB of memory instead of {} KB, {}% saved, {} KB more in lazily allocated memory",
+		m_name, (uint32_t)m_resources.size(), m_aliasedBytes / 1024, m_separateBytes / 1024, saved, m_lazyBytes / 1024);
+	for (const Resource &resource : m_resources)
+		WYV_LOG_DEBUG("  '{}' passes {}-{}: {} KB {}", resource.desc.name, resource.desc.firstPass, resource.desc.lastPass, resource.requirements.size / 1024,
+			resource.lazy ? "lazily allocated" : "aliased");
+}
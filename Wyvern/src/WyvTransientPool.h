@@ -0,0 +1,91 @@
+#ifndef _H_WYVTRANSIENTPOOL_
+#define _H_WYVTRANSIENTPOOL_
+
+#include <string>
+#include <vector>
+
+#include "Wyvern.h"
+
+namespace wyv
+{
+	//An intermediate target that lives for the passes firstPass to lastPass of a frame, inclusive
+	struct WyvTransientDesc
+	{
+		std::string name;
+		VkExtent2D extent = {};
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkImageUsageFlags usage = 0;
+		VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+		uint32_t mipLevels = 1;
+		uint32_t firstPass = 0, lastPass = 0;
+	};
+
+	//Places the intermediate targets of a frame, such as shadow maps, bloom chains or SSAO, so targets whose pass
+	//ranges don't overlap share the same memory. Targets only used within a single pass that are nothing but
+	//attachments get VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT and lazily allocated memory where the device has it.
+	//Aliased memory holds garbage when a target's lifetime begins, so its first use must transition from
+	//VK_IMAGE_LAYOUT_UNDEFINED, after a barrier on the work of the targets returned by getAliases.
+	class WyvTransientPool
+	{
+		struct Resource
+		{
+			WyvTransientDesc desc;
+			VkImage image = VK_NULL_HANDLE;
+			VkImageView view = VK_NULL_HANDLE;
+			VkMemoryRequirements requirements = {};
+			bool lazy = false;
+			WyvAllocation *lazyMemory = nullptr;
+			int group = -1;
+			VkDeviceSize offset = 0;
+		};
+
+		//Targets sharing one block of memory
+		struct Group
+		{
+			uint32_t typeBits = 0;
+			VkDeviceSize size = 0, alignment = 1;
+			std::vector<uint32_t> resources;
+			WyvAllocation *memory = nullptr;
+		};
+
+		std::string m_name;
+		std::vector<Resource> m_resources;
+		std::vector<Group> m_groups;
+		bool m_built = false;
+		VkDeviceSize m_separateBytes = 0, m_aliasedBytes = 0, m_lazyBytes = 0;
+
+		void place(uint32_t _resource);
+		void destroyImages();
+
+	public:
+		WyvTransientPool(std::string _name);
+		~WyvTransientPool();
+
+		WyvTransientPool(const WyvTransientPool&) = delete;
+		WyvTransientPool &operator=(const WyvTransientPool&) = delete;
+
+		//Returns the target's index. Declarations are only taken before build.
+		uint32_t declare(const WyvTransientDesc &_desc);
+		//Creates every target and its memory. Returns false if any of it failed, in which case nothing is kept.
+		bool build();
+		//Destroys the targets and forgets the declarations, e.g. to declare them again at a new resolution.
+		//The caller makes sure the GPU is done with them.
+		void reset();
+
+		VkImage getImage(uint32_t _resource) const { return m_resources[_resource].image; }
+		VkImageView getImageView(uint32_t _resource) const { return m_resources[_resource].view; }
+		const WyvTransientDesc &getDesc(uint32_t _resource) const { return m_resources[_resource].desc; }
+		uint32_t getResourceCount() const { return (uint32_t)m_resources.size(); }
+		bool isLazy(uint32_t _resource) const { return m_resources[_resource].lazy; }
+		//Targets whose memory overlaps this one's and whose lifetime ended before it began
+		std::vector<uint32_t> getAliases(uint32_t _resource) const;
+
+		//Memory the targets would take with one allocation each, and what they take aliased, lazy targets excluded
+		VkDeviceSize getSeparateSize() const { return m_separateBytes; }
+		VkDeviceSize getAliasedSize() const { return m_aliasedBytes; }
+		VkDeviceSize getLazySize() const { return m_lazyBytes; }
+		void logReport() const;
+	};
+}
+
+#endif //_H_WYVTRANSIENTPOOL_
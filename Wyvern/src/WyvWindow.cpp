@@ -4,90 +4,393 @@
 #include "GLFW/glfw3.h"
 
 #include <algorithm>
+#include <chrono>
 
 using namespace wyv;
 
-WyvWindow::WyvWindow(std::string _title, unsigned _width, unsigned _height)
+const char *WyvWindow::PresentPolicyName(WyvPresentPolicy _policy)
 {
+	static const char *names[WYV_PRESENT_POLICY_COUNT] = { "vsync", "low latency", "uncapped", "power save" };
+	return names[_policy];
+}
+
+const char *WyvWindow::PresentModeName(VkPresentModeKHR _mode)
+{
+	switch (_mode)
+	{
+	case VK_PRESENT_MODE_IMMEDIATE_KHR: return "IMMEDIATE";
+	case VK_PRESENT_MODE_MAILBOX_KHR: return "MAILBOX";
+	case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO_RELAXED";
+	default: return "UNKNOWN";
+	}
+}
+
+//Preferred modes per policy, FIFO is always supported and ends every list
+static VkPresentModeKHR ChoosePresentMode(WyvPresentPolicy _policy, const std::vector<VkPresentModeKHR> &_available)
+{
+	static const VkPresentModeKHR preferences[WYV_PRESENT_POLICY_COUNT][4] =
+	{
+		{ VK_PRESENT_MODE_FIFO_KHR },
+		{ VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR },
+		{ VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_FIFO_KHR },
+		{ VK_PRESENT_MODE_FIFO_KHR },
+	};
+	for (VkPresentModeKHR mode : preferences[_policy])
+	{
+		if (std::find(_available.begin(), _available.end(), mode) != _available.end())
+			return mode;
+		if (mode == VK_PRESENT_MODE_FIFO_KHR)
+			break;
+	}
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+WyvWindow::WyvWindow(std::string _title, unsigned _width, unsigned _height) : WyvRenderTarget(_title, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR), m_width(_width), m_height(_height)
+{
+	if (Wyvern::IsHeadless())
+		Wyvern::Fail("Window '" + _title + "' can't be created while Wyvern runs headless, use an offscreen target");
+
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 	m_window = glfwCreateWindow(_width, _height, _title.c_str(), nullptr, nullptr);
-	
-	if (glfwCreateWindowSurface(Wyvern::GetInstance(), m_window, nullptr, &m_surface) == VK_SUCCESS)
-		Wyvern::Message("Window '" + _title + "' created succesfully with surface");
+	glfwSetWindowUserPointer(m_window, this);
+	glfwSetFramebufferSizeCallback(m_window, &FramebufferSizeCallback);
+
+	if (glfwCreateWindowSurface(Wyvern::GetInstance(), m_window, Wyvern::GetAllocator(), &m_surface) == VK_SUCCESS)
+		WYV_LOG_MESSAGE("Window '{}' created succesfully with surface", _title);
 	else
 		Wyvern::Fail("Window '" + _title + "' surface creation failed");
 
 	if (Wyvern::GetPhysicalDevice())
 	{
-		VkPhysicalDevice phyicalDevice = Wyvern::GetPhysicalDevice();
+		VkBool32 canPresent = VK_FALSE;
+		vkGetPhysicalDeviceSurfaceSupportKHR(Wyvern::GetPhysicalDevice(), Wyvern::GetGraphicsQueueFamily(), m_surface, &canPresent);
+		if (!canPresent)
+			Wyvern::Fail("Window '" + _title + "' surface can't be presented from the graphics queue");
 
-		VkSurfaceCapabilitiesKHR capabilities;
-		std::vector<VkSurfaceFormatKHR> formats;
-		std::vector<VkPresentModeKHR> presentModes;
+		if (!createSwapchain())
+			m_needsRecreate = true;
+		createFrames();
+		updatePacing();
+	}
+	else
+		WYV_LOG_WARN("Window '{}' created before Wyvern initialisation complete", _title);
+}
 
-		vkGetPhysicalDeviceSurfaceCapabilitiesKHR(phyicalDevice, m_surface, &capabilities);
+WyvWindow::~WyvWindow()
+{
+	if (!m_frames.empty())
+	{
+		reportFrameStats();
+		destroyFrames();
+		destroySwapchain();
+	}
+	vkDestroySurfaceKHR(Wyvern::GetInstance(), m_surface, Wyvern::GetAllocator());
+	glfwDestroyWindow(m_window);
+}
 
-		uint32_t formatCount = 0;
-		vkGetPhysicalDeviceSurfaceFormatsKHR(phyicalDevice, m_surface, &formatCount, nullptr);
-		formats.resize(formatCount);
-		vkGetPhysicalDeviceSurfaceFormatsKHR(phyicalDevice, m_surface, &formatCount, formats.data());
+bool WyvWindow::createSwapchain()
+{
+	VkPhysicalDevice phyicalDevice = Wyvern::GetPhysicalDevice();
+	VkDevice device = Wyvern::GetDevice();
 
-		uint32_t modeCount = 0;
-		vkGetPhysicalDeviceSurfacePresentModesKHR(phyicalDevice, m_surface, &modeCount, nullptr);
-		presentModes.resize(modeCount);
-		vkGetPhysicalDeviceSurfacePresentModesKHR(phyicalDevice, m_surface, &modeCount, presentModes.data());
+	VkSurfaceCapabilitiesKHR capabilities;
+	std::vector<VkSurfaceFormatKHR> formats;
+	std::vector<VkPresentModeKHR> presentModes;
 
-		VkSurfaceFormatKHR chosenFormat = formats[0];
-		for (auto format : formats)
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(phyicalDevice, m_surface, &capabilities);
+
+	uint32_t formatCount = 0;
+	vkGetPhysicalDeviceSurfaceFormatsKHR(phyicalDevice, m_surface, &formatCount, nullptr);
+	formats.resize(formatCount);
+	vkGetPhysicalDeviceSurfaceFormatsKHR(phyicalDevice, m_surface, &formatCount, formats.data());
+
+	uint32_t modeCount = 0;
+	vkGetPhysicalDeviceSurfacePresentModesKHR(phyicalDevice, m_surface, &modeCount, nullptr);
+	presentModes.resize(modeCount);
+	vkGetPhysicalDeviceSurfacePresentModesKHR(phyicalDevice, m_surface, &modeCount, presentModes.data());
+
+	VkSurfaceFormatKHR chosenFormat = formats[0];
+	for (auto format : formats)
+	{
+		if (format.format == VK_FORMAT_R8G8B8A8_UNORM && format.colorSpace == VK_COLORSPACE_SRGB_NONLINEAR_KHR)
 		{
-			if (format.format == VK_FORMAT_R8G8B8A8_UNORM && format.colorSpace == VK_COLORSPACE_SRGB_NONLINEAR_KHR)
-			{
-				chosenFormat = format;
-				break;
-			}
+			chosenFormat = format;
+			break;
 		}
+	}
+
+	VkPresentModeKHR chosenMode = ChoosePresentMode(m_presentPolicy, presentModes);
+
+	VkExtent2D chosenExtent = capabilities.currentExtent;
+	if (capabilities.currentExtent.width == std::numeric_limits<uint32_t>::max())
+	{
+		int w = m_width, h = m_height;
+		glfwGetWindowSize(m_window, &w, &h);
+
+		chosenExtent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, (uint32_t)w));
+		chosenExtent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, (uint32_t)h));
+	}
+	//Minimized, there is nothing to present to until the window gets a size again
+	if (!chosenExtent.width || !chosenExtent.height)
+		return false;
+
+	//One image per frame in flight plus the one on screen, so acquire doesn't wait on presentation
+	uint32_t imageCount = std::max(capabilities.minImageCount, m_framesInFlight + 1);
+	if (capabilities.maxImageCount) //0 means no limit
+		imageCount = std::min(imageCount, capabilities.maxImageCount);
+	m_swapchainFrames = m_framesInFlight;
+
+	VkSwapchainCreateInfoKHR swapCreateInfo = {};
+	swapCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	swapCreateInfo.surface = m_surface;
+	swapCreateInfo.minImageCount = imageCount;
+	swapCreateInfo.imageFormat = chosenFormat.format;
+	swapCreateInfo.imageColorSpace = chosenFormat.colorSpace;
+	swapCreateInfo.imageExtent = chosenExtent;
+	swapCreateInfo.imageArrayLayers = 1;
+	swapCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	swapCreateInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE; //Rendered and presented from the graphics queue
+	swapCreateInfo.preTransform = capabilities.currentTransform;
+	swapCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	swapCreateInfo.presentMode = chosenMode;
+	swapCreateInfo.clipped = VK_TRUE;
+	swapCreateInfo.oldSwapchain = m_swapchain;
+
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	if (vkCreateSwapchainKHR(device, &swapCreateInfo, Wyvern::GetAllocator(), &swapchain) != VK_SUCCESS)
+		Wyvern::Fail("Window '" + m_name + "' swapchain creation failed");
+	if (m_swapchain)
+		retireSwapchain();
+	m_swapchain = swapchain;
+	m_surfaceFormat = chosenFormat;
+	m_format = chosenFormat.format;
+	m_extent = chosenExtent;
+	m_presentMode = chosenMode;
 
-		VkPresentModeKHR chosenMode = VK_PRESENT_MODE_FIFO_KHR;
-		for (auto mode : presentModes)
+	uint32_t swapImageCount = 0;
+	vkGetSwapchainImagesKHR(device, m_swapchain, &swapImageCount, nullptr);
+	m_images.resize(swapImageCount);
+	vkGetSwapchainImagesKHR(device, m_swapchain, &swapImageCount, m_images.data());
+
+	if (m_renderPass && chosenFormat.format != m_renderPassFormat)
+	{
+		//Format changes across recreation are rare, retire the old pass with the old swapchain
+		VkRenderPass oldPass = m_renderPass;
+		Wyvern::GetQueue(WYV_QUEUE_GRAPHICS).release([device, oldPass]() { vkDestroyRenderPass(device, oldPass, Wyvern::GetAllocator()); });
+		m_renderPass = VK_NULL_HANDLE;
+	}
+	if (!m_renderPass)
+		createRenderPass();
+
+	createImageViews();
+	m_renderFinished.resize(swapImageCount);
+	for (uint32_t i = 0; i < swapImageCount; i++)
+	{
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		if (vkCreateSemaphore(device, &semaphoreInfo, Wyvern::GetAllocator(), &m_renderFinished[i]) != VK_SUCCESS)
+			Wyvern::Fail("Window '" + m_name + "' semaphore creation failed");
+	}
+
+	WYV_LOG_MESSAGE("Window '{}' swapchain created: {}x{}, {} images, {} for the {} policy", m_name, m_extent.width, m_extent.height, swapImageCount,
+		PresentModeName(m_presentMode), PresentPolicyName(m_presentPolicy));
+	return true;
+}
+
+void WyvWindow::retireSwapchain()
+{
+	//Frames already submitted may still render to or present the old images. Hand everything to the
+	//graphics queue's deferred releases instead of idling the device, the render loop keeps going.
+	VkDevice device = Wyvern::GetDevice();
+	VkSwapchainKHR swapchain = m_swapchain;
+	std::vector<VkImageView> imageViews;
+	std::vector<VkFramebuffer> framebuffers;
+	std::vector<VkSemaphore> renderFinished;
+	imageViews.swap(m_imageViews);
+	framebuffers.swap(m_framebuffers);
+	renderFinished.swap(m_renderFinished);
+	m_images.clear();
+	m_swapchain = VK_NULL_HANDLE;
+
+	Wyvern::GetQueue(WYV_QUEUE_GRAPHICS).release([device, swapchain, imageViews, framebuffers, renderFinished]()
+	{
+		for (size_t i = 0; i < imageViews.size(); i++)
 		{
-			if (mode == VK_PRESENT_MODE_MAILBOX_KHR)
-			{
-				chosenMode = mode;
-				break;
-			}
+			vkDestroySemaphore(device, renderFinished[i], Wyvern::GetAllocator());
+			vkDestroyFramebuffer(device, framebuffers[i], Wyvern::GetAllocator());
+			vkDestroyImageView(device, imageViews[i], Wyvern::GetAllocator());
 		}
+		vkDestroySwapchainKHR(device, swapchain, Wyvern::GetAllocator());
+	});
+}
 
-		VkExtent2D chosenExtent = capabilities.currentExtent;
-		if (capabilities.currentExtent.width == std::numeric_limits<uint32_t>::max())
-		{
-			int w = _width, h = _height;
-			glfwGetWindowSize(m_window, &w, &h);
+bool WyvWindow::recreateSwapchain()
+{
+	auto start = std::chrono::steady_clock::now();
+	m_needsRecreate = false;
+	if (!createSwapchain())
+	{
+		m_needsRecreate = true;
+		return false;
+	}
+	m_recreateCount++;
+	WYV_LOG_DEBUG("Window '{}' swapchain recreated in {} ms", m_name, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+	return true;
+}
 
-			chosenExtent.width = std::max(capabilities.minImageExtent.width, std::min(capabilities.maxImageExtent.width, (uint32_t)w));
-			chosenExtent.height = std::max(capabilities.minImageExtent.height, std::min(capabilities.maxImageExtent.height, (uint32_t)h));
-		}
+void WyvWindow::FramebufferSizeCallback(GLFWwindow *_window, int _width, int _height)
+{
+	WyvWindow *window = (WyvWindow*)glfwGetWindowUserPointer(_window);
+	if (window)
+	{
+		window->m_width = _width;
+		window->m_height = _height;
+		window->m_needsRecreate = true;
+	}
+}
+
+void WyvWindow::destroySwapchain()
+{
+	VkDevice device = Wyvern::GetDevice();
+	Wyvern::GetQueue(WYV_QUEUE_GRAPHICS).wait(Wyvern::GetQueue(WYV_QUEUE_GRAPHICS).getTimeline().getSubmittedValue());
 
-		uint32_t imageCount = std::min(capabilities.minImageCount + 1, std::max(capabilities.maxImageCount, capabilities.minImageCount)); //maxImageCount can be 0
-
-		VkSwapchainCreateInfoKHR swapCreateInfo = {};
-		swapCreateInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-		swapCreateInfo.surface = m_surface;
-		swapCreateInfo.minImageCount = imageCount;
-		swapCreateInfo.imageFormat = chosenFormat.format;
-		swapCreateInfo.imageColorSpace = chosenFormat.colorSpace;
-		swapCreateInfo.imageExtent = chosenExtent;
-		swapCreateInfo.imageArrayLayers = 1;
-		swapCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	destroyImageViews();
+	for (VkSemaphore semaphore : m_renderFinished)
+		vkDestroySemaphore(device, semaphore, Wyvern::GetAllocator());
+	m_renderFinished.clear();
+	m_images.clear();
+
+	if (m_renderPass)
+		vkDestroyRenderPass(device, m_renderPass, Wyvern::GetAllocator());
+	if (m_swapchain)
+		vkDestroySwapchainKHR(device, m_swapchain, Wyvern::GetAllocator());
+	m_renderPass = VK_NULL_HANDLE;
+	m_swapchain = VK_NULL_HANDLE;
+	Wyvern::GetQueue(WYV_QUEUE_GRAPHICS).getTimeline().collect();
+}
+
+void WyvWindow::reportFrameStats()
+{
+	if (m_frameStats.getSampleCount() < 2)
+		return;
+	WyvRenderTarget::reportFrameStats();
+	WYV_LOG_INFO("Window '{}' swapchain recreated {} times, {} frames over the {} ms hitch budget",
+		m_name, m_recreateCount, m_frameStats.getHitchCount(), m_frameStats.getHitchBudget());
+	for (int i = 0; i < WYV_PRESENT_POLICY_COUNT; i++)
+	{
+		if (!m_latencyStats[i].getSampleCount())
+			continue;
+		WyvFrameStats::Summary latency = m_latencyStats[i].summarize();
+		WYV_LOG_INFO("Window '{}' {} input to present latency: avg {} ms, p50 {} ms, p99 {} ms, max {} ms over {} frames",
+			m_name, PresentPolicyName((WyvPresentPolicy)i), latency.average, latency.p50, latency.p99, latency.max, latency.samples);
 	}
-	else
-		Wyvern::Warn("Window '" + _title + "' created before Wyvern initialisation complete. This message will appear during Wyvern initialisation.");
 }
 
-WyvWindow::~WyvWindow()
+float WyvWindow::getRefreshInterval() const
 {
-	vkDestroySurfaceKHR(Wyvern::GetInstance(), m_surface, nullptr);
-	glfwDestroyWindow(m_window);
+	GLFWmonitor *monitor = glfwGetWindowMonitor(m_window);
+	if (!monitor)
+		monitor = glfwGetPrimaryMonitor();
+	const GLFWvidmode *mode = monitor ? glfwGetVideoMode(monitor) : nullptr;
+	return 1000.0f / (mode && mode->refreshRate > 0 ? mode->refreshRate : 60);
+}
+
+void WyvWindow::updatePacing()
+{
+	float interval = 0.0f;
+	if (m_presentPolicy == WYV_PRESENT_LOW_LATENCY)
+		interval = getRefreshInterval();
+	else if (m_presentPolicy == WYV_PRESENT_POWER_SAVE)
+		interval = std::max(getRefreshInterval(), 1000.0f / m_powerSaveRate);
+	m_pacer.setInterval(interval);
+}
+
+void WyvWindow::setPresentPolicy(WyvPresentPolicy _policy)
+{
+	if (_policy == m_presentPolicy)
+		return;
+	m_presentPolicy = _policy;
+	m_needsRecreate = true;
+	updatePacing();
+}
+
+void WyvWindow::setPowerSaveFrameRate(float _rate)
+{
+	m_powerSaveRate = std::max(1.0f, _rate);
+	updatePacing();
+}
+
+void WyvWindow::paceFrame()
+{
+	if (m_frames.empty() || m_inFrame || m_paced)
+		return;
+
+	//Only blocks when the CPU is a full m_framesInFlight frames ahead of the GPU
+	WyvQueue &queue = Wyvern::GetQueue(WYV_QUEUE_GRAPHICS);
+	queue.wait(m_frames[m_frameIndex].submitValue);
+	queue.getTimeline().collect();
+
+	m_pacer.wait();
+	m_inputTime = std::chrono::steady_clock::now();
+	m_paced = true;
+}
+
+bool WyvWindow::acquireImage(Frame &_frame)
+{
+	paceFrame();
+	m_paced = false;
+	if (m_swapchainFrames != m_framesInFlight)
+		m_needsRecreate = true;
+	if (m_needsRecreate && !recreateSwapchain())
+		return false;
+
+	VkDevice device = Wyvern::GetDevice();
+	VkResult result = vkAcquireNextImageKHR(device, m_swapchain, UINT64_MAX, _frame.imageAvailable, VK_NULL_HANDLE, &m_imageIndex);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR)
+	{
+		//The acquire semaphore was not signalled, so it can be reused straight away with the new swapchain
+		if (!recreateSwapchain())
+			return false;
+		result = vkAcquireNextImageKHR(device, m_swapchain, UINT64_MAX, _frame.imageAvailable, VK_NULL_HANDLE, &m_imageIndex);
+	}
+	if (result == VK_SUBOPTIMAL_KHR)
+		m_needsRecreate = true; //Still presentable, recreate after this frame
+	else if (result != VK_SUCCESS)
+	{
+		WYV_LOG_WARN("Window '{}' could not acquire a swapchain image, error {}", m_name, result);
+		return false;
+	}
+	return true;
+}
+
+uint64_t WyvWindow::submitFrame(Frame &_frame)
+{
+	WyvSubmitInfo submitInfo(_frame.commandBuffer);
+	submitInfo.wait(_frame.imageAvailable, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+	submitInfo.signalSemaphores.push_back(m_renderFinished[m_imageIndex]);
+
+	WyvQueue &queue = Wyvern::GetQueue(WYV_QUEUE_GRAPHICS);
+	uint64_t submitValue = queue.submit(submitInfo);
+
+	VkPresentInfoKHR presentInfo = {};
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = &m_renderFinished[m_imageIndex];
+	presentInfo.swapchainCount = 1;
+	presentInfo.pSwapchains = &m_swapchain;
+	presentInfo.pImageIndices = &m_imageIndex;
+
+	VkResult result = queue.present(presentInfo);
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+		m_needsRecreate = true;
+	else if (result != VK_SUCCESS)
+		WYV_LOG_WARN("Window '{}' present failed, error {}", m_name, result);
+
+	m_latencyStats[m_presentPolicy].record(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_inputTime).count());
+	m_pacer.endWork();
+	return submitValue;
 }
 
 bool WyvWindow::shouldClose() const
@@ -2,21 +2,57 @@
 #define _H_WYVWINDOW_
 
 #include <string>
+#include <vector>
 
-#include "Wyvern.h"
-#include "WyvObject.h"
+#include "WyvFramePacer.h"
+#include "WyvRenderTarget.h"
 
 class GLFWwindow;
 namespace wyv
 {
+	//VSYNC never tears and queues frames behind the display. LOW_LATENCY prefers MAILBOX and paces the CPU to the refresh
+	//rate so input is sampled late. UNCAPPED prefers IMMEDIATE and renders as fast as it can. POWER_SAVE uses FIFO and
+	//paces to a lower frame rate so the CPU and GPU idle between frames.
+	enum WyvPresentPolicy { WYV_PRESENT_VSYNC, WYV_PRESENT_LOW_LATENCY, WYV_PRESENT_UNCAPPED, WYV_PRESENT_POWER_SAVE, WYV_PRESENT_POLICY_COUNT };
+
 	class WyvWindow;
 	typedef std::shared_ptr<WyvWindow> SharedWindow;
-	class WyvWindow : public WyvObject
+	class WyvWindow : public WyvRenderTarget
 	{
 		GLFWwindow *m_window;
 		unsigned m_width, m_height;
 		VkSurfaceKHR m_surface = VK_NULL_HANDLE;
 		VkSwapchainKHR m_swapchain = VK_NULL_HANDLE;
+		VkSurfaceFormatKHR m_surfaceFormat = {};
+		bool m_needsRecreate = false;
+		uint32_t m_recreateCount = 0;
+		//Frames in flight the swapchain's image count was chosen for
+		uint32_t m_swapchainFrames = 0;
+
+		//Per swapchain image. Present waits are tied to the image so a semaphore is never reused while its present is pending.
+		std::vector<VkSemaphore> m_renderFinished;
+
+		WyvPresentPolicy m_presentPolicy = WYV_PRESENT_LOW_LATENCY;
+		VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+		float m_powerSaveRate = 30.0f;
+		WyvFramePacer m_pacer;
+		bool m_paced = false;
+		std::chrono::steady_clock::time_point m_inputTime;
+		WyvFrameStats m_latencyStats[WYV_PRESENT_POLICY_COUNT];
+
+		//Returns false while the window has no area to present to
+		bool createSwapchain();
+		bool recreateSwapchain();
+		void retireSwapchain();
+		void destroySwapchain();
+		void reportFrameStats() override;
+		void updatePacing();
+		float getRefreshInterval() const;
+
+		bool acquireImage(Frame &_frame) override;
+		uint64_t submitFrame(Frame &_frame) override;
+
+		static void FramebufferSizeCallback(GLFWwindow *_window, int _width, int _height);
 
 	public:
 		WyvWindow(std::string _title, unsigned _width, unsigned _height);
@@ -24,11 +60,28 @@ namespace wyv
 
 		bool shouldClose() const;
 
+		//Waits for the oldest frame in flight and sleeps as the present policy's pacing asks. Call right before polling
+		//input so it is as fresh as possible, beginFrame calls it itself otherwise.
+		void paceFrame();
+		//Takes effect by recreating the swapchain at the next frame
+		void setPresentPolicy(WyvPresentPolicy _policy);
+		//Frame rate the POWER_SAVE policy paces to, capped at the refresh rate
+		void setPowerSaveFrameRate(float _rate);
+
 		GLFWwindow *getGLFWWindow() const { return m_window; }
 		VkSurfaceKHR getSurface() const { return m_surface; }
+		VkSwapchainKHR getSwapchain() const { return m_swapchain; }
+		uint32_t getSwapchainRecreateCount() const { return m_recreateCount; }
+		WyvPresentPolicy getPresentPolicy() const { return m_presentPolicy; }
+		VkPresentModeKHR getPresentMode() const { return m_presentMode; }
+		//Time from paceFrame, where input is sampled, to the present call, recorded per present policy
+		const WyvFrameStats &getLatencyStats(WyvPresentPolicy _policy) const { return m_latencyStats[_policy]; }
+
+		static const char *PresentPolicyName(WyvPresentPolicy _policy);
+		static const char *PresentModeName(VkPresentModeKHR _mode);
 
 		static SharedWindow CreateShared(std::string _title, unsigned _width, unsigned _height) { return std::make_shared<WyvWindow>(_title, _width, _height); }
 	};
 }
 
-#endif //_H_WYVWINDOW_
\ No newline at end of file
+#endif //_H_WYVWINDOW_
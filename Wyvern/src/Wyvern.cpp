@@ -1,10 +1,13 @@
 #include "Wyvern.h"
 
+#include <algorithm>
+#include <chrono>
 #include <string>
 
 #define GLFW_INCLUDE_VULKAN
 #include "GLFW/glfw3.h"
 
+#include "WyvDeviceSelector.h"
 #include "WyvWindow.h"
 
 using namespace wyv;
@@ -15,16 +18,29 @@ bool Wyvern::g_debug = false;
 bool Wyvern::g_debug = true;
 #endif //NDEBUG
 bool Wyvern::g_init = false;
+bool Wyvern::g_timelineSemaphores = false;
+bool Wyvern::g_drawIndirectCount = false;
+bool Wyvern::g_headless = false;
+bool Wyvern::g_trackHostMemory = false;
 bool Wyvern::g_throwOnError = true;
 WyvCode Wyvern::g_verbosity = WYV_ERROR;
-std::stack<std::pair<WyvCode, std::string>> Wyvern::g_log = std::stack<std::pair<WyvCode, std::string>>();
-std::function<void(WyvCode, std::string)> Wyvern::g_logCallback = nullptr;
+WyvLogger Wyvern::g_logger;
+WyvHostAllocator Wyvern::g_hostAllocator;
 VkDebugUtilsMessengerEXT Wyvern::g_debugMessenger = VK_NULL_HANDLE;
 
 VkInstance Wyvern::g_instance = 0;
 VkPhysicalDevice Wyvern::g_physicalDevice = VK_NULL_HANDLE;
 VkDevice Wyvern::g_device = VK_NULL_HANDLE;
-VkQueue Wyvern::g_graphicsQueue = VK_NULL_HANDLE;
+VkPhysicalDeviceMemoryProperties Wyvern::g_memoryProperties = {};
+VkPhysicalDeviceFeatures Wyvern::g_enabledFeatures = {};
+WyvQueue Wyvern::g_queues[WYV_QUEUE_ROLE_COUNT];
+WyvQueueRole Wyvern::g_queueAliases[WYV_QUEUE_ROLE_COUNT] = { WYV_QUEUE_GRAPHICS, WYV_QUEUE_GRAPHICS, WYV_QUEUE_GRAPHICS };
+WyvMemory Wyvern::g_memory;
+WyvStagingRing Wyvern::g_stagingRing;
+VkDeviceSize Wyvern::g_stagingRingSize = WyvStagingRing::DEFAULT_SIZE;
+WyvPipelineCache Wyvern::g_pipelineCache;
+std::string Wyvern::g_pipelineCachePath = "wyvern_pipeline.cache";
+std::string Wyvern::g_preferredDevice;
 std::vector<const char*> Wyvern::g_desiredValidationLayers = { "VK_LAYER_KHRONOS_validation" };
 
 void Wyvern::ErrorCallbackGlfw(int _error, const char *_message)
@@ -37,12 +53,44 @@ VKAPI_ATTR VkBool32 VKAPI_CALL Wyvern::ErrorCallbackVulkan(VkDebugUtilsMessageSe
 	if (_messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
 		Fail("Vulkan validation layer: " + std::string(_pCallbackData->pMessage));
 	else if (_messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
-		Warn("Vulkan validation layer: " + std::string(_pCallbackData->pMessage));
+	{
+		if (WYV_LOG_LEVEL <= WYV_WARNING)
+			LogValidationMessage(WYV_WARNING, _pCallbackData);
+	}
 	else if (_messageSeverity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_INFO_BIT_EXT)
-		Message("Vulkan validation layer: " + std::string(_pCallbackData->pMessage));
+	{
+		if (WYV_LOG_LEVEL <= WYV_MESSAGE)
+			LogValidationMessage(WYV_MESSAGE, _pCallbackData);
+	}
 	return VK_FALSE;
 }
 
+void Wyvern::LogValidationMessage(WyvCode _code, const VkDebugUtilsMessengerCallbackDataEXT *_pCallbackData)
+{
+	if (!IsLogged(_code))
+		return;
+
+	//The message ID is queued as a tag so binary logs can count repeats, handles are kept as raw fields
+	WyvLogTag id(_pCallbackData->messageIdNumber);
+	const char *idName = _pCallbackData->pMessageIdName ? _pCallbackData->pMessageIdName : "";
+	const VkDebugUtilsObjectNameInfoEXT *objects = _pCallbackData->pObjects;
+	switch (std::min(_pCallbackData->objectCount, 3u))
+	{
+	case 0:
+		LogFormat(_code, "Vulkan validation layer [{}]: {}", id, idName, _pCallbackData->pMessage);
+		break;
+	case 1:
+		LogFormat(_code, "Vulkan validation layer [{}] object {}: {}", id, idName, WyvHex(objects[0].objectHandle), _pCallbackData->pMessage);
+		break;
+	case 2:
+		LogFormat(_code, "Vulkan validation layer [{}] objects {} {}: {}", id, idName, WyvHex(objects[0].objectHandle), WyvHex(objects[1].objectHandle), _pCallbackData->pMessage);
+		break;
+	default:
+		LogFormat(_code, "Vulkan validation layer [{}] objects {} {} {}: {}", id, idName, WyvHex(objects[0].objectHandle), WyvHex(objects[1].objectHandle), WyvHex(objects[2].objectHandle), _pCallbackData->pMessage);
+		break;
+	}
+}
+
 std::vector<const char*> Wyvern::GetValidationLayers()
 {
 	uint32_t validationLayerCount = 0;
@@ -54,7 +102,7 @@ std::vector<const char*> Wyvern::GetValidationLayers()
 	if (g_debug)
 	{
 		validationLayers = g_desiredValidationLayers;
-		Message("Wyvern debug mode - checking Vulkan validation layers");
+		WYV_LOG_MESSAGE("Wyvern debug mode - checking Vulkan validation layers");
 	}
 	int i = 0;
 	while (i < validationLayers.size())
@@ -70,7 +118,7 @@ std::vector<const char*> Wyvern::GetValidationLayers()
 		}
 		if (!canUseLayer)
 		{
-			Warn("Validation layer '" + std::string(validationLayers[i]) + "' unavailable");
+			WYV_LOG_WARN("Validation layer '{}' unavailable", validationLayers[i]);
 			validationLayers.erase(validationLayers.begin() + i);
 		}
 		else
@@ -81,6 +129,8 @@ std::vector<const char*> Wyvern::GetValidationLayers()
 
 std::vector<const char*> Wyvern::GetRequiredInstanceExtensions()
 {
+	if (g_headless)
+		return std::vector<const char*>();
 	uint32_t glfwExtensionCount = 0;
 	const char **glfwExtensions;
 	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
@@ -89,7 +139,9 @@ std::vector<const char*> Wyvern::GetRequiredInstanceExtensions()
 
 std::vector<const char*> Wyvern::GetRequiredDeviceExtensions()
 {
-	std::vector<const char*> result = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	std::vector<const char*> result;
+	if (!g_headless)
+		result.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 	return result;
 }
 
@@ -102,30 +154,34 @@ void Wyvern::EnableVulkanDebugCallback()
 	createInfo.pfnUserCallback = &ErrorCallbackVulkan;
 
 	auto callbackRegisterFunc = (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(g_instance, "vkCreateDebugUtilsMessengerEXT");
-	if (callbackRegisterFunc && callbackRegisterFunc(g_instance, &createInfo, nullptr, &g_debugMessenger) != VK_SUCCESS)
+	if (callbackRegisterFunc && callbackRegisterFunc(g_instance, &createInfo, GetAllocator(), &g_debugMessenger) != VK_SUCCESS)
 		Error("Couldn't create Vulkan error callback");
-	Message("Created Vulkan error callback");
+	WYV_LOG_MESSAGE("Created Vulkan error callback");
 }
 
 void Wyvern::Initialize()
 {
-	Message("Initializing Wyvern");
+	WYV_LOG_MESSAGE("Initializing Wyvern");
 	if (!g_init)
 	{
 		g_init = true;
+		auto start = std::chrono::steady_clock::now();
 
-		if (glfwInit())
-			Message("GLFW initialized");
+		if (g_headless)
+			WYV_LOG_MESSAGE("Running headless, GLFW not initialized");
+		else if (glfwInit())
+		{
+			WYV_LOG_MESSAGE("GLFW initialized");
+			glfwSetErrorCallback(&ErrorCallbackGlfw);
+		}
 		else
 		{
 			Fail("GLFW not initialized");
 			return;
 		}
 
-		glfwSetErrorCallback(&ErrorCallbackGlfw);
-
 		if (VulkanIsAvailable())
-			Message("Vulkan is installed");
+			WYV_LOG_MESSAGE("Vulkan is installed");
 		else
 		{
 			Fail("Vulkan not installed");
@@ -155,8 +211,8 @@ void Wyvern::Initialize()
 		instanceCreateInfo.enabledLayerCount = validationLayers.size();
 		instanceCreateInfo.ppEnabledLayerNames = validationLayers.data();
 
-		if (vkCreateInstance(&instanceCreateInfo, nullptr, &g_instance) == VK_SUCCESS)
-			Message("Vulkan instance created");
+		if (vkCreateInstance(&instanceCreateInfo, GetAllocator(), &g_instance) == VK_SUCCESS)
+			WYV_LOG_MESSAGE("Vulkan instance created");
 		else
 		{
 			Fail("Vulkan instance creation failed");
@@ -166,127 +222,126 @@ void Wyvern::Initialize()
 		if(g_debug)
 			EnableVulkanDebugCallback();
 
-		WyvWindow mainWindow("Wyvern Initial Window", 64, 64);
-		VkSurfaceKHR mainSurface = mainWindow.getSurface();
+		std::vector<const char*> deviceExtensions = GetRequiredDeviceExtensions();
 
-		uint32_t deviceCount = 0;
-		vkEnumeratePhysicalDevices(g_instance, &deviceCount, nullptr);
-		if (!deviceCount)
+		std::vector<WyvDeviceCandidate> candidates = WyvDeviceSelector::Evaluate(g_instance, deviceExtensions, !g_headless);
+		if (candidates.empty())
 		{
 			Fail("No Vulkan compatible GPU detected");
 			return;
 		}
 
-		std::vector<VkPhysicalDevice> devices(deviceCount);
-		vkEnumeratePhysicalDevices(g_instance, &deviceCount, devices.data());
-
-		std::vector<const char*> deviceExtensions = GetRequiredDeviceExtensions();
-
-		//Missing device checks for surface capabilities, formats and presentation modes
-		int i, qFamily = -1;
-		for (i = 0; i < devices.size(); i++)
+		int selected = WyvDeviceSelector::Select(candidates, g_preferredDevice);
+		if (selected < 0)
 		{
-			uint32_t availableExtensionsCount = 0;
-			vkEnumerateDeviceExtensionProperties(devices[i], nullptr, &availableExtensionsCount, nullptr);
+			Fail("No physical devices found support graphics features");
+			return;
+		}
 
-			std::vector<VkExtensionProperties> availableExtensions(availableExtensionsCount);
-			vkEnumerateDeviceExtensionProperties(devices[i], nullptr, &availableExtensionsCount, availableExtensions.data());
+		g_physicalDevice = candidates[selected].device;
+		g_memoryProperties = candidates[selected].memory;
+		const WyvDeviceCandidate &chosen = candidates[selected];
 
-			bool deviceSupportsExtensions = true;
-			for (const char *extension : deviceExtensions)
-			{
-				bool found = false;
-				for (VkExtensionProperties props : availableExtensions)
-				{
-					if (!strcmp(props.extensionName, extension))
-					{
-						found = true;
-						break;
-					}
-				}
-				if (!found)
-				{
-					deviceSupportsExtensions = found;
-					break;
-				}
-			}
-				
-			if (deviceSupportsExtensions)
-			{
-				uint32_t queueFamilyCount = 0;
-				vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &queueFamilyCount, nullptr);
-				std::vector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
-				vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &queueFamilyCount, queueFamilyProperties.data());
+		//One queue per dedicated family. Async compute runs just below graphics priority and background
+		//transfers lowest. A role without a dedicated family takes another queue from the family it falls back
+		//to when that family has one to spare, and only shares the compute or graphics VkQueue otherwise.
+		int roleFamilies[WYV_QUEUE_ROLE_COUNT] = { chosen.graphicsFamily, chosen.computeFamily, chosen.transferFamily };
+		uint32_t roleIndices[WYV_QUEUE_ROLE_COUNT] = {};
+		static const float rolePriorities[WYV_QUEUE_ROLE_COUNT] = { 1.0f, 0.75f, 0.5f };
+		std::vector<std::vector<float>> familyPriorities(chosen.queueFamilies.size());
 
-				for (int j = 0; j < queueFamilyProperties.size(); j++)
+		for (int role = 0; role < WYV_QUEUE_ROLE_COUNT; role++)
+		{
+			if (roleFamilies[role] < 0)
+			{
+				WyvQueueRole fallback = role == WYV_QUEUE_TRANSFER && g_queueAliases[WYV_QUEUE_COMPUTE] == WYV_QUEUE_COMPUTE ? WYV_QUEUE_COMPUTE : WYV_QUEUE_GRAPHICS;
+				int family = roleFamilies[fallback];
+				if (familyPriorities[family].size() >= chosen.queueFamilies[family].queueCount)
 				{
-					VkBool32 canPresent = false;
-					vkGetPhysicalDeviceSurfaceSupportKHR(devices[i], j, mainSurface, &canPresent);
-
-					if (queueFamilyProperties[j].queueCount > 0 && queueFamilyProperties[j].queueFlags & VK_QUEUE_GRAPHICS_BIT && canPresent)
-					{
-						qFamily = j;
-						break;
-					}
+					g_queueAliases[role] = fallback;
+					continue;
 				}
-
-				if (qFamily >= 0)
-					break;
-			}
-
-			if (i == devices.size() - 1)
-			{
-				i = -1;
-				break;
+				roleFamilies[role] = family;
 			}
+			g_queueAliases[role] = (WyvQueueRole)role;
+			roleIndices[role] = (uint32_t)familyPriorities[roleFamilies[role]].size();
+			familyPriorities[roleFamilies[role]].push_back(rolePriorities[role]);
 		}
 
-		if (i >= 0)
+		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+		for (uint32_t family = 0; family < familyPriorities.size(); family++)
 		{
-			g_physicalDevice = devices[i];
-			Message("Using GPU " + std::to_string(i + 1) + " of " + std::to_string(deviceCount));
+			if (familyPriorities[family].empty())
+				continue;
+			VkDeviceQueueCreateInfo queueCreateInfo = {};
+			queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+			queueCreateInfo.queueFamilyIndex = family;
+			queueCreateInfo.queueCount = (uint32_t)familyPriorities[family].size();
+			queueCreateInfo.pQueuePriorities = familyPriorities[family].data();
+			queueCreateInfos.push_back(queueCreateInfo);
 		}
-		else
-		{
-			Fail("No physical devices found support graphics features");
-			return;
-		}
-
-		VkDeviceQueueCreateInfo queueCreateInfo = {};
-		float queuePriority = 1.0f;
-		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		queueCreateInfo.queueFamilyIndex = qFamily;
-		queueCreateInfo.queueCount = 1;
-		queueCreateInfo.pQueuePriorities = &queuePriority;
 
+		//What GPU-driven rendering needs, where the device has it
 		VkPhysicalDeviceFeatures deviceFeatures = {};
+		deviceFeatures.multiDrawIndirect = chosen.features.multiDrawIndirect;
+		deviceFeatures.drawIndirectFirstInstance = chosen.features.drawIndirectFirstInstance;
+		g_enabledFeatures = deviceFeatures;
+
+		VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+		timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+		timelineFeatures.timelineSemaphore = VK_TRUE;
+		g_timelineSemaphores = chosen.timelineSemaphore;
+		if (g_timelineSemaphores)
+			deviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+		if (chosen.memoryBudget)
+			deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		g_drawIndirectCount = chosen.drawIndirectCount;
+		if (g_drawIndirectCount)
+			deviceExtensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
 
 		VkDeviceCreateInfo deviceCreateInfo = {};
 		deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-		deviceCreateInfo.queueCreateInfoCount = 1;
-		deviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
+		deviceCreateInfo.pNext = g_timelineSemaphores ? &timelineFeatures : nullptr;
+		deviceCreateInfo.queueCreateInfoCount = (uint32_t)queueCreateInfos.size();
+		deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
 		deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
 		deviceCreateInfo.enabledExtensionCount = 0;
 		deviceCreateInfo.enabledExtensionCount = deviceExtensions.size();
 		deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
-		if (vkCreateDevice(g_physicalDevice, &deviceCreateInfo, nullptr, &g_device) == VK_SUCCESS)
-			Message("Vulkan logical device created");
+		if (vkCreateDevice(g_physicalDevice, &deviceCreateInfo, GetAllocator(), &g_device) == VK_SUCCESS)
+			WYV_LOG_MESSAGE("Vulkan logical device created");
 		else
 		{
 			Fail("Vulkan logical device construction failed");
 			return;
 		}
 
-		vkGetDeviceQueue(g_device, qFamily, 0, &g_graphicsQueue);
+		if (g_timelineSemaphores)
+			WyvTimeline::LoadFunctions(g_device);
+		else
+			WYV_LOG_MESSAGE("Timeline semaphores unavailable, tracking submissions with fences");
+		for (int role = 0; role < WYV_QUEUE_ROLE_COUNT; role++)
+			if (g_queueAliases[role] == role)
+				g_queues[role].create(g_device, roleFamilies[role], roleIndices[role], g_timelineSemaphores);
+		WYV_LOG_MESSAGE("Queue families: graphics {}, compute {}{}, transfer {}{}", GetQueue(WYV_QUEUE_GRAPHICS).getFamily(),
+			GetQueue(WYV_QUEUE_COMPUTE).getFamily(), HasDedicatedQueue(WYV_QUEUE_COMPUTE) ? "" : " (shared queue)",
+			GetQueue(WYV_QUEUE_TRANSFER).getFamily(), HasDedicatedQueue(WYV_QUEUE_TRANSFER) ? "" : " (shared queue)");
+
+		g_memory.create(g_device, g_physicalDevice, chosen.memoryBudget);
+		if (g_stagingRingSize)
+			g_stagingRing.create(g_device, g_stagingRingSize);
+		g_pipelineCache.create(g_device, g_physicalDevice, g_pipelineCachePath);
+
+		WYV_LOG_INFO("Wyvern initialized in {} ms", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
 	}
 	else
-		Warn("Tried to initialize Wyvern more than once");
+		WYV_LOG_WARN("Tried to initialize Wyvern more than once");
 }
 
 void Wyvern::Terminate()
 {
-	Message("Terminating Wyvern");
+	WYV_LOG_MESSAGE("Terminating Wyvern");
 	if (g_init)
 	{
 		g_init = false;
@@ -295,32 +350,47 @@ void Wyvern::Terminate()
 		{
 			auto destroyCallbackFunc = (PFN_vkDestroyDebugUtilsMessengerEXT)vkGetInstanceProcAddr(g_instance, "vkDestroyDebugUtilsMessengerEXT");
 			if (destroyCallbackFunc)
-				destroyCallbackFunc(g_instance, g_debugMessenger, nullptr);
+				destroyCallbackFunc(g_instance, g_debugMessenger, GetAllocator());
 		}
 
-		vkDestroyDevice(g_device, nullptr);
-		vkDestroyInstance(g_instance, nullptr);
+		//Fail can terminate before the device exists
+		if (g_device)
+		{
+			vkDeviceWaitIdle(g_device);
+			g_stagingRing.destroy();
+			for (int role = 0; role < WYV_QUEUE_ROLE_COUNT; role++)
+				if (g_queueAliases[role] == role)
+					g_queues[role].destroy();
+
+			g_pipelineCache.save(g_device);
+			g_pipelineCache.destroy(g_device);
+			g_memory.destroy();
+
+			vkDestroyDevice(g_device, GetAllocator());
+			g_device = VK_NULL_HANDLE;
+		}
+		vkDestroyInstance(g_instance, GetAllocator());
+		if (g_trackHostMemory)
+			g_hostAllocator.logStats();
 
-		glfwTerminate();
+		if (!g_headless)
+			glfwTerminate();
 	}
 	else
-		Warn("Tried to terminate Wyvern without intitializing first");
+		WYV_LOG_WARN("Tried to terminate Wyvern without intitializing first");
+	FlushLog();
 }
 
 void wyv::Wyvern::Log(WyvCode _code, std::string _message)
 {
 	if (_code >= g_verbosity)
-	{
-		if (g_logCallback)
-			g_logCallback(_code, _message);
-		else
-			g_log.push(std::pair<WyvCode, std::string>(_code, _message));
-	}
+		g_logger.push(_code, _message);
 }
 
 void Wyvern::Fail(std::string _message)
 {
 	Log(WYV_FAILURE, _message);
+	FlushLog();
 	Terminate();
 	throw std::exception(_message.c_str());
 }
@@ -328,8 +398,11 @@ void Wyvern::Fail(std::string _message)
 void Wyvern::Error(std::string _message)
 {
 	Log(WYV_ERROR, _message);
-	if(g_throwOnError)
+	if (g_throwOnError)
+	{
+		FlushLog();
 		throw std::runtime_error(_message);
+	}
 }
 
 void Wyvern::Warn(std::string _message)
@@ -344,16 +417,34 @@ void Wyvern::Message(std::string _message)
 
 WyvCode Wyvern::PopMessage(std::string *_message)
 {
-	std::pair<WyvCode, std::string> message = g_log.top();
-	g_log.pop();
-	if (_message)
-		*_message = message.second;
-	return message.first;
+	WyvCode code = WYV_MESSAGE;
+	g_logger.pop(&code, _message);
+	return code;
+}
+
+VkImageAspectFlags Wyvern::AspectOf(VkFormat _format)
+{
+	switch (_format)
+	{
+	case VK_FORMAT_D16_UNORM:
+	case VK_FORMAT_X8_D24_UNORM_PACK32:
+	case VK_FORMAT_D32_SFLOAT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT;
+	case VK_FORMAT_S8_UINT:
+		return VK_IMAGE_ASPECT_STENCIL_BIT;
+	case VK_FORMAT_D16_UNORM_S8_UINT:
+	case VK_FORMAT_D24_UNORM_S8_UINT:
+	case VK_FORMAT_D32_SFLOAT_S8_UINT:
+		return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	default:
+		return VK_IMAGE_ASPECT_COLOR_BIT;
+	}
 }
 
 void Wyvern::PollEvents()
 {
-	glfwPollEvents();
+	if (!g_headless)
+		glfwPollEvents();
 }
 
 bool Wyvern::VulkanIsAvailable()
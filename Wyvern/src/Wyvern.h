@@ -1,31 +1,45 @@
 #ifndef _H_WYVERN_
 #define _H_WYVERN_
 
-#include <stack>
 #include <functional>
 #include <vector>
 
 #include "vulkan/vulkan.h"
 
+#include "WyvHostAllocator.h"
+#include "WyvLog.h"
+#include "WyvMemory.h"
+#include "WyvPipelineCache.h"
+#include "WyvQueue.h"
+#include "WyvStagingRing.h"
+
 //#define GLM_FORCE_RADIANS
 //#define GLM_FORCE_DEPTH_ZERO_TO_ONE
 //#include "glm/glm.hpp"
 
 namespace wyv
 {
-	enum WyvCode { WYV_MESSAGE, WYV_DEBUG, WYV_WARNING, WYV_ERROR, WYV_FAILURE };
 	class Wyvern
 	{
-		static bool g_init, g_throwOnError, g_debug;
+		static bool g_init, g_throwOnError, g_debug, g_timelineSemaphores, g_drawIndirectCount, g_headless, g_trackHostMemory;
 		static WyvCode g_verbosity;
-		static std::stack<std::pair<WyvCode, std::string>> g_log;
-		static std::function<void(WyvCode, std::string)> g_logCallback;
+		static WyvLogger g_logger;
+		static WyvHostAllocator g_hostAllocator;
 
 		static VkInstance g_instance;
 		static VkPhysicalDevice g_physicalDevice;
 		static VkDevice g_device;
-		static VkQueue g_graphicsQueue;
-
+		static VkPhysicalDeviceMemoryProperties g_memoryProperties;
+		static VkPhysicalDeviceFeatures g_enabledFeatures;
+		static WyvQueue g_queues[WYV_QUEUE_ROLE_COUNT];
+		static WyvQueueRole g_queueAliases[WYV_QUEUE_ROLE_COUNT];
+		static WyvMemory g_memory;
+		static WyvStagingRing g_stagingRing;
+		static VkDeviceSize g_stagingRingSize;
+		static WyvPipelineCache g_pipelineCache;
+		static std::string g_pipelineCachePath;
+
+		static std::string g_preferredDevice;
 		static std::vector<const char*> g_desiredValidationLayers;
 		static VkDebugUtilsMessengerEXT g_debugMessenger;
 
@@ -33,6 +47,7 @@ namespace wyv
 		~Wyvern() {}
 
 		static void ErrorCallbackGlfw(int _error, const char *_message);
+		static void LogValidationMessage(WyvCode _code, const VkDebugUtilsMessengerCallbackDataEXT *_pCallbackData);
 		static VKAPI_ATTR VkBool32 VKAPI_CALL ErrorCallbackVulkan(VkDebugUtilsMessageSeverityFlagBitsEXT _messageSeverity, VkDebugUtilsMessageTypeFlagsEXT _messageType, const VkDebugUtilsMessengerCallbackDataEXT *_pCallbackData, void *_pUserData);
 
 		static std::vector<const char*> GetValidationLayers();
@@ -46,22 +61,62 @@ namespace wyv
 		static void Terminate();
 
 		static void Log(WyvCode _code, std::string _message);
+		//Queues the format and raw arguments, the message is only formatted if it is emitted. Prefer the WYV_LOG_* macros.
+		template<size_t N, typename... Args>
+		static void LogFormat(WyvCode _code, const char (&_format)[N], const Args&... _args) { if (IsLogged(_code)) g_logger.pushFormat(_code, _format, _args...); }
+		static bool IsLogged(WyvCode _code) { return _code >= g_verbosity; }
 		static void Fail(std::string _message);
 		static void Error(std::string _message);
 		static void Warn(std::string _message);
 		static void Message(std::string _message);
 		static WyvCode PopMessage(std::string *_message = nullptr);
-		static void SetMessageCallback(std::function<void(WyvCode, std::string)> _callback) { g_logCallback = _callback; }
+		static void SetMessageCallback(std::function<void(WyvCode, std::string)> _callback) { g_logger.setCallback(_callback); }
+		static void ConfigureLog(size_t _budgetBytes, WyvLogOverflow _overflow) { g_logger.configure(_budgetBytes, _overflow); }
+		static void FlushLog() { g_logger.flush(); }
+		static bool SetBinaryLog(const std::string &_path) { return g_logger.setBinarySink(_path); }
+		static size_t GetDroppedLogCount() { return g_logger.getDroppedCount(); }
 		static void SetLogVerbosity(WyvCode _verbosity) { g_verbosity = _verbosity; }
 		static void SetThrowOnError(bool _throw) { g_throwOnError = _throw; }
 		static void SetDebugMode(bool _debug) { g_debug = _debug; }
+		//Set before Initialize to run without GLFW or a display, only offscreen targets can be rendered to
+		static void SetHeadless(bool _headless) { g_headless = _headless; }
+		static bool IsHeadless() { return g_headless; }
+		//Set before Initialize to route the driver's host allocations through WyvHostAllocator and log them at Terminate
+		static void SetHostAllocator(bool _enable) { if (!g_init) g_trackHostMemory = _enable; }
+		//Device index, UUID or name substring to use instead of the highest scoring GPU, the WYVERN_DEVICE environment variable takes precedence
+		static void SetPreferredDevice(const std::string &_device) { g_preferredDevice = _device; }
+		//Where the pipeline cache is loaded from at Initialize and saved to at Terminate, empty to disable persistence
+		static void SetPipelineCachePath(const std::string &_path) { g_pipelineCachePath = _path; }
+		//Size of the shared staging ring created at Initialize, 0 to go without one
+		static void SetStagingRingSize(VkDeviceSize _size) { g_stagingRingSize = _size; }
 
 		static void PollEvents();
+		//Depth and/or stencil for depth formats, colour otherwise
+		static VkImageAspectFlags AspectOf(VkFormat _format);
 
 		static bool VulkanIsAvailable();
 
 		static VkInstance GetInstance() { return g_instance; }
+		//What every Vulkan create and destroy call passes as pAllocator, nullptr unless SetHostAllocator was enabled
+		static const VkAllocationCallbacks *GetAllocator() { return g_trackHostMemory ? g_hostAllocator.get() : nullptr; }
+		static WyvHostAllocator &GetHostAllocator() { return g_hostAllocator; }
 		static VkPhysicalDevice GetPhysicalDevice() { return g_physicalDevice; }
+		static VkDevice GetDevice() { return g_device; }
+		static WyvQueue &GetQueue(WyvQueueRole _role) { return g_queues[g_queueAliases[_role]]; }
+		static uint64_t Submit(WyvQueueRole _role, const WyvSubmitInfo &_info) { return GetQueue(_role).submit(_info); }
+		static bool SupportsTimelineSemaphores() { return g_timelineSemaphores; }
+		//Whether VK_KHR_draw_indirect_count is enabled
+		static bool SupportsDrawIndirectCount() { return g_drawIndirectCount; }
+		static const VkPhysicalDeviceFeatures &GetEnabledFeatures() { return g_enabledFeatures; }
+		//Whether _role has a VkQueue of its own, which may still come from the graphics family
+		static bool HasDedicatedQueue(WyvQueueRole _role) { return _role == WYV_QUEUE_GRAPHICS || g_queueAliases[_role] == _role; }
+		static VkQueue GetGraphicsQueue() { return GetQueue(WYV_QUEUE_GRAPHICS).get(); }
+		static uint32_t GetGraphicsQueueFamily() { return GetQueue(WYV_QUEUE_GRAPHICS).getFamily(); }
+		static VkPipelineCache GetPipelineCache() { return g_pipelineCache.get(); }
+		static const VkPhysicalDeviceMemoryProperties &GetMemoryProperties() { return g_memoryProperties; }
+		static WyvMemory &GetMemory() { return g_memory; }
+		//Retired by every WyvRenderTarget::endFrame, allocate from it for work submitted no later than that frame
+		static WyvStagingRing &GetStagingRing() { return g_stagingRing; }
 	};
 }
 
@@ -0,0 +1,87 @@
+#include "WyvBinaryLog.h"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+
+//Rebuilds readable text from a Wyvern binary log.
+//Usage: wyvlogdecode <file> [--dedupe]
+//With --dedupe, messages are grouped by format and tag (the validation message ID) when one was
+//logged, otherwise by their text, and printed once with their repeat count, most frequent first.
+
+using namespace wyv;
+
+static const char *CodeName(WyvCode _code)
+{
+	switch (_code)
+	{
+	case WYV_MESSAGE: return "MESSAGE";
+	case WYV_DEBUG: return "DEBUG";
+	case WYV_INFO: return "INFO";
+	case WYV_WARNING: return "WARNING";
+	case WYV_ERROR: return "ERROR";
+	case WYV_FAILURE: return "FAILURE";
+	}
+	return "UNKNOWN";
+}
+
+struct Repeat
+{
+	size_t count = 0;
+	WyvCode code = WYV_MESSAGE;
+	std::string firstText;
+};
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "Usage: " << argv[0] << " <file> [--dedupe]" << std::endl;
+		return 1;
+	}
+	bool dedupe = argc > 2 && std::string(argv[2]) == "--dedupe";
+
+	WyvBinaryLogReader reader;
+	if (!reader.open(argv[1]))
+	{
+		std::cerr << "'" << argv[1] << "' is not a Wyvern binary log" << std::endl;
+		return 1;
+	}
+
+	std::map<std::string, Repeat> repeats;
+	WyvLogRecord record;
+	uint32_t formatId;
+	size_t total = 0;
+	while (reader.next(record, formatId))
+	{
+		total++;
+		std::string text = record.toString();
+		if (!dedupe)
+		{
+			std::cout << "[" << CodeName(record.code) << "] " << text << "\n";
+			continue;
+		}
+
+		int32_t tag;
+		std::string key = record.getTag(tag) ? std::to_string(formatId) + ":" + std::to_string(tag) : text;
+		Repeat &repeat = repeats[key];
+		if (!repeat.count++)
+		{
+			repeat.code = record.code;
+			repeat.firstText = text;
+		}
+	}
+
+	if (dedupe)
+	{
+		std::vector<const Repeat*> sorted;
+		for (const auto &repeat : repeats)
+			sorted.push_back(&repeat.second);
+		std::stable_sort(sorted.begin(), sorted.end(), [](const Repeat *_a, const Repeat *_b) { return _a->count > _b->count; });
+
+		for (const Repeat *repeat : sorted)
+			std::cout << repeat->count << "x [" << CodeName(repeat->code) << "] " << repeat->firstText << "\n";
+		std::cout << total << " messages, " << sorted.size() << " unique" << std::endl;
+	}
+	return 0;
+}
@@ -1,31 +1,149 @@
+#include "WyvCommandPools.h"
+#include "WyvGpuScene.h"
+#include "WyvOffscreenTarget.h"
+#include "WyvParallelRecorder.h"
+#include "WyvReadback.h"
+#include "WyvRenderGraph.h"
 #include "WyvWindow.h"
 
+#define GLFW_INCLUDE_VULKAN
+#include "GLFW/glfw3.h"
+
 #if defined _WIN32
 #include <Windows.h>
 #endif //WINDOWS
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
 #include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
 
 #define WINDOW_HEIGHT 1080
 #define ASPECT_RATIO 16.0f / 9.0f
 #define WINDOW_WIDTH WINDOW_HEIGHT * ASPECT_RATIO
+#define HEADLESS_FRAMES 300
+#define BENCH_FRAMES 200
+#define BENCH_BUFFERS_PER_THREAD 16
+#define BENCH_COMMANDS_PER_BUFFER 64
+#define SCENE_BENCH_FRAMES 100
+#define SCENE_BENCH_DRAWS 50000
+#define ASYNC_GRAPH_FRAMES 100
+#define LOG_BENCH_MESSAGES 200000
+#define LOG_BENCH_THREADS 16
+#define ASYNC_GRAPH_CLEARS 32
+#define CACHE_BENCH_PATH "wyvern_bench_pipeline.cache"
+#define UPLOAD_BENCH_FRAMES 200
+#define UPLOAD_BENCH_SIZE (16 << 20)
+#define RESIZE_BENCH_CYCLES 50
+#define RESIZE_BENCH_FRAMES 10
+#define RESIZE_BENCH_BUDGET_MS 50.0
+#define FRAMES_BENCH_FRAMES 300
+#define PRESENT_BENCH_FRAMES 300
+#define ALLOC_BENCH_ROUNDS 20
+#define ALLOC_BENCH_LIVE 512
 
 void LogCallback(wyv::WyvCode _code, std::string _message);
+void BenchmarkLogging(uint32_t _maxThreads);
+void BenchmarkStartup();
+void BenchmarkCommandPools(uint32_t _maxThreads);
+void BenchmarkSceneRecording(uint32_t _maxThreads);
+void BenchmarkUploadOverlap();
+bool BenchmarkResize();
+void BenchmarkFramesInFlight();
+void BenchmarkPresentPolicies();
+void BenchmarkReadback(unsigned _width, unsigned _height);
+void BenchmarkAllocations();
+void ExportSampleGraph(const char *_path);
+void RunAsyncGraph();
 
-int main()
+int main(int argc, char **argv)
 {
+	//Goes last so the mode's own arguments keep their positions
+	bool hostMemory = argc > 1 && !strcmp(argv[argc - 1], "--host-memory");
+	if (hostMemory)
+		argc--;
+	bool logBench = argc > 1 && !strcmp(argv[1], "--log-bench");
+	bool cacheBench = argc > 1 && !strcmp(argv[1], "--cache-bench");
+	bool commandBench = argc > 1 && !strcmp(argv[1], "--command-bench");
+	bool sceneBench = argc > 1 && !strcmp(argv[1], "--scene-bench");
+	bool uploadBench = argc > 1 && !strcmp(argv[1], "--upload-bench");
+	bool resizeBench = argc > 1 && !strcmp(argv[1], "--resize-bench");
+	bool allocBench = argc > 1 && !strcmp(argv[1], "--alloc-bench");
+	bool framesBench = argc > 1 && !strcmp(argv[1], "--frames-bench");
+	bool presentBench = argc > 1 && !strcmp(argv[1], "--present-bench");
+	bool graphDot = argc > 1 && !strcmp(argv[1], "--graph-dot");
+	bool asyncGraph = argc > 1 && !strcmp(argv[1], "--async-graph");
+	bool headless = commandBench || sceneBench || uploadBench || allocBench || graphDot || asyncGraph || (argc > 1 && !strcmp(argv[1], "--headless"));
+	uint32_t benchThreads = argc > 2 ? (uint32_t)std::max(atoi(argv[2]), 1) : std::max(std::thread::hardware_concurrency(), 1u);
+	int exitCode = 0;
 	try
 	{
 		wyv::Wyvern::SetMessageCallback(&LogCallback);
+		//Terminate logs the driver's host allocations per scope
+		wyv::Wyvern::SetHostAllocator(hostMemory);
 #ifndef NDEBUG
 		wyv::Wyvern::SetLogVerbosity(wyv::WYV_MESSAGE);
+#else
+		wyv::Wyvern::SetLogVerbosity(wyv::WYV_INFO);
 #endif //NDEBUG
+		//Only needs the logger, not a device
+		if (logBench)
+		{
+			BenchmarkLogging(argc > 2 ? benchThreads : LOG_BENCH_THREADS);
+			return 0;
+		}
+		//Initializes and terminates Wyvern itself, once per run
+		if (cacheBench)
+		{
+			BenchmarkStartup();
+			return 0;
+		}
+		wyv::Wyvern::SetHeadless(headless);
 		wyv::Wyvern::Initialize();
+		if (commandBench)
+			BenchmarkCommandPools(benchThreads);
+		else if (sceneBench)
+			BenchmarkSceneRecording(benchThreads);
+		else if (uploadBench)
+			BenchmarkUploadOverlap();
+		else if (resizeBench)
+			exitCode = BenchmarkResize() ? 0 : 1;
+		else if (framesBench)
+			BenchmarkFramesInFlight();
+		else if (presentBench)
+			BenchmarkPresentPolicies();
+		else if (allocBench)
+			BenchmarkAllocations();
+		else if (graphDot)
+			ExportSampleGraph(argc > 2 ? argv[2] : "graph.dot");
+		else if (asyncGraph)
+			RunAsyncGraph();
+		else if (headless)
+		{
+			BenchmarkReadback(WINDOW_WIDTH, WINDOW_HEIGHT);
+			BenchmarkReadback(3840, 2160);
+		}
+		else
 		{
 			wyv::SharedWindow window = wyv::WyvWindow::CreateShared("Vulkan Wyvern", WINDOW_WIDTH, WINDOW_HEIGHT);
 
+			window->setClearColor(0.1f, 0.1f, 0.15f);
+
 			while (!window->shouldClose())
+			{
+				window->paceFrame();
 				wyv::Wyvern::PollEvents();
+				if (window->beginFrame())
+					window->endFrame();
+			}
 		}
 		wyv::Wyvern::Terminate();
 	}
@@ -41,7 +159,547 @@ int main()
 #endif //_WIN32
 		return 0;
 	}
-	return 0;
+	return exitCode;
+}
+
+//Starts Wyvern headless twice, first with no pipeline cache on disk and then with the one the first run saved, and
+//reports the time from Initialize to the first finished frame, including the culling pipeline's creation, for each
+void BenchmarkStartup()
+{
+	std::remove(CACHE_BENCH_PATH);
+	wyv::Wyvern::SetPipelineCachePath(CACHE_BENCH_PATH);
+	wyv::Wyvern::SetHeadless(true);
+	for (const char *run : { "Cold", "Warm" })
+	{
+		auto start = std::chrono::steady_clock::now();
+		wyv::Wyvern::Initialize();
+		{
+			wyv::WyvGpuScene scene;
+			scene.create("Startup benchmark", 1);
+			wyv::SharedOffscreenTarget target = wyv::WyvOffscreenTarget::CreateShared("Startup benchmark", WINDOW_WIDTH, WINDOW_HEIGHT);
+			if (target->beginFrame())
+				target->endFrame();
+			wyv::Wyvern::GetQueue(wyv::WYV_QUEUE_GRAPHICS).waitIdle();
+		}
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		//Terminate saves the cache the warm run loads
+		wyv::Wyvern::Terminate();
+		std::cout << run << " start: " << ms << " ms to first frame" << std::endl;
+	}
+	std::remove(CACHE_BENCH_PATH);
+}
+
+//Renders HEADLESS_FRAMES frames into an offscreen target and reads every one of them back
+void BenchmarkReadback(unsigned _width, unsigned _height)
+{
+	wyv::SharedOffscreenTarget target = wyv::WyvOffscreenTarget::CreateShared("Headless Wyvern", _width, _height);
+	target->setClearColor(0.1f, 0.1f, 0.15f);
+
+	wyv::WyvReadback readback(*target, wyv::WYV_READBACK_RGBA8);
+	uint64_t checksum = 0;
+	for (int i = 0; i < HEADLESS_FRAMES; i++)
+	{
+		if (target->beginFrame())
+		{
+			readback.capture([&checksum](const wyv::WyvReadbackView &_view) { checksum += _view.pixels[0]; });
+			target->endFrame();
+		}
+	}
+	readback.finish();
+	std::cout << _width << "x" << _height << " frames read back: " << readback.getDeliveredCount() << ", " << readback.getDroppedCount() << " dropped, "
+		<< readback.getFramesPerSecond() << " frames/s, " << readback.getBytesPerSecond() / (1024.0 * 1024.0) << " MB/s, checksum " << checksum << std::endl;
+}
+
+//Logs LOG_BENCH_MESSAGES formatted messages from each of 1, 2, 4... up to _maxThreads threads into a callback that
+//only counts them, and reports how fast producers got them off their hands and how fast the drain thread delivered
+void BenchmarkLogging(uint32_t _maxThreads)
+{
+	std::atomic<uint64_t> delivered(0);
+	wyv::Wyvern::SetMessageCallback([&delivered](wyv::WyvCode, std::string) { delivered.fetch_add(1, std::memory_order_relaxed); });
+	wyv::Wyvern::SetLogVerbosity(wyv::WYV_MESSAGE);
+	for (uint32_t threadCount = 1; ; threadCount = std::min(threadCount * 2, _maxThreads))
+	{
+		delivered = 0;
+		size_t dropped = wyv::Wyvern::GetDroppedLogCount();
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < threadCount; i++)
+			threads.emplace_back([i]
+			{
+				for (uint32_t j = 0; j < LOG_BENCH_MESSAGES; j++)
+					wyv::Wyvern::LogFormat(wyv::WYV_DEBUG, "Benchmark thread {} message {} at {} ms", i, j, j * 0.5);
+			});
+		for (std::thread &thread : threads)
+			thread.join();
+		std::chrono::duration<double> producing = std::chrono::steady_clock::now() - start;
+		wyv::Wyvern::FlushLog();
+		std::chrono::duration<double> total = std::chrono::steady_clock::now() - start;
+
+		double messages = (double)LOG_BENCH_MESSAGES * threadCount;
+		std::cout << threadCount << " logging threads: " << messages / producing.count() << " messages/s enqueued, "
+			<< delivered.load() / total.count() << " messages/s delivered, " << wyv::Wyvern::GetDroppedLogCount() - dropped << " dropped" << std::endl;
+		if (threadCount == _maxThreads)
+			break;
+	}
+	wyv::Wyvern::SetMessageCallback(&LogCallback);
+}
+
+//Records empty barriers into primary buffers on 1, 2, 4... up to _maxThreads threads and submits them each frame
+void BenchmarkCommandPools(uint32_t _maxThreads)
+{
+	for (uint32_t threadCount = 1; ; threadCount = std::min(threadCount * 2, _maxThreads))
+	{
+		wyv::WyvCommandPools pools;
+		pools.create("Benchmark");
+		std::vector<std::vector<VkCommandBuffer>> recorded(threadCount);
+		std::mutex mutex;
+		std::condition_variable wake, done;
+		uint32_t frame = 0, finished = 0;
+
+		auto record = [&](uint32_t _thread)
+		{
+			VkCommandBufferBeginInfo beginInfo = {};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			VkMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			for (uint32_t seen = 0; ; )
+			{
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					wake.wait(lock, [&] { return frame != seen; });
+					seen = frame;
+				}
+				if (seen > BENCH_FRAMES)
+					return;
+				recorded[_thread].clear();
+				for (uint32_t i = 0; i < BENCH_BUFFERS_PER_THREAD; i++)
+				{
+					VkCommandBuffer commandBuffer = pools.getPrimary();
+					vkBeginCommandBuffer(commandBuffer, &beginInfo);
+					for (uint32_t j = 0; j < BENCH_COMMANDS_PER_BUFFER; j++)
+						vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+					vkEndCommandBuffer(commandBuffer);
+					recorded[_thread].push_back(commandBuffer);
+				}
+				std::lock_guard<std::mutex> lock(mutex);
+				finished++;
+				done.notify_one();
+			}
+		};
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < threadCount; i++)
+			threads.emplace_back(record, i);
+
+		std::chrono::duration<double> recording(0.0);
+		for (uint32_t i = 0; i < BENCH_FRAMES; i++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				finished = 0;
+				frame++;
+				wake.notify_all();
+				done.wait(lock, [&] { return finished == threadCount; });
+			}
+			recording += std::chrono::steady_clock::now() - start;
+
+			wyv::WyvSubmitInfo info;
+			for (const auto &buffers : recorded)
+				info.commandBuffers.insert(info.commandBuffers.end(), buffers.begin(), buffers.end());
+			pools.endFrame(wyv::Wyvern::Submit(wyv::WYV_QUEUE_GRAPHICS, info));
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			frame++;
+			wake.notify_all();
+		}
+		for (std::thread &thread : threads)
+			thread.join();
+
+		double buffers = (double)BENCH_FRAMES * threadCount * BENCH_BUFFERS_PER_THREAD;
+		std::cout << threadCount << " recording threads: " << buffers / recording.count() << " command buffers/s, "
+			<< buffers * BENCH_COMMANDS_PER_BUFFER / recording.count() << " commands/s, " << pools.getStallCount() << " stalls" << std::endl;
+		if (threadCount == _maxThreads)
+			break;
+	}
+}
+
+//Records a scene of state-only draws into secondaries on 1, 2, 4... up to _maxThreads threads, nothing renders
+//yet so each draw sets viewport, scissor and stencil reference as a stand-in for its bind and draw calls
+void BenchmarkSceneRecording(uint32_t _maxThreads)
+{
+	wyv::SharedOffscreenTarget target = wyv::WyvOffscreenTarget::CreateShared("Scene benchmark", WINDOW_WIDTH, WINDOW_HEIGHT);
+	VkExtent2D extent = target->getExtent();
+	auto recordDraws = [extent](VkCommandBuffer _commandBuffer, uint32_t _first, uint32_t _count)
+	{
+		for (uint32_t i = _first; i < _first + _count; i++)
+		{
+			VkViewport viewport = { (float)(i % 64), 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f };
+			VkRect2D scissor = { { 0, 0 }, extent };
+			vkCmdSetViewport(_commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(_commandBuffer, 0, 1, &scissor);
+			vkCmdSetStencilReference(_commandBuffer, VK_STENCIL_FRONT_AND_BACK, i & 0xFF);
+		}
+	};
+
+	double singleThread = 0.0;
+	for (uint32_t threadCount = 1; ; threadCount = std::min(threadCount * 2, _maxThreads))
+	{
+		wyv::WyvParallelRecorder recorder;
+		recorder.create("Scene benchmark", threadCount);
+		std::chrono::duration<double> recording(0.0);
+		uint32_t frames = 0;
+		for (uint32_t i = 0; i < SCENE_BENCH_FRAMES; i++)
+		{
+			VkCommandBuffer commandBuffer = target->beginFrame(VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+			if (!commandBuffer)
+				continue;
+			auto start = std::chrono::steady_clock::now();
+			recorder.record(*target, commandBuffer, SCENE_BENCH_DRAWS, recordDraws);
+			recording += std::chrono::steady_clock::now() - start;
+			target->endFrame();
+			frames++;
+		}
+		wyv::Wyvern::GetQueue(wyv::WYV_QUEUE_GRAPHICS).waitIdle();
+
+		double drawsPerSecond = frames ? (double)frames * SCENE_BENCH_DRAWS / recording.count() : 0.0;
+		if (threadCount == 1)
+			singleThread = drawsPerSecond;
+		std::cout << threadCount << " recording threads: " << drawsPerSecond << " draws/s, " << (frames ? recording.count() * 1000.0 / frames : 0.0)
+			<< " ms per frame, " << (singleThread > 0.0 ? drawsPerSecond / singleThread : 0.0) << "x" << std::endl;
+		if (threadCount == _maxThreads)
+			break;
+	}
+}
+
+//Times UPLOAD_BENCH_FRAMES frames alone, as many UPLOAD_BENCH_SIZE buffer copies on the transfer queue alone, and both
+//at once from two threads, and reports how much of the shorter one the queues managed to hide behind the other
+void BenchmarkUploadOverlap()
+{
+	wyv::SharedOffscreenTarget target = wyv::WyvOffscreenTarget::CreateShared("Upload benchmark", WINDOW_WIDTH, WINDOW_HEIGHT);
+	VkDevice device = wyv::Wyvern::GetDevice();
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = UPLOAD_BENCH_SIZE;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	VkBuffer staging = VK_NULL_HANDLE, destination = VK_NULL_HANDLE;
+	vkCreateBuffer(device, &bufferInfo, wyv::Wyvern::GetAllocator(), &staging);
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	vkCreateBuffer(device, &bufferInfo, wyv::Wyvern::GetAllocator(), &destination);
+	wyv::WyvAllocation *stagingMemory = wyv::Wyvern::GetMemory().allocateBuffer(staging, wyv::WYV_MEMORY_CPU_TO_GPU);
+	wyv::WyvAllocation *destinationMemory = wyv::Wyvern::GetMemory().allocateBuffer(destination, wyv::WYV_MEMORY_GPU_ONLY);
+
+	auto render = [&target]
+	{
+		for (uint32_t i = 0; i < UPLOAD_BENCH_FRAMES; i++)
+			if (target->beginFrame())
+				target->endFrame();
+		wyv::Wyvern::GetQueue(wyv::WYV_QUEUE_GRAPHICS).waitIdle();
+	};
+	auto upload = [staging, destination]
+	{
+		wyv::WyvCommandPools pools;
+		pools.create("Upload benchmark", wyv::WYV_QUEUE_TRANSFER);
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		VkBufferCopy region = { 0, 0, UPLOAD_BENCH_SIZE };
+		for (uint32_t i = 0; i < UPLOAD_BENCH_FRAMES; i++)
+		{
+			VkCommandBuffer commandBuffer = pools.getPrimary();
+			vkBeginCommandBuffer(commandBuffer, &beginInfo);
+			vkCmdCopyBuffer(commandBuffer, staging, destination, 1, &region);
+			vkEndCommandBuffer(commandBuffer);
+			pools.endFrame(wyv::Wyvern::Submit(wyv::WYV_QUEUE_TRANSFER, wyv::WyvSubmitInfo(commandBuffer)));
+		}
+		wyv::Wyvern::GetQueue(wyv::WYV_QUEUE_TRANSFER).waitIdle();
+	};
+	auto time = [](const std::function<void()> &_run)
+	{
+		auto start = std::chrono::steady_clock::now();
+		_run();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	};
+
+	if (stagingMemory && destinationMemory)
+	{
+		double renderMs = time(render), uploadMs = time(upload);
+		double bothMs = time([&] { std::thread uploader(upload); render(); uploader.join(); });
+		double hidden = std::max(renderMs + uploadMs - bothMs, 0.0) / std::max(std::min(renderMs, uploadMs), 1e-3);
+		std::cout << "Transfer queue family " << wyv::Wyvern::GetQueue(wyv::WYV_QUEUE_TRANSFER).getFamily()
+			<< (wyv::Wyvern::HasDedicatedQueue(wyv::WYV_QUEUE_TRANSFER) ? ", own queue" : ", shared queue") << std::endl;
+		std::cout << "Frames alone: " << renderMs << " ms, uploads alone: " << uploadMs << " ms ("
+			<< (double)UPLOAD_BENCH_SIZE * UPLOAD_BENCH_FRAMES / (uploadMs * 1000.0) << " MB/s), both: " << bothMs << " ms, "
+			<< std::min(hidden, 1.0) * 100.0 << "% overlapped" << std::endl;
+	}
+	else
+		std::cout << "Upload benchmark buffers could not be allocated" << std::endl;
+
+	wyv::Wyvern::GetMemory().free(stagingMemory);
+	wyv::Wyvern::GetMemory().free(destinationMemory);
+	vkDestroyBuffer(device, staging, wyv::Wyvern::GetAllocator());
+	vkDestroyBuffer(device, destination, wyv::Wyvern::GetAllocator());
+}
+
+//Resizes a window back and forth RESIZE_BENCH_CYCLES times, rendering RESIZE_BENCH_FRAMES frames at each size, and
+//reports the worst frame times of the frames that recreated the swapchain against the ones that didn't. Returns false
+//if any frame took longer than RESIZE_BENCH_BUDGET_MS.
+bool BenchmarkResize()
+{
+	wyv::SharedWindow window = wyv::WyvWindow::CreateShared("Resize benchmark", WINDOW_WIDTH, WINDOW_HEIGHT);
+	window->setClearColor(0.1f, 0.1f, 0.15f);
+	std::vector<double> resizeFrames, steadyFrames;
+	for (uint32_t frame = 0; frame < RESIZE_BENCH_CYCLES * RESIZE_BENCH_FRAMES && !window->shouldClose(); frame++)
+	{
+		if (!(frame % RESIZE_BENCH_FRAMES))
+		{
+			bool small = (frame / RESIZE_BENCH_FRAMES) % 2 == 0;
+			glfwSetWindowSize(window->getGLFWWindow(), (int)(small ? WINDOW_WIDTH / 2 : WINDOW_WIDTH), small ? WINDOW_HEIGHT / 2 : WINDOW_HEIGHT);
+		}
+		uint32_t recreated = window->getSwapchainRecreateCount();
+		auto start = std::chrono::steady_clock::now();
+		window->paceFrame();
+		wyv::Wyvern::PollEvents();
+		if (window->beginFrame())
+			window->endFrame();
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		(window->getSwapchainRecreateCount() != recreated ? resizeFrames : steadyFrames).push_back(ms);
+	}
+	wyv::Wyvern::GetQueue(wyv::WYV_QUEUE_GRAPHICS).waitIdle();
+
+	size_t hitches = 0;
+	auto report = [&hitches](const char *_label, std::vector<double> &_frames)
+	{
+		std::sort(_frames.begin(), _frames.end(), std::greater<double>());
+		std::cout << _label << ": " << _frames.size() << " frames, worst";
+		for (size_t i = 0; i < std::min<size_t>(_frames.size(), 5); i++)
+			std::cout << " " << _frames[i] << " ms";
+		std::cout << std::endl;
+		hitches += std::count_if(_frames.begin(), _frames.end(), [](double _ms) { return _ms > RESIZE_BENCH_BUDGET_MS; });
+	};
+	std::cout << "Swapchain recreated " << window->getSwapchainRecreateCount() << " times" << std::endl;
+	report("Frames that recreated the swapchain", resizeFrames);
+	report("Other frames", steadyFrames);
+	if (hitches)
+		std::cout << "FAILED: " << hitches << " frames over the " << RESIZE_BENCH_BUDGET_MS << " ms budget" << std::endl;
+	else
+		std::cout << "No frame over the " << RESIZE_BENCH_BUDGET_MS << " ms budget" << std::endl;
+	return !hitches;
+}
+
+//Renders FRAMES_BENCH_FRAMES frames to a window with each frames in flight setting and reports their frame time percentiles
+void BenchmarkFramesInFlight()
+{
+	wyv::SharedWindow window = wyv::WyvWindow::CreateShared("Frames in flight benchmark", WINDOW_WIDTH, WINDOW_HEIGHT);
+	window->setClearColor(0.1f, 0.1f, 0.15f);
+	for (uint32_t frames = wyv::WyvRenderTarget::MIN_FRAMES_IN_FLIGHT; frames <= wyv::WyvRenderTarget::MAX_FRAMES_IN_FLIGHT && !window->shouldClose(); frames++)
+	{
+		//Also resets the frame stats
+		window->setFramesInFlight(frames);
+		for (uint32_t i = 0; i < FRAMES_BENCH_FRAMES && !window->shouldClose(); i++)
+		{
+			window->paceFrame();
+			wyv::Wyvern::PollEvents();
+			if (window->beginFrame())
+				window->endFrame();
+		}
+		wyv::WyvFrameStats::Summary summary = window->getFrameStats().summarize();
+		std::cout << window->getFramesInFlight() << " frames in flight: avg " << summary.average << " ms, p50 " << summary.p50 << " ms, p95 " << summary.p95
+			<< " ms, p99 " << summary.p99 << " ms, max " << summary.max << " ms over " << summary.samples << " frames" << std::endl;
+	}
+	wyv::Wyvern::GetQueue(wyv::WYV_QUEUE_GRAPHICS).waitIdle();
+}
+
+//Renders PRESENT_BENCH_FRAMES frames to a window under each present policy, with the present mode the surface gave it,
+//and reports the input to present latency of each
+void BenchmarkPresentPolicies()
+{
+	wyv::SharedWindow window = wyv::WyvWindow::CreateShared("Present policy benchmark", WINDOW_WIDTH, WINDOW_HEIGHT);
+	window->setClearColor(0.1f, 0.1f, 0.15f);
+	for (int i = 0; i < wyv::WYV_PRESENT_POLICY_COUNT && !window->shouldClose(); i++)
+	{
+		wyv::WyvPresentPolicy policy = (wyv::WyvPresentPolicy)i;
+		window->setPresentPolicy(policy);
+		for (uint32_t j = 0; j < PRESENT_BENCH_FRAMES && !window->shouldClose(); j++)
+		{
+			window->paceFrame();
+			wyv::Wyvern::PollEvents();
+			if (window->beginFrame())
+				window->endFrame();
+		}
+		wyv::WyvFrameStats::Summary latency = window->getLatencyStats(policy).summarize();
+		std::cout << wyv::WyvWindow::PresentPolicyName(policy) << " (" << wyv::WyvWindow::PresentModeName(window->getPresentMode()) << "): avg "
+			<< latency.average << " ms, p50 " << latency.p50 << " ms, p99 " << latency.p99 << " ms, max " << latency.max << " ms input to present over "
+			<< latency.samples << " frames" << std::endl;
+	}
+	wyv::Wyvern::GetQueue(wyv::WYV_QUEUE_GRAPHICS).waitIdle();
+}
+
+//Allocates ALLOC_BENCH_LIVE blocks of device memory and frees them in shuffled order, ALLOC_BENCH_ROUNDS times, once
+//through the pools (slabs below 64 KB, TLSF above) and once with a vkAllocateMemory per allocation as before the pools
+void BenchmarkAllocations()
+{
+	wyv::WyvMemory &memory = wyv::Wyvern::GetMemory();
+	std::mt19937 random(1234);
+	std::vector<VkMemoryRequirements> requirements(ALLOC_BENCH_LIVE);
+	for (uint32_t i = 0; i < ALLOC_BENCH_LIVE; i++)
+	{
+		//Half small buffers, half up to a megabyte
+		requirements[i].size = i % 2 ? 256 + random() % (64 * 1024 - 256) : 64 * 1024 + random() % (1024 * 1024 - 64 * 1024);
+		requirements[i].alignment = 256;
+		requirements[i].memoryTypeBits = UINT32_MAX;
+	}
+
+	for (int dedicated = 0; dedicated < 2; dedicated++)
+	{
+		std::vector<wyv::WyvAllocation*> allocations(ALLOC_BENCH_LIVE);
+		std::chrono::duration<double, std::nano> allocating(0.0), freeing(0.0);
+		uint64_t failed = 0;
+		for (uint32_t round = 0; round < ALLOC_BENCH_ROUNDS; round++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			for (uint32_t i = 0; i < ALLOC_BENCH_LIVE; i++)
+				allocations[i] = memory.allocate(requirements[i], wyv::WYV_MEMORY_GPU_ONLY, true, dedicated ? wyv::WYV_MEMORY_DEDICATED : 0);
+			allocating += std::chrono::steady_clock::now() - start;
+
+			std::shuffle(allocations.begin(), allocations.end(), random);
+			failed += std::count(allocations.begin(), allocations.end(), nullptr);
+			start = std::chrono::steady_clock::now();
+			for (wyv::WyvAllocation *allocation : allocations)
+				memory.free(allocation);
+			freeing += std::chrono::steady_clock::now() - start;
+		}
+		double count = (double)ALLOC_BENCH_LIVE * ALLOC_BENCH_ROUNDS;
+		std::cout << (dedicated ? "vkAllocateMemory per allocation" : "Pooled (slab and TLSF)") << ": " << allocating.count() / count << " ns per allocation, "
+			<< freeing.count() / count << " ns per free, " << failed << " failed" << std::endl;
+	}
+}
+
+//Compiles a deferred frame's render graph without running it and writes it out for Graphviz
+void ExportSampleGraph(const char *_path)
+{
+	wyv::WyvRenderGraph graph("Sample frame");
+	VkExtent2D extent = { (uint32_t)(WINDOW_WIDTH), WINDOW_HEIGHT };
+	auto image = [&graph, extent](const char *_name, VkFormat _format, uint32_t _size = 0)
+	{
+		wyv::WyvTransientDesc desc;
+		desc.name = _name;
+		desc.extent = _size ? VkExtent2D{ _size, _size } : extent;
+		desc.format = _format;
+		return graph.createImage(desc);
+	};
+	uint32_t shadow = image("Shadow map", VK_FORMAT_D32_SFLOAT, 2048);
+	uint32_t depth = image("Depth", VK_FORMAT_D32_SFLOAT);
+	uint32_t normals = image("Normals", VK_FORMAT_A2B10G10R10_UNORM_PACK32);
+	uint32_t albedo = image("Albedo", VK_FORMAT_R8G8B8A8_UNORM);
+	uint32_t ao = image("SSAO", VK_FORMAT_R8_UNORM);
+	uint32_t hdr = image("HDR", VK_FORMAT_R16G16B16A16_SFLOAT);
+	uint32_t debug = image("Debug overlay", VK_FORMAT_R8G8B8A8_UNORM);
+	uint32_t lights = graph.importBuffer("Light lists", VK_NULL_HANDLE);
+	uint32_t backbuffer = graph.importImage("Backbuffer", VK_NULL_HANDLE, VK_NULL_HANDLE, VK_FORMAT_B8G8R8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED);
+	graph.markOutput(backbuffer, wyv::WYV_GRAPH_PRESENT);
+
+	uint32_t pass = graph.addPass("Depth prepass", wyv::WYV_PASS_GRAPHICS, nullptr);
+	graph.use(pass, depth, wyv::WYV_GRAPH_DEPTH_ATTACHMENT);
+	pass = graph.addPass("Light culling", wyv::WYV_PASS_COMPUTE, nullptr);
+	graph.use(pass, depth, wyv::WYV_GRAPH_DEPTH_READ);
+	graph.use(pass, lights, wyv::WYV_GRAPH_STORAGE_WRITE);
+	graph.setAsyncCompute(pass);
+	pass = graph.addPass("GBuffer", wyv::WYV_PASS_GRAPHICS, nullptr);
+	graph.use(pass, depth, wyv::WYV_GRAPH_DEPTH_READ);
+	graph.use(pass, normals, wyv::WYV_GRAPH_COLOR_ATTACHMENT);
+	graph.use(pass, albedo, wyv::WYV_GRAPH_COLOR_ATTACHMENT);
+	pass = graph.addPass("SSAO", wyv::WYV_PASS_COMPUTE, nullptr);
+	graph.use(pass, depth, wyv::WYV_GRAPH_DEPTH_READ);
+	graph.use(pass, normals, wyv::WYV_GRAPH_SAMPLED);
+	graph.use(pass, ao, wyv::WYV_GRAPH_STORAGE_WRITE);
+	graph.setAsyncCompute(pass);
+	pass = graph.addPass("Shadows", wyv::WYV_PASS_GRAPHICS, nullptr);
+	graph.use(pass, shadow, wyv::WYV_GRAPH_DEPTH_ATTACHMENT);
+	pass = graph.addPass("Lighting", wyv::WYV_PASS_GRAPHICS, nullptr);
+	graph.use(pass, shadow, wyv::WYV_GRAPH_SAMPLED);
+	graph.use(pass, normals, wyv::WYV_GRAPH_SAMPLED);
+	graph.use(pass, albedo, wyv::WYV_GRAPH_SAMPLED);
+	graph.use(pass, ao, wyv::WYV_GRAPH_SAMPLED);
+	graph.use(pass, lights, wyv::WYV_GRAPH_STORAGE_READ);
+	graph.use(pass, hdr, wyv::WYV_GRAPH_COLOR_ATTACHMENT);
+	pass = graph.addPass("Debug overlay", wyv::WYV_PASS_GRAPHICS, nullptr);
+	graph.use(pass, depth, wyv::WYV_GRAPH_SAMPLED);
+	graph.use(pass, debug, wyv::WYV_GRAPH_COLOR_ATTACHMENT);
+	pass = graph.addPass("Tonemap", wyv::WYV_PASS_GRAPHICS, nullptr);
+	graph.use(pass, hdr, wyv::WYV_GRAPH_SAMPLED);
+	graph.use(pass, backbuffer, wyv::WYV_GRAPH_COLOR_ATTACHMENT);
+
+	if (graph.compile() && graph.writeDot(_path))
+		std::cout << "Render graph written to " << _path << ", " << graph.getBarrierCount() << " barriers" << std::endl;
+}
+
+//Submits frames of a graph whose SSAO pass runs on the compute queue while the shadows render, then logs the
+//GPU timestamps of the passes. Nothing renders yet, so repeated clears and copies stand in for each pass's work.
+void RunAsyncGraph()
+{
+	wyv::WyvRenderGraph graph("Async frame");
+	VkExtent2D extent = { (uint32_t)(WINDOW_WIDTH), WINDOW_HEIGHT };
+	auto image = [&graph, extent](const char *_name)
+	{
+		wyv::WyvTransientDesc desc;
+		desc.name = _name;
+		desc.extent = extent;
+		desc.format = VK_FORMAT_R8G8B8A8_UNORM;
+		return graph.createImage(desc);
+	};
+	uint32_t depth = image("Depth");
+	uint32_t ao = image("SSAO");
+	uint32_t shadow = image("Shadow map");
+	uint32_t scene = image("Scene");
+	auto clear = [&graph](uint32_t _image)
+	{
+		return [&graph, _image](VkCommandBuffer _commandBuffer)
+		{
+			VkClearColorValue color = {};
+			VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+			for (uint32_t i = 0; i < ASYNC_GRAPH_CLEARS; i++)
+			{
+				color.float32[0] = (float)i / ASYNC_GRAPH_CLEARS;
+				vkCmdClearColorImage(_commandBuffer, graph.getImage(_image), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &range);
+			}
+		};
+	};
+	auto copy = [&graph, extent](uint32_t _source, uint32_t _destination)
+	{
+		return [&graph, extent, _source, _destination](VkCommandBuffer _commandBuffer)
+		{
+			VkImageCopy region = {};
+			region.srcSubresource = region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			region.extent = { extent.width, extent.height, 1 };
+			vkCmdCopyImage(_commandBuffer, graph.getImage(_source), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, graph.getImage(_destination), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+		};
+	};
+
+	uint32_t pass = graph.addPass("Depth prepass", wyv::WYV_PASS_GRAPHICS, clear(depth));
+	graph.use(pass, depth, wyv::WYV_GRAPH_TRANSFER_DST);
+	uint32_t ssao = graph.addPass("SSAO", wyv::WYV_PASS_COMPUTE, [&](VkCommandBuffer _commandBuffer) { copy(depth, ao)(_commandBuffer); clear(ao)(_commandBuffer); });
+	graph.use(ssao, depth, wyv::WYV_GRAPH_TRANSFER_SRC);
+	graph.use(ssao, ao, wyv::WYV_GRAPH_TRANSFER_DST);
+	graph.setAsyncCompute(ssao);
+	pass = graph.addPass("Shadows", wyv::WYV_PASS_GRAPHICS, clear(shadow));
+	graph.use(pass, shadow, wyv::WYV_GRAPH_TRANSFER_DST);
+	pass = graph.addPass("Composite", wyv::WYV_PASS_GRAPHICS, [&](VkCommandBuffer _commandBuffer) { copy(shadow, scene)(_commandBuffer); copy(ao, scene)(_commandBuffer); });
+	graph.use(pass, shadow, wyv::WYV_GRAPH_TRANSFER_SRC);
+	graph.use(pass, ao, wyv::WYV_GRAPH_TRANSFER_SRC);
+	graph.use(pass, scene, wyv::WYV_GRAPH_TRANSFER_DST);
+	graph.setSideEffects(pass);
+	graph.setTimestamps(true);
+
+	uint64_t value = 0;
+	for (uint32_t i = 0; i < ASYNC_GRAPH_FRAMES; i++)
+		value = graph.submit();
+	wyv::Wyvern::GetQueue(wyv::WYV_QUEUE_GRAPHICS).wait(value);
+	graph.logTimings();
+	std::cout << "Async graph: " << graph.getSubmissionCount() << " submissions per frame, SSAO on the "
+		<< (graph.getQueueRole(ssao) == wyv::WYV_QUEUE_COMPUTE ? "compute" : "graphics") << " queue, " << graph.getOverlap() << " ms of overlap" << std::endl;
 }
 
 void LogCallback(wyv::WyvCode _code, std::string _message)